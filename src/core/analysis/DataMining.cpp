@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <limits>
 #include <stdexcept>
 #include <mutex>
 
@@ -69,24 +70,17 @@ bool DataMining::decisionTreeClassification(const std::string& trainingDataRange
 
 // Helper function to retrieve data from a specified Excel range
 std::vector<std::vector<double>> DataMining::getDataFromRange(const std::string& range) {
-    // Parse the range string to determine sheet and cell references
-    // This is a simplified implementation and may need to be expanded
-    auto cellRange = dataStore->getCellRange(range);
-
-    std::vector<std::vector<double>> numericData;
-
-    // Convert cell data to numeric values
-    for (const auto& row : cellRange) {
-        std::vector<double> numericRow;
-        for (const auto& cell : row) {
-            try {
-                numericRow.push_back(std::stod(cell));
-            } catch (const std::invalid_argument&) {
+    // Scan the number lanes of one pinned version; anything non-numeric comes back as NaN
+    std::vector<std::vector<double>> numericData =
+        dataStore->createSnapshot().getNumericRange(range, std::numeric_limits<double>::quiet_NaN());
+
+    for (const auto& row : numericData) {
+        for (double value : row) {
+            if (std::isnan(value)) {
                 // Handle non-numeric data
                 throw std::runtime_error("Non-numeric data found in range");
             }
         }
-        numericData.push_back(numericRow);
     }
 
     return numericData;
@@ -55,13 +55,8 @@ bool PivotTableEngine::updatePivotTable(const std::string& pivotTableRange) {
 }
 
 std::vector<std::vector<CellData>> PivotTableEngine::getSourceData(const std::string& sourceRange) {
-    // Parse the sourceRange string to get sheet name and cell range
-    // TODO: Implement proper parsing of the sourceRange string
-    std::string sheetName = "Sheet1"; // Placeholder
-    std::string cellRange = sourceRange; // Placeholder
-
-    // Call DataStore::getCellRange to retrieve the data
-    return dataStore->getCellRange(sheetName, cellRange);
+    // Read "Sheet1!A1:D100" from a pinned snapshot so the pivot sees one consistent version
+    return dataStore->createSnapshot().getCellRange(sourceRange);
 }
 
 std::unordered_map<std::string, std::unordered_map<std::string, double>> PivotTableEngine::aggregateData(
@@ -0,0 +1,245 @@
+#include "AutoFilter.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+bool usesText(FilterCondition::Operator op) {
+    switch (op) {
+        case FilterCondition::Equals:
+        case FilterCondition::NotEquals:
+        case FilterCondition::BeginsWith:
+        case FilterCondition::EndsWith:
+        case FilterCondition::Contains:
+        case FilterCondition::InList:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// A condition with its text operands case-folded once
+struct PreparedCondition {
+    FilterCondition::Operator op;
+    double number;
+    std::string text;
+    std::unordered_set<std::string> values;
+
+    explicit PreparedCondition(const FilterCondition& condition)
+        : op(condition.op), number(condition.number), text(foldCase(condition.text)) {
+        for (const auto& value : condition.values) {
+            values.insert(foldCase(value));
+        }
+    }
+
+    // folded is the cell's case-folded display text, needed only by text operators
+    bool matches(const CellData& cell, const std::string& folded) const {
+        const bool isNumber = cell.getType() == CellData::Number;
+        switch (op) {
+            case FilterCondition::Equals: return folded == text;
+            case FilterCondition::NotEquals: return folded != text;
+            case FilterCondition::Greater: return isNumber && cell.getNumber() > number;
+            case FilterCondition::GreaterOrEqual: return isNumber && cell.getNumber() >= number;
+            case FilterCondition::Less: return isNumber && cell.getNumber() < number;
+            case FilterCondition::LessOrEqual: return isNumber && cell.getNumber() <= number;
+            case FilterCondition::BeginsWith: return folded.compare(0, text.size(), text) == 0;
+            case FilterCondition::EndsWith:
+                return folded.size() >= text.size() && folded.compare(folded.size() - text.size(), text.size(), text) == 0;
+            case FilterCondition::Contains: return folded.find(text) != std::string::npos;
+            case FilterCondition::Blank: return cell.isEmpty() || (cell.getType() == CellData::Text && cell.getTextId() == kEmptyStringId);
+            case FilterCondition::NonBlank: return !cell.isEmpty() && !(cell.getType() == CellData::Text && cell.getTextId() == kEmptyStringId);
+            case FilterCondition::InList: return values.count(folded) > 0;
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+RowBitmap::RowBitmap(uint32_t rows, bool value)
+    : words((rows + 63) / 64, value ? ~uint64_t(0) : 0), rowCount(rows) {
+    trimTail();
+}
+
+uint32_t RowBitmap::count() const {
+    uint32_t total = 0;
+    for (uint64_t word : words) {
+        total += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+    return total;
+}
+
+RowBitmap& RowBitmap::operator&=(const RowBitmap& other) {
+    if (other.rowCount != rowCount) {
+        throw std::invalid_argument("Row bitmaps differ in size");
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] &= other.words[i];
+    }
+    return *this;
+}
+
+RowBitmap& RowBitmap::operator|=(const RowBitmap& other) {
+    if (other.rowCount != rowCount) {
+        throw std::invalid_argument("Row bitmaps differ in size");
+    }
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] |= other.words[i];
+    }
+    return *this;
+}
+
+void RowBitmap::flip() {
+    for (uint64_t& word : words) {
+        word = ~word;
+    }
+    trimTail();
+}
+
+void RowBitmap::trimTail() {
+    if (rowCount % 64 != 0 && !words.empty()) {
+        words.back() &= (uint64_t(1) << (rowCount % 64)) - 1;
+    }
+}
+
+AutoFilter::AutoFilter(DataStore* store, const std::string& qualifiedRange)
+    : dataStore(store), visibleStale(true) {
+    dataStore->createSnapshot().resolveQualifiedRange(qualifiedRange, sheetName, range);
+}
+
+void AutoFilter::setFilter(uint32_t column, const ColumnFilter& filter) {
+    if (!range.contains(CellAddress{range.first.row, column})) {
+        throw std::invalid_argument("Filter column lies outside the range");
+    }
+    // Evaluate outside the lock; only the bitmap swap is serialized
+    RowBitmap passing = evaluate(dataStore->createSnapshot(), column, filter);
+
+    std::lock_guard<std::mutex> lock(filterMutex);
+    ColumnState& state = columns[column];
+    state.filter = filter;
+    state.passing = std::move(passing);
+    visibleStale = true;
+}
+
+void AutoFilter::clearFilter(uint32_t column) {
+    std::lock_guard<std::mutex> lock(filterMutex);
+    if (columns.erase(column) > 0) {
+        visibleStale = true;
+    }
+}
+
+void AutoFilter::setFilterEnabled(uint32_t column, bool enabled) {
+    std::lock_guard<std::mutex> lock(filterMutex);
+    auto it = columns.find(column);
+    if (it == columns.end()) {
+        throw std::invalid_argument("Column has no filter");
+    }
+    if (it->second.enabled != enabled) {
+        it->second.enabled = enabled;
+        visibleStale = true;
+    }
+}
+
+void AutoFilter::refresh() {
+    std::map<uint32_t, ColumnFilter> filters;
+    {
+        std::lock_guard<std::mutex> lock(filterMutex);
+        for (const auto& entry : columns) {
+            filters.emplace(entry.first, entry.second.filter);
+        }
+    }
+
+    DataSnapshot snapshot = dataStore->createSnapshot();
+    std::map<uint32_t, RowBitmap> results;
+    for (const auto& entry : filters) {
+        results.emplace(entry.first, evaluate(snapshot, entry.first, entry.second));
+    }
+
+    std::lock_guard<std::mutex> lock(filterMutex);
+    for (auto& entry : results) {
+        auto it = columns.find(entry.first);
+        if (it != columns.end()) {
+            it->second.passing = std::move(entry.second);
+        }
+    }
+    visibleStale = true;
+}
+
+RowBitmap AutoFilter::getVisibleRows() const {
+    std::lock_guard<std::mutex> lock(filterMutex);
+    return visibleRows();
+}
+
+bool AutoFilter::isRowHidden(uint32_t row) const {
+    std::lock_guard<std::mutex> lock(filterMutex);
+    const RowBitmap& rows = visibleRows();
+    if (row >= rows.size()) {
+        throw std::out_of_range("Row lies outside the filter range");
+    }
+    return !rows.test(row);
+}
+
+uint32_t AutoFilter::getVisibleCount() const {
+    std::lock_guard<std::mutex> lock(filterMutex);
+    return visibleRows().count();
+}
+
+// Caller must hold filterMutex
+const RowBitmap& AutoFilter::visibleRows() const {
+    if (visibleStale) {
+        visible = RowBitmap(range.rowCount(), true);
+        for (const auto& entry : columns) {
+            if (entry.second.enabled) {
+                visible &= entry.second.passing;
+            }
+        }
+        visibleStale = false;
+    }
+    return visible;
+}
+
+RowBitmap AutoFilter::evaluate(const DataSnapshot& snapshot, uint32_t column, const ColumnFilter& filter) const {
+    std::vector<CellData> cells = snapshot.getColumnCells(sheetName, column, range.first.row, range.last.row);
+    const uint32_t rowCount = static_cast<uint32_t>(cells.size());
+    if (filter.conditions.empty()) {
+        return RowBitmap(rowCount, true);
+    }
+
+    std::vector<PreparedCondition> conditions(filter.conditions.begin(), filter.conditions.end());
+    const bool needsText = std::any_of(filter.conditions.begin(), filter.conditions.end(),
+                                       [](const FilterCondition& condition) { return usesText(condition.op); });
+
+    // Case-folded display text, computed once per distinct string
+    std::unordered_map<StringId, std::string> foldedTexts;
+    std::string folded;
+
+    RowBitmap passing(rowCount, false);
+    for (uint32_t row = 0; row < rowCount; ++row) {
+        const CellData& cell = cells[row];
+        if (needsText) {
+            if (cell.getType() == CellData::Text) {
+                auto it = foldedTexts.find(cell.getTextId());
+                if (it == foldedTexts.end()) {
+                    it = foldedTexts.emplace(cell.getTextId(), foldCase(snapshot.getText(cell.getTextId()))).first;
+                }
+                folded = it->second;
+            } else {
+                folded = foldCase(snapshot.getDisplayText(cell));
+            }
+        }
+
+        bool pass = !filter.matchAny;
+        for (const PreparedCondition& condition : conditions) {
+            if (condition.matches(cell, folded) == filter.matchAny) {
+                pass = filter.matchAny;
+                break;
+            }
+        }
+        if (pass) {
+            passing.set(row);
+        }
+    }
+    return passing;
+}
@@ -0,0 +1,134 @@
+#ifndef AUTO_FILTER_H
+#define AUTO_FILTER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <mutex>
+#include "src/core/data/DataStore.h"
+
+// One bit per row of a filter range; bit set means the row passes
+class RowBitmap {
+public:
+    RowBitmap() = default;
+    // Creates a bitmap of rowCount rows, all set or all clear
+    RowBitmap(uint32_t rowCount, bool value);
+
+    uint32_t size() const { return rowCount; }
+    bool test(uint32_t row) const { return (words[row / 64] >> (row % 64)) & 1; }
+    void set(uint32_t row) { words[row / 64] |= uint64_t(1) << (row % 64); }
+    void reset(uint32_t row) { words[row / 64] &= ~(uint64_t(1) << (row % 64)); }
+
+    // Number of set rows
+    uint32_t count() const;
+
+    // Word-wise combination with a bitmap of the same size
+    RowBitmap& operator&=(const RowBitmap& other);
+    RowBitmap& operator|=(const RowBitmap& other);
+    // Flips every row
+    void flip();
+
+    // Calls visit(row) for every set row in ascending order
+    template <typename Visitor>
+    void forEachSet(Visitor visit) const {
+        for (size_t word = 0; word < words.size(); ++word) {
+            for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1) {
+                visit(static_cast<uint32_t>(word * 64 + __builtin_ctzll(bits)));
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> words;
+    uint32_t rowCount = 0;
+
+    // Clears the bits past rowCount in the last word
+    void trimTail();
+};
+
+// One condition on the values of a column
+struct FilterCondition {
+    enum Operator {
+        Equals,          // Display text equals text, case-insensitively
+        NotEquals,
+        Greater,         // Numeric comparisons match only numbers
+        GreaterOrEqual,
+        Less,
+        LessOrEqual,
+        BeginsWith,      // Text comparisons work on display text, case-insensitively
+        EndsWith,
+        Contains,
+        Blank,
+        NonBlank,
+        InList           // Display text is one of values (the checkbox list)
+    };
+
+    Operator op = Equals;
+    double number = 0.0;
+    std::string text;
+    std::vector<std::string> values;
+};
+
+// Criteria of one column: rows pass when all (or, with matchAny, any) conditions hold
+struct ColumnFilter {
+    std::vector<FilterCondition> conditions;
+    bool matchAny = false;
+};
+
+// Autofilter over the data rows of a range. Each column's criteria are evaluated once, against
+// a snapshot, into a row bitmap; the visible rows are the AND of the enabled column bitmaps.
+// Toggling a column or changing another column's criteria is bitmap work only, and
+// hidden-row queries read the combined bitmap.
+class AutoFilter {
+public:
+    // range excludes the header row, e.g. "Sheet1!A2:F100000"
+    AutoFilter(DataStore* store, const std::string& qualifiedRange);
+
+    // Sets the criteria of a sheet column inside the range and evaluates them
+    void setFilter(uint32_t column, const ColumnFilter& filter);
+
+    // Removes a column's criteria
+    void clearFilter(uint32_t column);
+
+    // Turns a column's criteria off or back on without evaluating them again
+    void setFilterEnabled(uint32_t column, bool enabled);
+
+    // Evaluates every column's criteria again against the latest data
+    void refresh();
+
+    // Rows of the range (0 = first data row) that pass every enabled filter
+    RowBitmap getVisibleRows() const;
+
+    // Returns true if a row of the range is filtered out
+    bool isRowHidden(uint32_t row) const;
+
+    // Number of rows that pass
+    uint32_t getVisibleCount() const;
+
+private:
+    struct ColumnState {
+        ColumnFilter filter;
+        RowBitmap passing;
+        bool enabled = true;
+    };
+
+    DataStore* dataStore;
+    std::string sheetName;
+    CellRange range;
+    std::map<uint32_t, ColumnState> columns;
+    // AND of the enabled columns; rebuilt on demand after a change
+    mutable RowBitmap visible;
+    mutable bool visibleStale;
+    mutable std::mutex filterMutex;
+
+    RowBitmap evaluate(const DataSnapshot& snapshot, uint32_t column, const ColumnFilter& filter) const;
+    const RowBitmap& visibleRows() const;
+};
+
+// Human tasks:
+// - Add top/bottom N, above/below average and date-period filters
+// - Filter by cell color and icon set
+// - Re-evaluate only the rows reported by the change journal on refresh
+
+#endif // AUTO_FILTER_H
@@ -0,0 +1,71 @@
+#ifndef BYTE_READER_H
+#define BYTE_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+// Bounds-checked reader over a byte range, shared by the workbook file formats. A read that
+// runs past the end throws std::runtime_error with the message given at construction.
+class ByteReader {
+public:
+    ByteReader(const unsigned char* bytes, size_t length, const char* truncatedError = "Corrupt workbook file: truncated data")
+        : data(bytes), size(length), truncatedError(truncatedError) {}
+
+    // Little-endian integers, whatever the host byte order
+    uint32_t u32() { return static_cast<uint32_t>(readLittleEndian(4)); }
+    uint64_t u64() { return readLittleEndian(8); }
+
+    // Plain values in host byte order
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are read as bytes");
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void getArray(T* values, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain values are read as bytes");
+        std::memcpy(values, take(count * sizeof(T)), count * sizeof(T));
+    }
+
+    // The next length bytes as text
+    std::string_view text(size_t length) {
+        return std::string_view(reinterpret_cast<const char*>(take(length)), length);
+    }
+
+    // Text prefixed by its host-order u32 size
+    std::string_view text() { return text(get<uint32_t>()); }
+
+    // Skips length bytes and returns where they start
+    const unsigned char* take(size_t length) {
+        if (length > size - position) {
+            throw std::runtime_error(truncatedError);
+        }
+        const unsigned char* bytes = data + position;
+        position += length;
+        return bytes;
+    }
+
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t position = 0;
+    const char* truncatedError;
+
+    uint64_t readLittleEndian(size_t bytes) {
+        const unsigned char* start = take(bytes);
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(start[i]) << (8 * i);
+        }
+        return value;
+    }
+};
+
+#endif // BYTE_READER_H
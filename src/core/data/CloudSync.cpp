@@ -13,7 +13,8 @@ CloudSync::CloudSync(DataStore* store, const std::string& provider, const std::s
       cloudProvider(provider),
       authToken(token),
       syncInterval(std::chrono::seconds(intervalSeconds)),
-      isSyncing(false) {
+      isSyncing(false),
+      uploadedSequence(0) {
     // Initialization complete
 }
 
@@ -59,16 +60,76 @@ void CloudSync::syncWorkbook() {
 
 // Upload changes to cloud storage
 bool CloudSync::uploadChanges() {
-    // Get local changes from DataStore
-    auto changes = dataStore->getChanges();
+    // Get local changes since the last successful upload, one entry per cell
+    ChangeBatch batch = dataStore->getChanges(uploadedSequence);
+    DataSnapshot snapshot = dataStore->createSnapshot();
+    if (batch.truncated) {
+        // The journal no longer reaches back that far, so send the whole workbook instead
+        return uploadSnapshot(snapshot);
+    }
+    if (batch.changes.empty()) {
+        return true;
+    }
 
     // Convert changes to JSON format
+    static const char* const kindNames[] = {"cell", "createSheet", "clearSheet", "deleteSheet", "copySheet"};
     Json::Value jsonChanges;
-    for (const auto& change : changes) {
-        // TODO: Implement JSON conversion logic
+    jsonChanges["from"] = Json::UInt64(batch.fromSequence);
+    jsonChanges["to"] = Json::UInt64(batch.toSequence);
+    for (const auto& change : batch.changes) {
+        Json::Value jsonChange;
+        jsonChange["kind"] = kindNames[change.kind];
+        jsonChange["sheet"] = change.sheetName;
+        if (change.kind == DataChange::CellWritten) {
+            jsonChange["cell"] = formatCellAddress(change.cell);
+            jsonChange["value"] = snapshot.getDisplayText(change.value);
+            if (change.value.getFormulaId() != kNoFormula) {
+                jsonChange["formula"] = snapshot.getFormula(change.value.getFormulaId());
+            }
+        } else if (change.kind == DataChange::SheetCopied) {
+            jsonChange["source"] = change.sourceSheetName;
+        }
+        jsonChanges["changes"].append(jsonChange);
+    }
+
+    if (!postJson("/upload", jsonChanges)) {
+        return false;
+    }
+    uploadedSequence = batch.toSequence;
+    return true;
+}
+
+// Upload every sheet as of one snapshot and continue incrementally from its version
+bool CloudSync::uploadSnapshot(const DataSnapshot& snapshot) {
+    Json::Value jsonWorkbook;
+    jsonWorkbook["to"] = Json::UInt64(snapshot.getVersion());
+    for (const auto& sheetName : snapshot.getSheetNames()) {
+        Json::Value jsonSheet;
+        jsonSheet["name"] = sheetName;
+        jsonSheet["cells"] = Json::Value(Json::arrayValue);
+        snapshot.forEachCell(sheetName, [&](const CellAddress& cell, const CellData& data) {
+            Json::Value jsonCell;
+            jsonCell["cell"] = formatCellAddress(cell);
+            jsonCell["value"] = snapshot.getDisplayText(data);
+            if (data.getFormulaId() != kNoFormula) {
+                jsonCell["formula"] = snapshot.getFormula(data.getFormulaId());
+            }
+            jsonSheet["cells"].append(jsonCell);
+        });
+        jsonWorkbook["sheets"].append(jsonSheet);
+    }
+
+    if (!postJson("/upload/full", jsonWorkbook)) {
+        return false;
     }
+    uploadedSequence = snapshot.getVersion();
+    return true;
+}
+
+// POST a JSON document to the cloud provider
+bool CloudSync::postJson(const std::string& path, const Json::Value& body) {
     Json::FastWriter writer;
-    std::string jsonStr = writer.write(jsonChanges);
+    std::string jsonStr = writer.write(body);
 
     // Set up cURL
     CURL* curl = curl_easy_init();
@@ -78,7 +139,7 @@ bool CloudSync::uploadChanges() {
     }
 
     // Set cURL options
-    curl_easy_setopt(curl, CURLOPT_URL, (cloudProvider + "/upload").c_str());
+    curl_easy_setopt(curl, CURLOPT_URL, (cloudProvider + path).c_str());
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, jsonStr.c_str());
     // TODO: Add authentication headers
 
@@ -89,12 +150,7 @@ bool CloudSync::uploadChanges() {
     curl_easy_cleanup(curl);
 
     // Check for errors
-    if (res != CURLE_OK) {
-        // Handle cURL error
-        return false;
-    }
-
-    return true;
+    return res == CURLE_OK;
 }
 
 // Download changes from cloud storage
@@ -152,7 +208,6 @@ bool CloudSync::downloadChanges() {
 // TODO: Add logging for sync stop events
 // TODO: Implement conflict resolution for simultaneous edits
 // TODO: Add retry mechanism for failed sync attempts
-// TODO: Implement bandwidth-efficient delta sync
 // TODO: Implement error handling for API communication failures
 // TODO: Add support for chunked uploads for large datasets
 // TODO: Add support for incremental downloads to reduce data transfer
\ No newline at end of file
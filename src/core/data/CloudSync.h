@@ -7,6 +7,10 @@
 #include <mutex>
 #include "src/core/data/DataStore.h"
 
+namespace Json {
+class Value;
+}
+
 class CloudSync {
 public:
     // Constructor: Initializes the CloudSync with a reference to the DataStore and cloud provider settings
@@ -41,8 +45,24 @@ private:
     std::thread syncThread;
     mutable std::mutex syncMutex;
     bool isSyncing;
+    // Journal sequence up to which local changes have been uploaded
+    uint64_t uploadedSequence;
+
+    // Sync loop run on syncThread
+    void syncWorkbook();
+
+    // Uploads journaled changes since uploadedSequence, or the whole workbook once the
+    // journal no longer reaches back that far; returns false on failure
+    bool uploadChanges();
+
+    // Uploads every sheet of the snapshot and moves uploadedSequence to its version
+    bool uploadSnapshot(const DataSnapshot& snapshot);
+
+    // Posts a JSON document to the provider at path; returns false on failure
+    bool postJson(const std::string& path, const Json::Value& body);
 
-    // Add any private helper methods here
+    // Downloads and applies remote changes; returns false on failure
+    bool downloadChanges();
 };
 
 // Human tasks:
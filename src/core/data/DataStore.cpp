@@ -1,68 +1,890 @@
 #include "DataStore.h"
+#include "src/core/engine/StyleTable.h"
+#include <charconv>
 #include <stdexcept>
 #include <algorithm>
 #include <mutex>
+#include <unordered_set>
+
+namespace {
+
+// Returns a uniquely owned copy of node, cloning it only if an older version still shares it
+template <typename Node>
+Node& makeUnique(std::shared_ptr<Node>& node) {
+    if (!node) {
+        node = std::make_shared<Node>();
+    } else if (node.use_count() > 1) {
+        node = std::make_shared<Node>(*node);
+    }
+    return *node;
+}
+
+using ColumnMap = std::map<uint32_t, std::shared_ptr<ColumnData>>;
+
+// Applies cells to private copies of the columns they touch. Each column is copied from base
+// (or created) once, and its chunks are cloned once, on first write.
+void writeColumns(const SheetData* base, const std::vector<std::pair<CellAddress, CellData>>& cells, ColumnMap& columns) {
+    for (const auto& cell : cells) {
+        const uint32_t col = cell.first.column;
+        auto& column = columns[col];
+        if (!column) {
+            const bool exists = base && col < base->columns.size() && base->columns[col];
+            column = exists ? std::make_shared<ColumnData>(*base->columns[col]) : std::make_shared<ColumnData>();
+        }
+
+        std::shared_ptr<CellChunk>& slot = column->writableSlot(cell.first.row / CellChunk::kChunkRows);
+        CellChunk& chunk = makeUnique(slot);
+        chunk.write(cell.first.row % CellChunk::kChunkRows, cell.second);
+        if (chunk.cellCount == 0) {
+            slot.reset();
+        }
+    }
+}
+
+// Installs written columns into a sheet; a column left without chunks becomes empty
+void storeColumns(SheetData& sheet, ColumnMap& columns) {
+    for (auto& entry : columns) {
+        if (sheet.columns.size() <= entry.first) {
+            sheet.columns.resize(entry.first + 1);
+        }
+        sheet.columns[entry.first] = entry.second->empty() ? nullptr : std::move(entry.second);
+    }
+}
+
+// True if both sheets share every chunk covering range. Chunks are copied on write, so a
+// shared chunk is unchanged; missing sheets and columns count as empty.
+bool sameChunks(const SheetData* a, const SheetData* b, const CellRange& range) {
+    if (a == b) {
+        return true;
+    }
+    auto columnOf = [](const SheetData* sheet, uint32_t col) -> const ColumnData* {
+        return sheet && col < sheet->columns.size() ? sheet->columns[col].get() : nullptr;
+    };
+    auto chunkOf = [](const ColumnData* column, uint32_t chunkIndex) -> const CellChunk* {
+        return column && chunkIndex < column->chunkCount() ? column->chunkAt(chunkIndex) : nullptr;
+    };
+    for (uint32_t col = range.first.column; col <= range.last.column; ++col) {
+        const ColumnData* columnA = columnOf(a, col);
+        const ColumnData* columnB = columnOf(b, col);
+        if (columnA == columnB) {
+            continue;
+        }
+        for (uint32_t chunkIndex = range.first.row / CellChunk::kChunkRows;
+             chunkIndex <= range.last.row / CellChunk::kChunkRows; ++chunkIndex) {
+            if (chunkOf(columnA, chunkIndex) != chunkOf(columnB, chunkIndex)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Brings sheetOrder in line with sheets after an update: deleted sheets drop out and new
+// ones are appended. An update adds or removes at most one sheet, so equal sizes mean the
+// names already match.
+void syncSheetOrder(WorkbookData& root) {
+    if (root.sheetOrder.size() == root.sheets.size()) {
+        return;
+    }
+    auto& order = root.sheetOrder;
+    order.erase(std::remove_if(order.begin(), order.end(),
+                               [&root](const std::string& name) { return root.sheets.count(name) == 0; }),
+                order.end());
+    std::unordered_set<std::string> listed(order.begin(), order.end());
+    for (const auto& sheet : root.sheets) {
+        if (listed.count(sheet.first) == 0) {
+            order.push_back(sheet.first);
+        }
+    }
+}
+
+// Indexed by CellError
+const char* const kErrorText[] = {"#NULL!", "#DIV/0!", "#VALUE!", "#REF!", "#NAME?", "#NUM!", "#N/A"};
+
+} // namespace
+
+const char* errorText(CellError error) {
+    return kErrorText[static_cast<size_t>(error)];
+}
+
+bool parseErrorText(std::string_view text, CellError& error) {
+    for (size_t i = 0; i < sizeof(kErrorText) / sizeof(kErrorText[0]); ++i) {
+        if (text == kErrorText[i]) {
+            error = static_cast<CellError>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const SheetData& SheetData::contents() const {
+    return lazy ? lazy->get() : *this;
+}
+
+const CellChunk* ColumnData::chunkAt(size_t chunkIndex) const {
+    if (chunkIndex < chunks.size() && chunks[chunkIndex]) {
+        return chunks[chunkIndex].get();
+    }
+    return chunkIndex < lazyChunks.size() && lazyChunks[chunkIndex] ? lazyChunks[chunkIndex]->get().get() : nullptr;
+}
+
+std::shared_ptr<CellChunk>& ColumnData::writableSlot(size_t chunkIndex) {
+    if (chunks.size() <= chunkIndex) {
+        chunks.resize(chunkIndex + 1);
+    }
+    if (chunkIndex < lazyChunks.size() && lazyChunks[chunkIndex]) {
+        chunks[chunkIndex] = lazyChunks[chunkIndex]->get();
+        lazyChunks[chunkIndex].reset();
+    }
+    return chunks[chunkIndex];
+}
+
+bool ColumnData::empty() const {
+    auto isSet = [](const auto& slot) { return slot != nullptr; };
+    return std::none_of(chunks.begin(), chunks.end(), isSet) && std::none_of(lazyChunks.begin(), lazyChunks.end(), isSet);
+}
+
+const std::shared_ptr<CellChunk>& LazyChunk::get() {
+    std::call_once(loaded, [this]() {
+        chunk = load();
+        if (chunk && chunk->cellCount == 0) {
+            chunk.reset();
+        }
+        load = nullptr; // Release the source once it has been read
+    });
+    return chunk;
+}
+
+const SheetData& LazySheet::get() {
+    std::call_once(loaded, [this]() {
+        try {
+            sheet = load(*tables);
+        } catch (...) {
+            error = std::current_exception();
+            failed.store(true, std::memory_order_release);
+        }
+        load = nullptr; // Release the source once it has been read
+    });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return *sheet;
+}
+
+// Returns the committed version this snapshot observes
+uint64_t DataSnapshot::getVersion() const {
+    return root ? root->version : 0;
+}
+
+const SheetData* DataSnapshot::findSheet(const std::string& sheetName) const {
+    if (!root) {
+        return nullptr;
+    }
+    auto sheetIt = root->sheets.find(sheetName);
+    return sheetIt != root->sheets.end() ? &sheetIt->second->contents() : nullptr;
+}
+
+const CellChunk* DataSnapshot::findChunk(const std::string& sheetName, const CellAddress& cell) const {
+    const SheetData* sheet = findSheet(sheetName);
+    if (!sheet || cell.column >= sheet->columns.size() || !sheet->columns[cell.column]) {
+        return nullptr;
+    }
+
+    return sheet->columns[cell.column]->chunkAt(cell.row / CellChunk::kChunkRows);
+}
+
+bool DataSnapshot::findCell(const std::string& sheetName, const CellAddress& cell, CellData& data) const {
+    const CellChunk* chunk = findChunk(sheetName, cell);
+    const uint32_t offset = cell.row % CellChunk::kChunkRows;
+    if (!chunk || !chunk->has(offset)) {
+        return false;
+    }
+    data = chunk->read(offset);
+    return true;
+}
+
+CellData DataSnapshot::getCellValue(const std::string& sheetName, const std::string& cellReference) const {
+    CellData data;
+    findCell(sheetName, parseCellAddress(cellReference), data);
+    return data;
+}
+
+std::vector<std::string> DataSnapshot::getSheetNames() const {
+    std::vector<std::string> names;
+    if (root) {
+        names = root->sheetOrder;
+    }
+    return names;
+}
+
+const std::string& DataSnapshot::getText(StringId textId) const {
+    return root->tables->texts.get(textId);
+}
+
+const std::string& DataSnapshot::getFormula(FormulaId formulaId) const {
+    return root->tables->formulas.get(formulaId);
+}
+
+const CellFormat& DataSnapshot::getFormat(StyleId styleId) const {
+    return root->tables->styles->getStyle(styleId);
+}
+
+std::string DataSnapshot::getDisplayText(const CellData& data) const {
+    switch (data.getType()) {
+        case CellData::Number: {
+            char buffer[32];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), data.getNumber());
+            return std::string(buffer, result.ptr);
+        }
+        case CellData::Boolean:
+            return data.getBoolean() ? "TRUE" : "FALSE";
+        case CellData::Text:
+            return getText(data.getTextId());
+        case CellData::Error:
+            return errorText(data.getError());
+        default:
+            return std::string();
+    }
+}
+
+std::vector<std::vector<CellData>> DataSnapshot::getCellRange(const std::string& sheetName, const std::string& startCell, const std::string& endCell) const {
+    CellRange range = parseCellRange(startCell + ":" + endCell);
+
+    std::vector<std::vector<CellData>> result(range.rowCount(), std::vector<CellData>(range.columnCount()));
+    scanRange(sheetName, range, [&result](uint32_t row, uint32_t col, const CellChunk& chunk, uint32_t offset) {
+        result[row][col] = chunk.read(offset);
+    });
+    return result;
+}
+
+std::vector<std::vector<CellData>> DataSnapshot::getCellRange(const std::string& qualifiedRange) const {
+    std::string sheetName;
+    CellRange range;
+    resolveQualifiedRange(qualifiedRange, sheetName, range);
+    return getCellRange(sheetName, formatCellAddress(range.first), formatCellAddress(range.last));
+}
+
+std::vector<std::vector<double>> DataSnapshot::getNumericRange(const std::string& qualifiedRange, double nonNumeric) const {
+    std::string sheetName;
+    CellRange range;
+    resolveQualifiedRange(qualifiedRange, sheetName, range);
+
+    std::vector<std::vector<double>> result(range.rowCount(), std::vector<double>(range.columnCount(), nonNumeric));
+    scanRange(sheetName, range, [&result](uint32_t row, uint32_t col, const CellChunk& chunk, uint32_t offset) {
+        chunk.readNumber(offset, result[row][col]);
+    });
+    return result;
+}
+
+std::vector<CellData> DataSnapshot::getColumnCells(const std::string& sheetName, uint32_t column, uint32_t firstRow, uint32_t lastRow) const {
+    if (lastRow < firstRow) {
+        return {};
+    }
+    CellRange range{CellAddress{firstRow, column}, CellAddress{lastRow, column}};
+    std::vector<CellData> cells(lastRow - firstRow + 1);
+    scanRange(sheetName, range, [&cells](uint32_t row, uint32_t, const CellChunk& chunk, uint32_t offset) {
+        cells[row] = chunk.read(offset);
+    });
+    return cells;
+}
+
+bool DataSnapshot::getUsedRange(const std::string& sheetName, CellRange& range) const {
+    const SheetData* sheet = findSheet(sheetName);
+    if (!sheet) {
+        return false;
+    }
+
+    bool found = false;
+    for (uint32_t col = 0; col < sheet->columns.size(); ++col) {
+        const ColumnData* column = sheet->columns[col].get();
+        if (!column) {
+            continue;
+        }
+        // Rows are bounded by the first and last chunks that hold anything; only those two
+        // are decoded in a lazily opened column
+        const uint32_t chunkCount = static_cast<uint32_t>(column->chunkCount());
+        uint32_t firstChunk = 0;
+        while (firstChunk < chunkCount && !column->chunkAt(firstChunk)) {
+            ++firstChunk;
+        }
+        if (firstChunk == chunkCount) {
+            continue;
+        }
+        uint32_t lastChunk = chunkCount - 1;
+        while (!column->chunkAt(lastChunk)) {
+            --lastChunk;
+        }
+        uint32_t firstOffset = CellChunk::kChunkRows;
+        uint32_t lastOffset = 0;
+        column->chunkAt(firstChunk)->forEachPresent([&firstOffset](uint32_t offset) { firstOffset = std::min(firstOffset, offset); });
+        column->chunkAt(lastChunk)->forEachPresent([&lastOffset](uint32_t offset) { lastOffset = offset; });
+        const uint32_t firstRow = firstChunk * CellChunk::kChunkRows + firstOffset;
+        const uint32_t lastRow = lastChunk * CellChunk::kChunkRows + lastOffset;
+
+        if (!found) {
+            range = CellRange{CellAddress{firstRow, col}, CellAddress{lastRow, col}};
+            found = true;
+        } else {
+            range.first.row = std::min(range.first.row, firstRow);
+            range.last.row = std::max(range.last.row, lastRow);
+            range.last.column = col;
+        }
+    }
+    return found;
+}
+
+void DataSnapshot::resolveQualifiedRange(const std::string& qualifiedRange, std::string& sheetName, CellRange& range) const {
+    std::string cells = qualifiedRange;
+
+    size_t separator = qualifiedRange.rfind('!');
+    if (separator != std::string::npos) {
+        sheetName = qualifiedRange.substr(0, separator);
+        cells = qualifiedRange.substr(separator + 1);
+        // Quoted sheet names: 'My Sheet'!A1:B2
+        if (sheetName.size() >= 2 && sheetName.front() == '\'' && sheetName.back() == '\'') {
+            sheetName = sheetName.substr(1, sheetName.size() - 2);
+        }
+    } else if (root && !root->sheetOrder.empty()) {
+        sheetName = root->sheetOrder.front();
+    }
+
+    range = parseCellRange(cells);
+}
+
+CellData CellChunk::read(uint32_t offset) const {
+    CellData data;
+    data.type = types[offset];
+    if (data.type == CellData::Number || data.type == CellData::Boolean) {
+        data.number = numbers[offset];
+    } else if (data.type == CellData::Text || data.type == CellData::Error) {
+        data.id = ids[offset];
+    }
+    if (!styles.empty()) {
+        data.style = styles[offset];
+    }
+
+    auto formula = std::lower_bound(formulas.begin(), formulas.end(), offset,
+        [](const std::pair<uint32_t, FormulaId>& entry, uint32_t row) { return entry.first < row; });
+    if (formula != formulas.end() && formula->first == offset) {
+        data.formula = formula->second;
+    }
+    return data;
+}
+
+bool CellChunk::readNumber(uint32_t offset, double& number) const {
+    if (types[offset] != CellData::Number) {
+        return false;
+    }
+    number = numbers[offset];
+    return true;
+}
+
+// Writing an empty, unstyled cell without a formula removes it
+void CellChunk::write(uint32_t offset, const CellData& data) {
+    const bool keep = !data.isEmpty() || data.style != kDefaultStyleId || data.formula != kNoFormula;
+    if (keep != has(offset)) {
+        present[offset / 64] ^= uint64_t(1) << (offset % 64);
+        keep ? ++cellCount : --cellCount;
+    }
+
+    types[offset] = keep ? static_cast<uint8_t>(data.type) : static_cast<uint8_t>(CellData::Empty);
+    if (data.type == CellData::Number || data.type == CellData::Boolean) {
+        if (numbers.empty()) {
+            numbers.resize(kChunkRows);
+        }
+        numbers[offset] = data.number;
+    } else if (data.type == CellData::Text || data.type == CellData::Error) {
+        if (ids.empty()) {
+            ids.resize(kChunkRows);
+        }
+        ids[offset] = data.id;
+    }
+
+    if (data.style != kDefaultStyleId && styles.empty()) {
+        styles.resize(kChunkRows, kDefaultStyleId);
+    }
+    if (!styles.empty()) {
+        styles[offset] = keep ? data.style : kDefaultStyleId;
+    }
+
+    auto formula = std::lower_bound(formulas.begin(), formulas.end(), offset,
+        [](const std::pair<uint32_t, FormulaId>& entry, uint32_t row) { return entry.first < row; });
+    const bool found = formula != formulas.end() && formula->first == offset;
+    if (data.formula == kNoFormula) {
+        if (found) {
+            formulas.erase(formula);
+        }
+    } else if (found) {
+        formula->second = data.formula;
+    } else {
+        formulas.insert(formula, std::make_pair(offset, static_cast<FormulaId>(data.formula)));
+    }
+}
 
 // Constructor implementation
-DataStore::DataStore() {
-    // Initialize the sheets map (empty by default)
+DataStore::DataStore(std::shared_ptr<StyleTable> styleTable)
+    : tables(std::make_shared<WorkbookTables>()) {
+    tables->styles = styleTable ? std::move(styleTable) : std::make_shared<StyleTable>();
+    auto root = std::make_shared<WorkbookData>();
+    root->tables = tables;
+    published = std::move(root);
+}
+
+DataStore::DataStore(const DataSnapshot& base) {
+    if (!base.root) {
+        throw std::invalid_argument("Cannot fork an empty snapshot");
+    }
+    tables = base.root->tables;
+    published = base.root;
+    // The fork's journal starts here; earlier changes belong to its origin
+    journalFloor = base.root->version;
+}
+
+std::unique_ptr<DataStore> DataStore::fork() const {
+    return std::make_unique<DataStore>(createSnapshot());
+}
+
+DataStore::~DataStore() {
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        stopLoading = true;
+    }
+    loadAvailable.notify_all();
+    if (loaderThread.joinable()) {
+        loaderThread.join();
+    }
+}
+
+StringId DataStore::internText(const std::string& text) {
+    return tables->texts.intern(text);
+}
+
+FormulaId DataStore::internFormula(const std::string& formula) {
+    FormulaId formulaId = tables->formulas.intern(formula);
+    if (formulaId > kMaxFormulaId) {
+        throw std::length_error("Formula table is full");
+    }
+    return formulaId;
+}
+
+StyleId DataStore::internStyle(const CellFormat& format) {
+    return tables->styles->intern(format);
+}
+
+// Reader pin: copying the published root is the only work done under publishMutex
+DataSnapshot DataStore::createSnapshot() const {
+    return DataSnapshot(latest());
+}
+
+uint64_t DataStore::getVersion() const {
+    return latest()->version;
+}
+
+std::shared_ptr<const WorkbookData> DataStore::latest() const {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    return published;
+}
+
+std::shared_ptr<DataStore::SheetLocks> DataStore::locksFor(const std::string& sheetName) {
+    std::lock_guard<std::mutex> lock(sheetLocksMutex);
+    auto& locks = sheetLocks[sheetName];
+    if (!locks) {
+        locks = std::make_shared<SheetLocks>();
+    }
+    return locks;
+}
+
+// Copy the root (sheet map) and let update edit the copy. Nodes below the root are shared
+// with the previous version, so this stays proportional to the number of sheets. The journal
+// append happens under the same lock, so journal order is commit order.
+template <typename Update>
+void DataStore::publish(Update update, JournalEntry entry) {
+    std::shared_ptr<const WorkbookData> previous;
+    {
+        std::lock_guard<std::mutex> lock(publishMutex);
+        auto root = std::make_shared<WorkbookData>(*published);
+        root->version += 1;
+        update(*root);
+        syncSheetOrder(*root);
+        entry.sequence = root->version;
+        appendToJournal(std::move(entry));
+        previous = std::move(published);
+        published = std::move(root);
+    }
+    // previous is released here, outside publishMutex; if no snapshot pins it, the nodes
+    // only it referenced are reclaimed now, otherwise when its last reader finishes
+}
+
+void DataStore::appendToJournal(JournalEntry entry) {
+    std::lock_guard<std::mutex> lock(journalMutex);
+    journalSize += entry.size();
+    journal.push_back(std::move(entry));
+    trimJournal();
+}
+
+void DataStore::trimJournal() {
+    // The newest commit is always kept, even if it alone exceeds the capacity
+    while (journalSize > journalCapacity && journal.size() > 1) {
+        journalSize -= journal.front().size();
+        journalFloor = journal.front().sequence;
+        journal.pop_front();
+    }
+}
+
+void DataStore::writeCells(const std::string& sheetName, const std::vector<std::pair<CellAddress, CellData>>& cells) {
+    std::shared_ptr<SheetLocks> locks = locksFor(sheetName);
+    std::shared_lock<std::shared_mutex> sheetLock(locks->sheetMutex);
+
+    // Take the column stripes in ascending order so overlapping batches cannot deadlock
+    std::vector<size_t> stripes;
+    stripes.reserve(cells.size());
+    for (const auto& cell : cells) {
+        stripes.push_back(cell.first.column % kColumnStripes);
+    }
+    std::sort(stripes.begin(), stripes.end());
+    stripes.erase(std::unique(stripes.begin(), stripes.end()), stripes.end());
+    std::vector<std::unique_lock<std::mutex>> stripeLocks;
+    stripeLocks.reserve(stripes.size());
+    for (size_t stripe : stripes) {
+        stripeLocks.emplace_back(locks->columnStripes[stripe]);
+    }
+
+    commitCells(sheetName, cells);
+}
+
+void DataStore::commitCells(const std::string& sheetName, const std::vector<std::pair<CellAddress, CellData>>& cells) {
+    JournalEntry entry;
+    entry.kind = DataChange::CellWritten;
+    entry.sheetName = sheetName;
+    entry.cells = std::make_shared<const std::vector<std::pair<CellAddress, CellData>>>(cells);
+
+    // Other writers may publish other columns meanwhile, but the columns written here only
+    // change under the stripes now held, so the latest root has their current contents.
+    // A lazily opened sheet is loaded here if nothing has read it yet.
+    std::shared_ptr<const WorkbookData> base = latest();
+    auto sheetIt = base->sheets.find(sheetName);
+    const SheetData* baseSheet = sheetIt != base->sheets.end() ? &sheetIt->second->contents() : nullptr;
+
+    ColumnMap columns;
+    writeColumns(baseSheet, cells, columns);
+
+    publish([&sheetName, &columns](WorkbookData& root) {
+        auto& sheetNode = root.sheets[sheetName];
+        auto sheet = sheetNode ? std::make_shared<SheetData>(sheetNode->contents()) : std::make_shared<SheetData>();
+        storeColumns(*sheet, columns);
+        sheetNode = std::move(sheet);
+    }, std::move(entry));
 }
 
 // Set the value of a cell in a specific sheet
 void DataStore::setCellValue(const std::string& sheetName, const std::string& cellReference, const CellData& value) {
-    std::lock_guard<std::mutex> lock(dataMutex);
+    writeCells(sheetName, {std::make_pair(parseCellAddress(cellReference), value)});
+}
 
-    // Check if the sheet exists, create it if not
-    if (sheets.find(sheetName) == sheets.end()) {
-        sheets[sheetName] = std::unordered_map<std::string, CellData>();
+// Set many cells and publish them atomically: readers see all of them or none
+void DataStore::setCellValues(const std::string& sheetName, const std::vector<std::pair<std::string, CellData>>& values) {
+    std::vector<std::pair<CellAddress, CellData>> cells;
+    cells.reserve(values.size());
+    for (const auto& entry : values) {
+        cells.emplace_back(parseCellAddress(entry.first), entry.second);
     }
+    writeCells(sheetName, cells);
+}
 
-    // Set the cell value in the appropriate sheet
-    sheets[sheetName][cellReference] = value;
+void DataStore::setCellValues(const std::string& sheetName, const std::vector<std::pair<CellAddress, CellData>>& cells) {
+    writeCells(sheetName, cells);
+}
+
+// Check and commit under the sheet's exclusive lock, so no write lands in between
+bool DataStore::setCellValuesIfUnchanged(const std::string& sheetName, const DataSnapshot& base, const CellRange& guarded,
+                                         const std::vector<std::pair<CellAddress, CellData>>& cells) {
+    if (!base.root) {
+        throw std::invalid_argument("Cannot compare against an empty snapshot");
+    }
+
+    std::shared_ptr<SheetLocks> locks = locksFor(sheetName);
+    std::unique_lock<std::shared_mutex> sheetLock(locks->sheetMutex);
+
+    DataSnapshot current(latest());
+    if (!sameChunks(base.findSheet(sheetName), current.findSheet(sheetName), guarded)) {
+        return false;
+    }
+    if (!cells.empty()) {
+        commitCells(sheetName, cells);
+    }
+    return true;
+}
+
+void DataStore::updateCells(const std::string& sheetName,
+                            const std::function<std::vector<std::pair<CellAddress, CellData>>(const DataSnapshot&)>& derive) {
+    std::shared_ptr<SheetLocks> locks = locksFor(sheetName);
+    std::unique_lock<std::shared_mutex> sheetLock(locks->sheetMutex);
+
+    std::vector<std::pair<CellAddress, CellData>> cells = derive(DataSnapshot(latest()));
+    if (!cells.empty()) {
+        commitCells(sheetName, cells);
+    }
 }
 
 // Retrieve the value of a cell from a specific sheet
 CellData DataStore::getCellValue(const std::string& sheetName, const std::string& cellReference) {
-    std::lock_guard<std::mutex> lock(dataMutex);
+    return createSnapshot().getCellValue(sheetName, cellReference);
+}
+
+void DataStore::createSheet(const std::string& sheetName) {
+    if (latest()->sheets.count(sheetName) > 0) {
+        return;
+    }
+    publish([&sheetName](WorkbookData& root) {
+        auto& sheetNode = root.sheets[sheetName];
+        if (!sheetNode) {
+            sheetNode = std::make_shared<SheetData>();
+        }
+    }, JournalEntry{0, DataChange::SheetCreated, sheetName, nullptr, std::string()});
+}
+
+void DataStore::openLazySheets(std::vector<std::pair<std::string, LazySheet::Loader>> directory) {
+    std::vector<std::pair<std::string, LazySheet::SheetLoader>> sheets;
+    sheets.reserve(directory.size());
+    for (auto& entry : directory) {
+        sheets.emplace_back(std::move(entry.first), [load = std::move(entry.second)](WorkbookTables& tables) {
+            ColumnMap columns;
+            load(tables, [&columns](const LazySheet::CellBatch& cells) { writeColumns(nullptr, cells, columns); });
+            auto contents = std::make_shared<SheetData>();
+            storeColumns(*contents, columns);
+            return std::shared_ptr<const SheetData>(std::move(contents));
+        });
+    }
+    openLazySheets(std::move(sheets), true);
+}
+
+void DataStore::openLazySheets(std::vector<std::pair<std::string, LazySheet::SheetLoader>> directory, bool loadInBackground) {
+    std::vector<std::shared_ptr<LazySheet>> opened;
+    for (auto& entry : directory) {
+        auto lazy = std::make_shared<LazySheet>();
+        lazy->load = std::move(entry.second);
+        lazy->tables = tables;
+        auto placeholder = std::make_shared<SheetData>();
+        placeholder->lazy = lazy;
+        opened.push_back(std::move(lazy));
+
+        std::shared_ptr<SheetLocks> locks = locksFor(entry.first);
+        std::unique_lock<std::shared_mutex> sheetLock(locks->sheetMutex);
+        publish([&entry, &placeholder](WorkbookData& root) { root.sheets[entry.first] = std::move(placeholder); },
+                JournalEntry{0, DataChange::SheetCreated, entry.first, nullptr, std::string()});
+    }
+    if (!loadInBackground) {
+        return;
+    }
 
-    // Check if the sheet exists
-    auto sheetIt = sheets.find(sheetName);
-    if (sheetIt != sheets.end()) {
-        // Check if the cell exists in the sheet
-        auto cellIt = sheetIt->second.find(cellReference);
-        if (cellIt != sheetIt->second.end()) {
-            return cellIt->second;
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        loadQueue.insert(loadQueue.end(), opened.begin(), opened.end());
+        if (!loaderThread.joinable()) {
+            loaderThread = std::thread(&DataStore::loaderLoop, this);
         }
     }
+    loadAvailable.notify_one();
+}
+
+void DataStore::waitForSheets() {
+    std::shared_ptr<const WorkbookData> root = latest();
+    for (const auto& sheet : root->sheets) {
+        sheet.second->contents();
+    }
+}
+
+std::vector<std::pair<std::string, std::exception_ptr>> DataStore::getLoadErrors() const {
+    std::vector<std::pair<std::string, std::exception_ptr>> errors;
+    std::shared_ptr<const WorkbookData> root = latest();
+    for (const auto& sheet : root->sheets) {
+        const std::shared_ptr<LazySheet>& lazy = sheet.second->lazy;
+        if (lazy && lazy->failed.load(std::memory_order_acquire)) {
+            errors.emplace_back(sheet.first, lazy->error);
+        }
+    }
+    return errors;
+}
+
+// Works through the load queue in order; sheets already read on demand are skipped by the
+// once flag. A failed load is recorded on its sheet, which rethrows it on every access and
+// reports it through getLoadErrors.
+void DataStore::loaderLoop() {
+    std::unique_lock<std::mutex> lock(loadMutex);
+    while (true) {
+        loadAvailable.wait(lock, [this]() { return stopLoading || !loadQueue.empty(); });
+        if (stopLoading) {
+            return;
+        }
+        std::shared_ptr<LazySheet> next = std::move(loadQueue.front());
+        loadQueue.pop_front();
+        lock.unlock();
+        try {
+            next->get();
+        } catch (...) {
+            // Recorded on the sheet; keep loading the others
+        }
+        next.reset();
+        lock.lock();
+    }
+}
+
+bool DataStore::duplicateSheet(const std::string& sourceName, const std::string& newName) {
+    if (sourceName == newName) {
+        return false;
+    }
+
+    // Keep the source stable and the target unwritten; take the two sheet locks in name order
+    std::shared_ptr<SheetLocks> sourceLocks = locksFor(sourceName);
+    std::shared_ptr<SheetLocks> targetLocks = locksFor(newName);
+    std::shared_lock<std::shared_mutex> sourceLock(sourceLocks->sheetMutex, std::defer_lock);
+    std::unique_lock<std::shared_mutex> targetLock(targetLocks->sheetMutex, std::defer_lock);
+    if (sourceName < newName) {
+        sourceLock.lock();
+        targetLock.lock();
+    } else {
+        targetLock.lock();
+        sourceLock.lock();
+    }
 
-    // Return a default CellData if not found
-    return CellData();
+    std::shared_ptr<const WorkbookData> base = latest();
+    if (base->sheets.count(sourceName) == 0 || base->sheets.count(newName) > 0) {
+        return false;
+    }
+
+    // Both names now refer to one immutable node; the first write to either copies the
+    // columns and chunks it touches
+    JournalEntry entry{0, DataChange::SheetCopied, newName, nullptr, sourceName};
+    publish([&sourceName, &newName](WorkbookData& root) { root.sheets[newName] = root.sheets.at(sourceName); },
+            std::move(entry));
+    return true;
 }
 
 // Clear all data from a specific sheet
 void DataStore::clearSheet(const std::string& sheetName) {
-    std::lock_guard<std::mutex> lock(dataMutex);
+    // Waits only for in-flight writers of this sheet
+    std::shared_ptr<SheetLocks> locks = locksFor(sheetName);
+    std::unique_lock<std::shared_mutex> sheetLock(locks->sheetMutex);
 
-    // Check if the sheet exists
-    auto sheetIt = sheets.find(sheetName);
-    if (sheetIt != sheets.end()) {
-        // Clear all cell data from the sheet
-        sheetIt->second.clear();
-    }
+    // Replace the sheet node; snapshots still holding the old one keep their data
+    publish([&sheetName](WorkbookData& root) {
+        auto sheetIt = root.sheets.find(sheetName);
+        if (sheetIt != root.sheets.end()) {
+            sheetIt->second = std::make_shared<SheetData>();
+        }
+    }, JournalEntry{0, DataChange::SheetCleared, sheetName, nullptr, std::string()});
 }
 
 // Delete a specific sheet from the data store
 bool DataStore::deleteSheet(const std::string& sheetName) {
-    std::lock_guard<std::mutex> lock(dataMutex);
+    std::shared_ptr<SheetLocks> locks = locksFor(sheetName);
+    std::unique_lock<std::shared_mutex> sheetLock(locks->sheetMutex);
 
     // Check if the sheet exists and remove it
-    auto sheetIt = sheets.find(sheetName);
-    if (sheetIt != sheets.end()) {
-        sheets.erase(sheetIt);
-        return true;
+    if (latest()->sheets.count(sheetName) == 0) {
+        return false;
     }
+    publish([&sheetName](WorkbookData& root) { root.sheets.erase(sheetName); },
+            JournalEntry{0, DataChange::SheetDeleted, sheetName, nullptr, std::string()});
+    return true;
+}
 
-    return false;
+std::vector<std::string> DataStore::getSheetNames() {
+    return createSnapshot().getSheetNames();
+}
+
+std::vector<std::vector<CellData>> DataStore::getCellRange(const std::string& sheetName, const std::string& startCell, const std::string& endCell) {
+    return createSnapshot().getCellRange(sheetName, startCell, endCell);
+}
+
+std::vector<std::vector<CellData>> DataStore::getCellRange(const std::string& qualifiedRange) {
+    return createSnapshot().getCellRange(qualifiedRange);
+}
+
+ChangeBatch DataStore::getChanges(uint64_t sinceSequence, bool coalesce) const {
+    // Pin the entries under the lock and expand them outside it; their cells are immutable
+    ChangeBatch batch;
+    batch.fromSequence = sinceSequence;
+    std::vector<JournalEntry> entries;
+    {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        batch.toSequence = journal.empty() ? journalFloor : journal.back().sequence;
+        if (sinceSequence < journalFloor) {
+            batch.truncated = true;
+            return batch;
+        }
+        auto first = std::upper_bound(journal.begin(), journal.end(), sinceSequence,
+            [](uint64_t sequence, const JournalEntry& entry) { return sequence < entry.sequence; });
+        entries.assign(first, journal.end());
+    }
+    batch.toSequence = std::max(batch.toSequence, sinceSequence);
+
+    auto toChange = [](const JournalEntry& entry) {
+        DataChange change;
+        change.sequence = entry.sequence;
+        change.kind = entry.kind;
+        change.sheetName = entry.sheetName;
+        change.sourceSheetName = entry.sourceSheetName;
+        return change;
+    };
+
+    if (!coalesce) {
+        for (const auto& entry : entries) {
+            if (!entry.cells) {
+                batch.changes.push_back(toChange(entry));
+                continue;
+            }
+            for (const auto& cell : *entry.cells) {
+                DataChange change = toChange(entry);
+                change.cell = cell.first;
+                change.value = cell.second;
+                batch.changes.push_back(std::move(change));
+            }
+        }
+        return batch;
+    }
+
+    // Walk newest to oldest: the first write seen for a cell is its last one, and a clear,
+    // delete or copy onto a sheet hides every older write to that sheet. A copy reads its
+    // source, so source writes from before it are deduplicated separately from later ones.
+    // Sheet events are all kept.
+    std::unordered_map<std::string, std::unordered_set<uint64_t>> written;
+    std::unordered_set<std::string> reset;
+    for (auto entry = entries.rbegin(); entry != entries.rend(); ++entry) {
+        if (!entry->cells) {
+            if (entry->kind != DataChange::SheetCreated) {
+                reset.insert(entry->sheetName);
+            }
+            if (entry->kind == DataChange::SheetCopied) {
+                written.erase(entry->sourceSheetName);
+                reset.erase(entry->sourceSheetName);
+            }
+            batch.changes.push_back(toChange(*entry));
+            continue;
+        }
+        if (reset.count(entry->sheetName) > 0) {
+            continue;
+        }
+        auto& sheetWritten = written[entry->sheetName];
+        for (auto cell = entry->cells->rbegin(); cell != entry->cells->rend(); ++cell) {
+            const uint64_t key = (static_cast<uint64_t>(cell->first.row) << 32) | cell->first.column;
+            if (!sheetWritten.insert(key).second) {
+                continue;
+            }
+            DataChange change = toChange(*entry);
+            change.cell = cell->first;
+            change.value = cell->second;
+            batch.changes.push_back(std::move(change));
+        }
+    }
+    std::reverse(batch.changes.begin(), batch.changes.end());
+    return batch;
+}
+
+void DataStore::setJournalCapacity(size_t maxChanges) {
+    std::lock_guard<std::mutex> lock(journalMutex);
+    journalCapacity = maxChanges;
+    trimJournal();
 }
 
 // Human tasks (commented):
@@ -71,9 +893,8 @@ TODO: Implement data validation before setting cell value
 TODO: Add support for undo/redo operations
 TODO: Implement notification mechanism for cell value changes
 TODO: Implement caching mechanism for frequently accessed cell values
-TODO: Add support for retrieving ranges of cell values efficiently
 TODO: Implement undo/redo support for sheet clearing
 TODO: Add option to clear specific data types (e.g., values, formats, formulas)
 TODO: Implement safeguards against accidental sheet deletion
 TODO: Add support for archiving deleted sheets for potential recovery
-*/
\ No newline at end of file
+*/
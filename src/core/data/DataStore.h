@@ -2,35 +2,573 @@
 #define DATASTORE_H
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <map>
+#include <deque>
+#include <memory>
 #include <mutex>
-#include <variant>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
 #include <vector>
+#include <cstdint>
+#include <algorithm>
 #include "src/core/engine/FormattingEngine.h"
+#include "src/core/engine/CellAddress.h"
+#include "src/core/data/StringTable.h"
 
-// Represents the data stored in a single cell
+class StyleTable;
+
+// Spreadsheet error values, carried inline by error cells
+enum class CellError : uint8_t {
+    Null,
+    DivideByZero,
+    Value,
+    Reference,
+    Name,
+    Number,
+    NotAvailable
+};
+
+// Returns the text of an error value, e.g. "#DIV/0!"
+const char* errorText(CellError error);
+
+// Sets error and returns true if text is exactly the text of an error value
+bool parseErrorText(std::string_view text, CellError& error);
+
+// Identifier of a formula text interned in the workbook formula table; 0 means no formula.
+// Formula IDs share the cell's last word with the type tag, which leaves them 24 bits.
+using FormulaId = uint32_t;
+constexpr FormulaId kNoFormula = 0;
+constexpr FormulaId kMaxFormulaId = (1u << 24) - 1;
+
+// Represents the data stored in a single cell as a compact 16-byte tagged record.
+// Numbers and booleans are inline; text, formulas and formats live in the workbook's shared
+// StringTable/StyleTable side tables and are referenced by ID, so a plain number costs no
+// more than the record itself.
 struct CellData {
-    std::variant<std::string, double, bool> value;
-    std::string formula;
-    CellFormat format;
+    enum Type : uint8_t { Empty = 0, Number, Boolean, Text, Error };
+
+    CellData() : number(0.0), style(kDefaultStyleId), type(Empty), formula(kNoFormula) {}
+
+    static CellData fromNumber(double value, StyleId styleId = kDefaultStyleId) {
+        CellData cell(Number, styleId);
+        cell.number = value;
+        return cell;
+    }
+    static CellData fromBoolean(bool value, StyleId styleId = kDefaultStyleId) {
+        CellData cell(Boolean, styleId);
+        cell.number = value ? 1.0 : 0.0;
+        return cell;
+    }
+    static CellData fromText(StringId textId, StyleId styleId = kDefaultStyleId) {
+        CellData cell(Text, styleId);
+        cell.id = textId;
+        return cell;
+    }
+    static CellData fromError(CellError error, StyleId styleId = kDefaultStyleId) {
+        CellData cell(Error, styleId);
+        cell.id = static_cast<uint32_t>(error);
+        return cell;
+    }
+
+    Type getType() const { return static_cast<Type>(type); }
+    bool isEmpty() const { return type == Empty; }
+    double getNumber() const { return number; }
+    bool getBoolean() const { return number != 0.0; }
+    StringId getTextId() const { return id; }
+    CellError getError() const { return static_cast<CellError>(id); }
+    FormulaId getFormulaId() const { return formula; }
+    StyleId getStyleId() const { return style; }
+
+    // Numbers as-is, booleans as 0/1, anything else 0
+    double getNumericValue() const { return (type == Number || type == Boolean) ? number : 0.0; }
+
+    // Number or Boolean payload, or a StringId / CellError for Text and Error cells
+    union {
+        double number;
+        uint32_t id;
+    };
+    StyleId style;
+    uint32_t type : 8;
+    uint32_t formula : 24;
+
+private:
+    CellData(Type cellType, StyleId styleId) : number(0.0), style(styleId), type(cellType), formula(kNoFormula) {}
+};
+
+static_assert(sizeof(CellData) == 16, "CellData must stay a 16-byte record");
+
+// Append-only side tables shared by every version of a workbook
+struct WorkbookTables {
+    StringTable texts;
+    StringTable formulas;
+    std::shared_ptr<StyleTable> styles;
+};
+
+// Versioned storage nodes. A workbook version is a tree of reference-counted nodes:
+// workbook -> sheets -> columns -> row chunks. Writers copy only the path to the node they
+// change (copy-on-write) and share everything else with older versions, which stay
+// immutable for as long as a snapshot holds them.
+
+// kChunkRows consecutive rows of one column, stored column-major as typed lanes indexed by
+// row offset. A null bitmap marks populated rows, so scans skip empty runs a word at a time.
+// Payload and style lanes are allocated on first use; formulas are rare and kept in a sparse
+// side list.
+struct CellChunk {
+    static constexpr uint32_t kChunkRows = 256;
+    static constexpr uint32_t kWords = kChunkRows / 64;
+
+    uint64_t present[kWords] = {};
+    uint32_t cellCount = 0;
+    uint8_t types[kChunkRows] = {};
+    // Number and Boolean payloads
+    std::vector<double> numbers;
+    // Text StringIds and CellError codes
+    std::vector<uint32_t> ids;
+    // Allocated once any cell in the chunk has a non-default style
+    std::vector<StyleId> styles;
+    // (row offset, formula) sorted by row offset
+    std::vector<std::pair<uint32_t, FormulaId>> formulas;
+
+    bool has(uint32_t offset) const { return (present[offset / 64] >> (offset % 64)) & 1; }
+
+    // Assembles the compact cell at a populated row offset
+    CellData read(uint32_t offset) const;
+
+    // Returns true and sets number if the cell holds a number
+    bool readNumber(uint32_t offset, double& number) const;
+
+    void write(uint32_t offset, const CellData& data);
+
+    // Calls visit(offset) for every populated row offset in ascending order
+    template <typename Visitor>
+    void forEachPresent(Visitor visit) const {
+        for (uint32_t word = 0; word < kWords; ++word) {
+            for (uint64_t bits = present[word], bit = 0; bits != 0; bits >>= 1, ++bit) {
+                if (bits & 1) {
+                    visit(static_cast<uint32_t>(word * 64 + bit));
+                }
+            }
+        }
+    }
 };
 
-// Manages in-memory data storage and retrieval for Excel spreadsheets
+struct LazyChunk;
+
+// Row chunks of one column, indexed by row / kChunkRows; null entries are empty chunks.
+// A column opened from a file may hold chunks that are decoded on first access: their slot in
+// chunks stays null and lazyChunks holds their loader. Read chunks through chunkAt.
+struct ColumnData {
+    std::vector<std::shared_ptr<CellChunk>> chunks;
+    std::vector<std::shared_ptr<LazyChunk>> lazyChunks;
+
+    size_t chunkCount() const { return std::max(chunks.size(), lazyChunks.size()); }
+
+    // Returns a chunk, decoding it first if it is lazy; nullptr for an empty chunk
+    const CellChunk* chunkAt(size_t chunkIndex) const;
+
+    // Returns the slot of a chunk about to be written, decoding a lazy chunk into it first;
+    // the decoded chunk stays shared, so copy-on-write clones it before the write
+    std::shared_ptr<CellChunk>& writableSlot(size_t chunkIndex);
+
+    // True if the column holds no chunk, decoded or not
+    bool empty() const;
+};
+
+// One row chunk of a column whose contents are decoded on first access, by whichever reader
+// or writer comes first
+struct LazyChunk {
+    using Loader = std::function<std::shared_ptr<CellChunk>()>;
+
+    Loader load;
+    std::once_flag loaded;
+    std::shared_ptr<CellChunk> chunk;
+
+    // Concurrent callers wait for the first; if load throws, the next access retries it.
+    // A chunk that decodes to no cells comes back null.
+    const std::shared_ptr<CellChunk>& get();
+};
+
+struct LazySheet;
+
+// Columns of one sheet, indexed by column number; null entries are empty columns
+struct SheetData {
+    std::vector<std::shared_ptr<ColumnData>> columns;
+    // Set on the placeholder of a sheet opened lazily; its columns live in lazy once read
+    std::shared_ptr<LazySheet> lazy;
+
+    // Returns the sheet with its contents, materializing a lazy sheet first
+    const SheetData& contents() const;
+};
+
+// Contents of a sheet whose cells are read on first access. load runs once, on whichever
+// comes first: a reader of any version, a writer, or the store's background loader. It
+// interns text into the tables it is given, which outlive the store as long as a snapshot does.
+struct LazySheet {
+    using CellBatch = std::vector<std::pair<CellAddress, CellData>>;
+    // Receives the decoded cells a batch at a time, so a loader need not hold the whole sheet
+    using BatchSink = std::function<void(const CellBatch& cells)>;
+    using Loader = std::function<void(WorkbookTables& tables, const BatchSink& sink)>;
+    // Builds the finished sheet in one go, for sources already laid out in chunks
+    using SheetLoader = std::function<std::shared_ptr<const SheetData>(WorkbookTables& tables)>;
+
+    SheetLoader load;
+    std::shared_ptr<WorkbookTables> tables;
+    std::once_flag loaded;
+    std::shared_ptr<const SheetData> sheet;
+    // Set once load has thrown; error is written before failed and never changes after
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+
+    // Concurrent callers wait for the first. A failed load is not retried: every access,
+    // including the first, rethrows its error.
+    const SheetData& get();
+};
+
+// Root of a workbook version
+struct WorkbookData {
+    uint64_t version = 0;
+    std::map<std::string, std::shared_ptr<SheetData>> sheets;
+    // Names of sheets in tab order: creation order, or file order for opened workbooks
+    std::vector<std::string> sheetOrder;
+    std::shared_ptr<WorkbookTables> tables;
+};
+
+// Immutable, consistent view of the workbook at one committed version.
+// Creating one is O(1); reads never block writers and never see torn state.
+// The version's memory is reclaimed when the last snapshot referencing it is destroyed.
+// Reading a lazily opened sheet that is not loaded yet blocks until it is.
+class DataSnapshot {
+public:
+    DataSnapshot() = default;
+    explicit DataSnapshot(std::shared_ptr<const WorkbookData> data) : root(std::move(data)) {}
+
+    // Returns the committed version this snapshot observes
+    uint64_t getVersion() const;
+
+    // Retrieves the value of a cell, or a default CellData if it is empty
+    CellData getCellValue(const std::string& sheetName, const std::string& cellReference) const;
+
+    // Returns true and fills data if the cell is populated
+    bool findCell(const std::string& sheetName, const CellAddress& cell, CellData& data) const;
+
+    // Retrieves a list of all sheet names, in tab order
+    std::vector<std::string> getSheetNames() const;
+
+    // Side-table lookups for the IDs carried by CellData
+    const std::string& getText(StringId textId) const;
+    const std::string& getFormula(FormulaId formulaId) const;
+    const CellFormat& getFormat(StyleId styleId) const;
+
+    // Renders a cell's value as text: shortest round-trip numbers, TRUE/FALSE, #DIV/0! etc.
+    std::string getDisplayText(const CellData& data) const;
+
+    // Retrieves a rectangular block of cells, row-major
+    std::vector<std::vector<CellData>> getCellRange(const std::string& sheetName, const std::string& startCell, const std::string& endCell) const;
+
+    // Retrieves a block given as "Sheet1!A1:C10"; without a sheet prefix the first sheet is used
+    std::vector<std::vector<CellData>> getCellRange(const std::string& qualifiedRange) const;
+
+    // Retrieves a block as numbers, row-major; blank and non-numeric cells become nonNumeric.
+    // Reads the number lanes column by column without materializing cells.
+    std::vector<std::vector<double>> getNumericRange(const std::string& qualifiedRange, double nonNumeric) const;
+
+    // Retrieves rows firstRow..lastRow of one column; blank cells are Empty
+    std::vector<CellData> getColumnCells(const std::string& sheetName, uint32_t column, uint32_t firstRow, uint32_t lastRow) const;
+
+    // Sets range to the smallest block holding every populated cell of a sheet; returns
+    // false if the sheet is empty or missing
+    bool getUsedRange(const std::string& sheetName, CellRange& range) const;
+
+    // Splits "Sheet1!A1:C10" into a sheet name and range; defaults to the first sheet in
+    // tab order
+    void resolveQualifiedRange(const std::string& qualifiedRange, std::string& sheetName, CellRange& range) const;
+
+    // Calls visit(address, cellData) for every populated cell of a sheet, column by column
+    template <typename Visitor>
+    void forEachCell(const std::string& sheetName, Visitor visit) const {
+        const SheetData* sheet = findSheet(sheetName);
+        if (!sheet) {
+            return;
+        }
+        for (uint32_t col = 0; col < sheet->columns.size(); ++col) {
+            const ColumnData* column = sheet->columns[col].get();
+            if (!column) {
+                continue;
+            }
+            for (uint32_t chunkIndex = 0; chunkIndex < column->chunkCount(); ++chunkIndex) {
+                const CellChunk* chunk = column->chunkAt(chunkIndex);
+                if (!chunk) {
+                    continue;
+                }
+                chunk->forEachPresent([&](uint32_t offset) {
+                    visit(CellAddress{chunkIndex * CellChunk::kChunkRows + offset, col}, chunk->read(offset));
+                });
+            }
+        }
+    }
+
+    // Calls visit(address, cellData) for every populated cell of a range, column by column
+    template <typename Visitor>
+    void forEachCellInRange(const std::string& sheetName, const CellRange& range, Visitor visit) const {
+        scanRange(sheetName, range, [&](uint32_t row, uint32_t col, const CellChunk& chunk, uint32_t offset) {
+            visit(CellAddress{range.first.row + row, range.first.column + col}, chunk.read(offset));
+        });
+    }
+
+    // Calls visit(column, chunkIndex, chunk) for every stored chunk of a sheet, column by
+    // column; chunks hold rows chunkIndex * CellChunk::kChunkRows onwards
+    template <typename Visitor>
+    void forEachChunk(const std::string& sheetName, Visitor visit) const {
+        const SheetData* sheet = findSheet(sheetName);
+        if (!sheet) {
+            return;
+        }
+        for (uint32_t col = 0; col < sheet->columns.size(); ++col) {
+            const ColumnData* column = sheet->columns[col].get();
+            if (!column) {
+                continue;
+            }
+            for (uint32_t chunkIndex = 0; chunkIndex < column->chunkCount(); ++chunkIndex) {
+                if (const CellChunk* chunk = column->chunkAt(chunkIndex)) {
+                    visit(col, chunkIndex, *chunk);
+                }
+            }
+        }
+    }
+
+private:
+    friend class DataStore;
+
+    std::shared_ptr<const WorkbookData> root;
+
+    const SheetData* findSheet(const std::string& sheetName) const;
+
+    // Returns the chunk holding the cell, or nullptr
+    const CellChunk* findChunk(const std::string& sheetName, const CellAddress& cell) const;
+
+    // Calls visit(rowIndex, columnIndex, chunk, offset) for every populated cell of range,
+    // with indexes relative to its top-left corner, scanning column by column
+    template <typename Visitor>
+    void scanRange(const std::string& sheetName, const CellRange& range, Visitor visit) const {
+        const SheetData* sheet = findSheet(sheetName);
+        if (!sheet || sheet->columns.empty()) {
+            return;
+        }
+        const uint32_t lastColumn = std::min<uint32_t>(range.last.column, static_cast<uint32_t>(sheet->columns.size()) - 1);
+        for (uint32_t col = range.first.column; col <= lastColumn; ++col) {
+            const ColumnData* column = sheet->columns[col].get();
+            if (!column) {
+                continue;
+            }
+            for (uint32_t chunkIndex = range.first.row / CellChunk::kChunkRows;
+                 chunkIndex <= range.last.row / CellChunk::kChunkRows && chunkIndex < column->chunkCount(); ++chunkIndex) {
+                const CellChunk* chunk = column->chunkAt(chunkIndex);
+                if (!chunk) {
+                    continue;
+                }
+                const uint32_t chunkFirstRow = chunkIndex * CellChunk::kChunkRows;
+                chunk->forEachPresent([&](uint32_t offset) {
+                    const uint32_t row = chunkFirstRow + offset;
+                    if (row >= range.first.row && row <= range.last.row) {
+                        visit(row - range.first.row, col - range.first.column, *chunk, offset);
+                    }
+                });
+            }
+        }
+    }
+};
+
+// One journaled mutation. Sequence numbers are the committed versions that carried the
+// change, so every change of one batch shares a sequence and a snapshot's version is a valid
+// cursor for getChanges.
+struct DataChange {
+    enum Kind : uint8_t { CellWritten, SheetCreated, SheetCleared, SheetDeleted, SheetCopied };
+
+    uint64_t sequence = 0;
+    Kind kind = CellWritten;
+    std::string sheetName;
+    // SheetCopied only: the sheet sheetName was created as a copy of
+    std::string sourceSheetName;
+    // CellWritten only; an Empty value means the cell was cleared
+    CellAddress cell{0, 0};
+    CellData value;
+};
+
+// Changes committed after fromSequence, up to and including toSequence, in commit order
+struct ChangeBatch {
+    uint64_t fromSequence = 0;
+    uint64_t toSequence = 0;
+    // fromSequence is older than the journal retains and changes is empty: resync from a
+    // snapshot and continue from its version
+    bool truncated = false;
+    std::vector<DataChange> changes;
+};
+
+// Manages in-memory data storage and retrieval for Excel spreadsheets.
+// Storage is multi-versioned: readers pin an immutable DataSnapshot in O(1) and take no
+// data locks. Writers are sharded: a write holds its sheet's lock shared plus the stripe
+// locks of the columns it touches, builds private copy-on-write copies of just those
+// columns, and then publishes them with a brief root swap. Writers to different sheets, or
+// different columns of one sheet, proceed in parallel; clearSheet/deleteSheet take only
+// their own sheet's lock exclusively.
+// Because versions share their nodes, duplicating a sheet and forking the whole store are
+// O(1): the copy starts out sharing every chunk and clones only the chunks it later writes.
+// Every commit is also appended to a bounded change journal, so incremental consumers (sync,
+// autosave, pivot refresh) can ask for what changed since the sequence they last saw.
 class DataStore {
 private:
-    std::unordered_map<std::string, std::unordered_map<std::string, CellData>> sheets;
-    mutable std::mutex dataMutex;
+    static constexpr size_t kColumnStripes = 64;
+    static constexpr size_t kDefaultJournalCapacity = 256 * 1024;
+
+    // Lock shard for one sheet
+    struct SheetLocks {
+        std::shared_mutex sheetMutex;
+        std::mutex columnStripes[kColumnStripes];
+    };
+
+    // Latest committed version handed out to readers
+    std::shared_ptr<const WorkbookData> published;
+    mutable std::mutex publishMutex;
+    std::shared_ptr<WorkbookTables> tables;
+
+    std::unordered_map<std::string, std::shared_ptr<SheetLocks>> sheetLocks;
+    std::mutex sheetLocksMutex;
+
+    // Journal record of one commit; cells are shared, so appending under publishMutex is O(1)
+    struct JournalEntry {
+        uint64_t sequence = 0;
+        DataChange::Kind kind = DataChange::CellWritten;
+        std::string sheetName;
+        std::shared_ptr<const std::vector<std::pair<CellAddress, CellData>>> cells;
+        std::string sourceSheetName;
+
+        size_t size() const { return cells ? cells->size() : 1; }
+    };
+
+    // Lazily opened sheets awaiting the background loader, in directory order
+    std::deque<std::shared_ptr<LazySheet>> loadQueue;
+    std::mutex loadMutex;
+    std::condition_variable loadAvailable;
+    bool stopLoading = false;
+    std::thread loaderThread;
+
+    void loaderLoop();
+
+    std::deque<JournalEntry> journal;
+    // Number of changes held in journal, and the most it may hold
+    size_t journalSize = 0;
+    size_t journalCapacity = kDefaultJournalCapacity;
+    // Newest sequence evicted from the journal; changes after it are complete
+    uint64_t journalFloor = 0;
+    mutable std::mutex journalMutex;
+
+    // Returns the lock shard for a sheet, creating it on first use
+    std::shared_ptr<SheetLocks> locksFor(const std::string& sheetName);
+
+    // Returns the latest committed root
+    std::shared_ptr<const WorkbookData> latest() const;
+
+    // Writes cells of one sheet and publishes them as a single version
+    void writeCells(const std::string& sheetName, const std::vector<std::pair<CellAddress, CellData>>& cells);
+
+    // Applies cells to the latest version and publishes it. Caller holds the sheet's lock
+    // and the stripes of every written column, or the sheet's lock exclusively.
+    void commitCells(const std::string& sheetName, const std::vector<std::pair<CellAddress, CellData>>& cells);
+
+    // Publishes a new root derived from the latest one: update edits the copied root, and
+    // entry is journaled under the new version. Serialized by publishMutex; callers keep the
+    // work done inside update small.
+    template <typename Update>
+    void publish(Update update, JournalEntry entry);
+
+    // Appends a committed entry and evicts the oldest ones beyond the capacity
+    void appendToJournal(JournalEntry entry);
+
+    // Evicts the oldest entries beyond the capacity, always keeping the newest commit.
+    // Caller holds journalMutex.
+    void trimJournal();
 
 public:
-    // Initializes the DataStore
-    DataStore() = default;
+    // Initializes the DataStore; pass the workbook StyleTable to share format IDs with the
+    // FormattingEngine, otherwise the store creates its own
+    explicit DataStore(std::shared_ptr<StyleTable> styleTable = nullptr);
+
+    // Creates a private, writable fork starting at base's version. The fork shares all data
+    // and the side tables with base; writes on either side stay invisible to the other.
+    // Throws if base is an empty snapshot.
+    explicit DataStore(const DataSnapshot& base);
+
+    // Stops the background loader; sheets it has not reached stay unloaded
+    ~DataStore();
+
+    // Forks the latest version in O(1), e.g. for a what-if run or a scenario
+    std::unique_ptr<DataStore> fork() const;
+
+    // Interns side-table entries for building CellData values
+    StringId internText(const std::string& text);
+    FormulaId internFormula(const std::string& formula);
+    StyleId internStyle(const CellFormat& format);
+
+    // Pins the latest committed version for consistent reads; O(1)
+    DataSnapshot createSnapshot() const;
+
+    // Returns the latest committed version number
+    uint64_t getVersion() const;
 
     // Sets the value of a cell in a specific sheet
     void setCellValue(const std::string& sheetName, const std::string& cellReference, const CellData& value);
 
+    // Sets many cells of a sheet and commits them as a single version
+    void setCellValues(const std::string& sheetName, const std::vector<std::pair<std::string, CellData>>& values);
+
+    // Same, for cells already given as addresses; Empty values clear their cells
+    void setCellValues(const std::string& sheetName, const std::vector<std::pair<CellAddress, CellData>>& cells);
+
+    // Same, but only if no commit since base has changed the cells of guarded; otherwise
+    // writes nothing and returns false, so a caller that derived cells from base can re-read
+    // and retry. Changes are detected per row chunk, so a nearby write can also refuse it.
+    bool setCellValuesIfUnchanged(const std::string& sheetName, const DataSnapshot& base, const CellRange& guarded,
+                                  const std::vector<std::pair<CellAddress, CellData>>& cells);
+
+    // Calls derive with the latest snapshot and commits the cells it returns, holding the
+    // sheet's exclusive lock throughout so no write to the sheet lands in between. Writers to
+    // the sheet wait for derive, so it is the fallback when optimistic retries keep losing.
+    void updateCells(const std::string& sheetName,
+                     const std::function<std::vector<std::pair<CellAddress, CellData>>(const DataSnapshot&)>& derive);
+
     // Retrieves the value of a cell from a specific sheet
     CellData getCellValue(const std::string& sheetName, const std::string& cellReference);
 
+    // Creates an empty sheet if it does not exist
+    void createSheet(const std::string& sheetName);
+
+    // Opens sheets from a directory of (name, loader) without reading them: the names are
+    // listed at once, and each sheet's cells are loaded on first access or, in directory
+    // order, by a background thread. Existing sheets of the same names are replaced.
+    void openLazySheets(std::vector<std::pair<std::string, LazySheet::Loader>> directory);
+
+    // Same, for loaders that build whole sheets. Without loadInBackground a sheet is only
+    // loaded when something reads or writes it.
+    void openLazySheets(std::vector<std::pair<std::string, LazySheet::SheetLoader>> directory, bool loadInBackground);
+
+    // Blocks until every lazily opened sheet is loaded; rethrows a loader's error
+    void waitForSheets();
+
+    // Returns the sheets of the latest version whose load has failed so far, with the
+    // error, without waiting for or starting any load. Failures of the background loader
+    // show up here even for sheets nothing has read.
+    std::vector<std::pair<std::string, std::exception_ptr>> getLoadErrors() const;
+
+    // Creates newName as a copy of sourceName in O(1); returns false if the source does not
+    // exist or newName is taken
+    bool duplicateSheet(const std::string& sourceName, const std::string& newName);
+
     // Clears all data from a specific sheet
     void clearSheet(const std::string& sheetName);
 
@@ -42,16 +580,24 @@ public:
 
     // Retrieves a range of cell values from a specific sheet
     std::vector<std::vector<CellData>> getCellRange(const std::string& sheetName, const std::string& startCell, const std::string& endCell);
+
+    // Retrieves a range given as "Sheet1!A1:C10"
+    std::vector<std::vector<CellData>> getCellRange(const std::string& qualifiedRange);
+
+    // Returns the changes committed after sinceSequence. With coalesce, only the last write
+    // to each cell is kept and writes followed by a clear or delete of their sheet are
+    // dropped, so replaying the batch in order still yields the latest state.
+    ChangeBatch getChanges(uint64_t sinceSequence, bool coalesce = true) const;
+
+    // Bounds the journal to roughly this many cell changes; older commits are evicted whole,
+    // and the newest commit is always kept
+    void setJournalCapacity(size_t maxChanges);
 };
 
 // Human tasks:
 // - Add comprehensive documentation for each method, including usage examples and best practices
-// - Implement a mechanism for data change notifications to update dependent cells and UI
-// - Add support for transactions to allow atomic updates of multiple cells
+// - Implement push notifications on top of the change journal to update dependent cells and UI
 // - Implement a caching mechanism for frequently accessed data
-// - Add support for lazy loading of sheet data to improve memory usage
 // - Implement data validation hooks to ensure data integrity
-// - Add support for concurrent access optimizations (e.g., read-write locks for sheets)
-// - Implement a mechanism for efficient bulk updates of cell data
 
-#endif // DATASTORE_H
\ No newline at end of file
+#endif // DATASTORE_H
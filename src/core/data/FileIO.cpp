@@ -1,159 +1,945 @@
 #include "FileIO.h"
 #include "DataStore.h"
+#include "NativeWorkbook.h"
+#include "ByteReader.h"
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <exception>
 #include <fstream>
+#include <optional>
 #include <stdexcept>
-#include <rapidxml/rapidxml.hpp>
-#include <rapidxml/rapidxml_print.hpp>
+#include <thread>
 #include <zlib.h>
 #include <mutex>
+#include <string_view>
 
-FileIO::FileIO(DataStore* store) : dataStore(store) {}
+namespace {
 
-bool FileIO::saveWorkbook(const std::string& filePath) {
-    std::lock_guard<std::mutex> lock(ioMutex);
+// Appends text escaped for use inside a double-quoted attribute
+void appendEscaped(std::string& out, const std::string& text) {
+    for (char c : text) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            case '\'': out += "&apos;"; break;
+            default: out += c; break;
+        }
+    }
+}
 
-    try {
-        // Create XML document representing the workbook
-        rapidxml::xml_document<> doc = createXMLDocument();
+void appendNumber(std::string& out, uint32_t value) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr - digits);
+}
 
-        // Convert XML to string
-        std::string xml_string;
-        rapidxml::print(std::back_inserter(xml_string), doc);
+// Short codes for the type attribute of a <cell> element
+char typeCode(CellData::Type type) {
+    switch (type) {
+        case CellData::Number: return 'n';
+        case CellData::Boolean: return 'b';
+        case CellData::Error: return 'e';
+        default: return 's';
+    }
+}
 
-        // Compress the XML data
-        std::vector<unsigned char> compressed_data = compressData(xml_string);
+// Writes the populated cells of one block of a sheet as <cell> elements, in storage order.
+// The type is saved next to the text so loading never has to guess it.
+std::string serializeBlock(const DataSnapshot& snapshot, const std::string& sheetName, const CellRange& block) {
+    std::string xml;
+    std::string cellValue;
+    snapshot.forEachCellInRange(sheetName, block, [&](const CellAddress& address, const CellData& data) {
+        cellValue = snapshot.getDisplayText(data);
+        if (cellValue.empty()) {
+            return;
+        }
+        xml += "\t\t<cell row=\"";
+        appendNumber(xml, address.row);
+        xml += "\" col=\"";
+        appendNumber(xml, address.column);
+        xml += "\" type=\"";
+        xml += typeCode(data.getType());
+        xml += "\" value=\"";
+        appendEscaped(xml, cellValue);
+        xml += "\"/>\n";
+    });
+    return xml;
+}
 
-        // Write the compressed data to the file
-        std::ofstream file(filePath, std::ios::binary);
-        if (!file) {
-            throw std::runtime_error("Unable to open file for writing");
+// Rebuilds a typed cell from its saved text. type is the cell's type code, or 0 for files
+// written before cells carried one, whose type is guessed from the text.
+CellData toCellData(const char* value, size_t length, char type, WorkbookTables& tables) {
+    std::string text;
+    CellError error = CellError::Null;
+    switch (type) {
+        case 'n': {
+            double number = 0.0;
+            auto parsed = std::from_chars(value, value + length, number);
+            if (parsed.ec != std::errc() || parsed.ptr != value + length) {
+                throw std::runtime_error("Invalid XML: bad number cell");
+            }
+            return CellData::fromNumber(number);
         }
-        file.write(reinterpret_cast<const char*>(compressed_data.data()), compressed_data.size());
+        case 'b':
+            text.assign(value, length);
+            if (text != "TRUE" && text != "FALSE") {
+                throw std::runtime_error("Invalid XML: bad boolean cell");
+            }
+            return CellData::fromBoolean(text == "TRUE");
+        case 'e':
+            text.assign(value, length);
+            if (!parseErrorText(text, error)) {
+                throw std::runtime_error("Invalid XML: bad error cell");
+            }
+            return CellData::fromError(error);
+        case 's':
+            return CellData::fromText(tables.texts.intern(std::string(value, length)));
+        case 0:
+            break;
+        default:
+            throw std::runtime_error("Invalid XML: unknown cell type");
+    }
 
-        return true;
-    } catch (const std::exception& e) {
-        // Log error message
-        return false;
+    double number = 0.0;
+    auto parsed = std::from_chars(value, value + length, number);
+    if (parsed.ec == std::errc() && parsed.ptr == value + length) {
+        return CellData::fromNumber(number);
+    }
+
+    text.assign(value, length);
+    if (text == "TRUE" || text == "FALSE") {
+        return CellData::fromBoolean(text == "TRUE");
     }
+    if (parseErrorText(text, error)) {
+        return CellData::fromError(error);
+    }
+    return CellData::fromText(tables.texts.intern(text));
 }
 
-bool FileIO::loadWorkbook(const std::string& filePath) {
-    std::lock_guard<std::mutex> lock(ioMutex);
+// Single-stream files, as written before the framed container: the whole workbook is one zlib
+// stream. The file is read and inflated in fixed-size chunks; a tag scanner cuts the XML text
+// into tags as it arrives, and cells are decoded into DataStore a batch at a time. Opening
+// makes one inflate pass that only tracks sheet tags, and records for each sheet an access
+// point: the deflate block boundary preceding it, with the 32 KiB window inflation needs to
+// resume there. Each sheet is later decoded by resuming at its own access point, so memory
+// stays bounded by the buffers and total work stays linear in the file size.
 
-    try {
-        // Read the compressed data from the file
-        std::ifstream file(filePath, std::ios::binary | std::ios::ate);
-        if (!file) {
+constexpr size_t kInputChunk = 64 * 1024;
+constexpr size_t kWindowSize = 32 * 1024;
+constexpr size_t kCellBatch = 64 * 1024;
+// A tag longer than this means the file is damaged
+constexpr size_t kMaxTagLength = 1024 * 1024;
+
+// An open workbook file shared by the lazy loaders. Reads are positioned, so loaders on
+// different threads do not disturb each other, and the handle keeps the data readable even
+// if the path is replaced by a later save.
+class SharedFile {
+public:
+    explicit SharedFile(const std::string& path) : stream(path, std::ios::binary) {
+        if (!stream) {
             throw std::runtime_error("Unable to open file for reading");
         }
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
+    }
 
-        std::vector<unsigned char> compressed_data(size);
-        if (!file.read(reinterpret_cast<char*>(compressed_data.data()), size)) {
+    // Reads up to size bytes at offset; returns the number read, 0 at the end of the file
+    size_t readAt(uint64_t offset, unsigned char* buffer, size_t size) {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        stream.clear();
+        stream.seekg(static_cast<std::streamoff>(offset));
+        stream.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(size));
+        if (stream.bad()) {
             throw std::runtime_error("Error reading file");
         }
+        return static_cast<size_t>(stream.gcount());
+    }
+
+    uint64_t size() {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        stream.clear();
+        stream.seekg(0, std::ios::end);
+        return static_cast<uint64_t>(stream.tellg());
+    }
+
+private:
+    std::ifstream stream;
+    std::mutex fileMutex;
+};
+
+// Where inflation can resume: a deflate block boundary in the compressed data, the matching
+// uncompressed offset, and the window of output that precedes it
+struct AccessPoint {
+    uint64_t compressedOffset = 0;
+    int bits = 0;
+    uint64_t uncompressedOffset = 0;
+    std::vector<unsigned char> window;
+};
+
+// Inflates a workbook file from its start, or from an access point, handing each piece of
+// output to a consumer as it is produced
+class StreamInflater {
+public:
+    explicit StreamInflater(std::shared_ptr<SharedFile> source)
+        : file(std::move(source)), input(kInputChunk), window(kWindowSize) {
+        if (inflateInit(&stream) != Z_OK) {
+            throw std::runtime_error("Decompression failed");
+        }
+    }
+
+    StreamInflater(std::shared_ptr<SharedFile> source, const AccessPoint& point)
+        : file(std::move(source)), input(kInputChunk), window(kWindowSize) {
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            throw std::runtime_error("Decompression failed");
+        }
+        compressedOffset = point.compressedOffset;
+        uncompressedOffset = point.uncompressedOffset;
+        if (point.bits) {
+            // The boundary falls inside a byte; feed its remaining bits first
+            unsigned char byte = 0;
+            if (file->readAt(compressedOffset - 1, &byte, 1) != 1) {
+                throw std::runtime_error("Unexpected end of file");
+            }
+            inflatePrime(&stream, point.bits, byte >> (8 - point.bits));
+        }
+        if (point.uncompressedOffset > 0) {
+            inflateSetDictionary(&stream, point.window.data(), static_cast<uInt>(point.window.size()));
+        }
+    }
+
+    ~StreamInflater() { inflateEnd(&stream); }
+
+    StreamInflater(const StreamInflater&) = delete;
+    StreamInflater& operator=(const StreamInflater&) = delete;
+
+    // Calls consume(data, size, offset) for each piece of output, offset being its position in
+    // the uncompressed text, until consume returns false or the stream ends. With
+    // onBoundary, calls it with an access point at each deflate block boundary.
+    template <typename Consume, typename Boundary>
+    void run(Consume consume, Boundary onBoundary) {
+        int result = Z_OK;
+        do {
+            if (stream.avail_in == 0) {
+                const size_t read = file->readAt(compressedOffset, input.data(), input.size());
+                if (read == 0) {
+                    throw std::runtime_error("Unexpected end of file");
+                }
+                stream.next_in = input.data();
+                stream.avail_in = static_cast<uInt>(read);
+            }
+            if (stream.avail_out == 0) {
+                // The window is used circularly so it always holds the latest output
+                stream.next_out = window.data();
+                stream.avail_out = static_cast<uInt>(window.size());
+            }
+
+            unsigned char* produced = stream.next_out;
+            const uInt inputBefore = stream.avail_in;
+            result = inflate(&stream, Z_BLOCK);
+            if (result == Z_NEED_DICT || result == Z_DATA_ERROR || result == Z_MEM_ERROR || result == Z_STREAM_ERROR) {
+                throw std::runtime_error("Decompression failed");
+            }
+            compressedOffset += inputBefore - stream.avail_in;
+
+            const size_t size = static_cast<size_t>(stream.next_out - produced);
+            const uint64_t offset = uncompressedOffset;
+            uncompressedOffset += size;
+            if (size > 0 && !consume(reinterpret_cast<const char*>(produced), size, offset)) {
+                return;
+            }
+
+            // Bit 128: stopped at a block boundary; bit 64: after the last block
+            if ((stream.data_type & 128) && !(stream.data_type & 64)) {
+                onBoundary(currentPoint());
+            }
+        } while (result != Z_STREAM_END);
+    }
+
+    template <typename Consume>
+    void run(Consume consume) {
+        run(consume, [](const AccessPoint&) {});
+    }
 
-        // Decompress the data
-        std::string xml_string = decompressData(compressed_data);
+private:
+    std::shared_ptr<SharedFile> file;
+    z_stream stream{};
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> window;
+    uint64_t compressedOffset = 0;
+    uint64_t uncompressedOffset = 0;
 
-        // Parse the XML document
-        rapidxml::xml_document<> doc;
-        doc.parse<0>(&xml_string[0]);
+    AccessPoint currentPoint() const {
+        AccessPoint point;
+        point.compressedOffset = compressedOffset;
+        point.bits = stream.data_type & 7;
+        point.uncompressedOffset = uncompressedOffset;
+        // Unroll the circular window: the older part follows the write position
+        const size_t left = stream.avail_out;
+        point.window.reserve(window.size());
+        point.window.insert(point.window.end(), window.end() - left, window.end());
+        point.window.insert(point.window.end(), window.begin(), window.end() - left);
+        return point;
+    }
+};
 
-        // Populate the DataStore with the parsed data
-        parseXMLDocument(doc);
+// Cuts XML text fed in arbitrary pieces into tags and calls onTag(tag, offset) for each
+// complete "<...>", offset being the position of its '<'. Text between tags is skipped.
+// Attribute values are escaped on save, so a raw '<' or '>' always delimits a tag.
+class XmlTagScanner {
+public:
+    // Returns false once onTag has returned false
+    template <typename Handler>
+    bool feed(const char* data, size_t size, uint64_t offset, Handler onTag) {
+        const char* end = data + size;
+        const char* cursor = data;
+        while (cursor < end) {
+            if (!partial.empty()) {
+                // Finish a tag begun in an earlier piece
+                const char* close = static_cast<const char*>(std::memchr(cursor, '>', end - cursor));
+                const char* stop = close ? close + 1 : end;
+                partial.append(cursor, stop);
+                cursor = stop;
+                if (partial.size() > kMaxTagLength) {
+                    throw std::runtime_error("Invalid XML: unterminated tag");
+                }
+                if (!close) {
+                    break;
+                }
+                std::string tag;
+                tag.swap(partial);
+                if (!onTag(std::string_view(tag), partialOffset)) {
+                    return false;
+                }
+                continue;
+            }
 
+            const char* open = static_cast<const char*>(std::memchr(cursor, '<', end - cursor));
+            if (!open) {
+                break;
+            }
+            const char* close = static_cast<const char*>(std::memchr(open, '>', end - open));
+            if (!close) {
+                partial.assign(open, end);
+                partialOffset = offset + (open - data);
+                break;
+            }
+            if (!onTag(std::string_view(open, close + 1 - open), offset + (open - data))) {
+                return false;
+            }
+            cursor = close + 1;
+        }
         return true;
-    } catch (const std::exception& e) {
-        // Log error message
+    }
+
+private:
+    std::string partial;
+    uint64_t partialOffset = 0;
+};
+
+// Returns true if tag is a start (or empty-element) tag named name
+bool isStartTag(std::string_view tag, std::string_view name) {
+    if (tag.size() < name.size() + 2 || tag.compare(1, name.size(), name) != 0) {
         return false;
     }
+    const char next = tag[name.size() + 1];
+    return next == ' ' || next == '>' || next == '/' || next == '\t' || next == '\n' || next == '\r';
 }
 
-rapidxml::xml_document<> FileIO::createXMLDocument() {
-    rapidxml::xml_document<> doc;
-
-    // Create root element for the workbook
-    rapidxml::xml_node<>* root = doc.allocate_node(rapidxml::node_element, "workbook");
-    doc.append_node(root);
+bool isEmptyElement(std::string_view tag) {
+    return tag.size() >= 2 && tag[tag.size() - 2] == '/';
+}
 
-    // Iterate through all sheets in the DataStore
-    for (const auto& sheetName : dataStore->getSheetNames()) {
-        rapidxml::xml_node<>* sheet = doc.allocate_node(rapidxml::node_element, "sheet");
-        sheet->append_attribute(doc.allocate_attribute("name", doc.allocate_string(sheetName.c_str())));
-        root->append_node(sheet);
+// Calls visit(name, rawValue) for each attribute of a tag
+template <typename Visitor>
+void forEachAttribute(std::string_view tag, Visitor visit) {
+    size_t pos = tag.find_first_of(" \t\r\n");
+    while (pos != std::string_view::npos) {
+        const size_t nameStart = tag.find_first_not_of(" \t\r\n", pos);
+        if (nameStart == std::string_view::npos) {
+            return;
+        }
+        const size_t equals = tag.find('=', nameStart);
+        if (equals == std::string_view::npos) {
+            return;
+        }
+        const size_t quote = tag.find_first_of("\"'", equals);
+        if (quote == std::string_view::npos) {
+            return;
+        }
+        const size_t closeQuote = tag.find(tag[quote], quote + 1);
+        if (closeQuote == std::string_view::npos) {
+            throw std::runtime_error("Invalid XML: unterminated attribute");
+        }
+        std::string_view name = tag.substr(nameStart, equals - nameStart);
+        while (!name.empty() && (name.back() == ' ' || name.back() == '\t')) {
+            name.remove_suffix(1);
+        }
+        visit(name, tag.substr(quote + 1, closeQuote - quote - 1));
+        pos = closeQuote + 1;
+    }
+}
 
-        // Iterate through all cells in the sheet
-        for (int row = 0; row < dataStore->getRowCount(sheetName); ++row) {
-            for (int col = 0; col < dataStore->getColumnCount(sheetName); ++col) {
-                std::string cellValue = dataStore->getCellValue(sheetName, row, col);
-                if (!cellValue.empty()) {
-                    rapidxml::xml_node<>* cell = doc.allocate_node(rapidxml::node_element, "cell");
-                    cell->append_attribute(doc.allocate_attribute("row", doc.allocate_string(std::to_string(row).c_str())));
-                    cell->append_attribute(doc.allocate_attribute("col", doc.allocate_string(std::to_string(col).c_str())));
-                    cell->append_attribute(doc.allocate_attribute("value", doc.allocate_string(cellValue.c_str())));
-                    sheet->append_node(cell);
-                }
+// Replaces the predefined and numeric character entities in an attribute value
+void decodeEntities(std::string_view raw, std::string& out) {
+    out.clear();
+    size_t pos = 0;
+    while (pos < raw.size()) {
+        const size_t amp = raw.find('&', pos);
+        out.append(raw.substr(pos, amp == std::string_view::npos ? std::string_view::npos : amp - pos));
+        if (amp == std::string_view::npos) {
+            return;
+        }
+        const size_t semicolon = raw.find(';', amp);
+        if (semicolon == std::string_view::npos) {
+            throw std::runtime_error("Invalid XML: unterminated entity");
+        }
+        const std::string_view entity = raw.substr(amp + 1, semicolon - amp - 1);
+        if (entity == "amp") {
+            out += '&';
+        } else if (entity == "lt") {
+            out += '<';
+        } else if (entity == "gt") {
+            out += '>';
+        } else if (entity == "quot") {
+            out += '"';
+        } else if (entity == "apos") {
+            out += '\'';
+        } else if (entity.size() > 1 && entity[0] == '#') {
+            uint32_t code = 0;
+            const bool hex = entity[1] == 'x';
+            auto digits = entity.substr(hex ? 2 : 1);
+            auto parsed = std::from_chars(digits.data(), digits.data() + digits.size(), code, hex ? 16 : 10);
+            if (parsed.ec != std::errc() || parsed.ptr != digits.data() + digits.size()) {
+                throw std::runtime_error("Invalid XML: bad character reference");
+            }
+            // Encode as UTF-8
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
             }
+        } else {
+            throw std::runtime_error("Invalid XML: unknown entity");
         }
+        pos = semicolon + 1;
     }
+}
 
-    return doc;
+uint32_t parseIndex(std::string_view text) {
+    uint32_t value = 0;
+    auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (parsed.ec != std::errc() || parsed.ptr != text.data() + text.size()) {
+        throw std::runtime_error("Invalid XML: bad cell position");
+    }
+    return value;
 }
 
-void FileIO::parseXMLDocument(const rapidxml::xml_document<>& doc) {
-    // Get the root workbook element
-    rapidxml::xml_node<>* root = doc.first_node("workbook");
-    if (!root) {
-        throw std::runtime_error("Invalid XML: missing workbook element");
+// Appends the cell of a <cell> tag to batch; returns false for any other tag
+bool decodeCellTag(std::string_view tag, WorkbookTables& tables, std::string& scratch, LazySheet::CellBatch& batch) {
+    if (!isStartTag(tag, "cell")) {
+        return false;
+    }
+    std::string_view row;
+    std::string_view col;
+    std::string_view raw;
+    std::string_view type;
+    bool hasValue = false;
+    forEachAttribute(tag, [&](std::string_view attribute, std::string_view attributeValue) {
+        if (attribute == "row") {
+            row = attributeValue;
+        } else if (attribute == "col") {
+            col = attributeValue;
+        } else if (attribute == "type") {
+            type = attributeValue;
+        } else if (attribute == "value") {
+            raw = attributeValue;
+            hasValue = true;
+        }
+    });
+    if (row.empty() || col.empty() || !hasValue || type.size() > 1) {
+        throw std::runtime_error("Invalid XML: incomplete cell element");
     }
+    decodeEntities(raw, scratch);
+    batch.emplace_back(CellAddress{parseIndex(row), parseIndex(col)},
+                       toCellData(scratch.data(), scratch.size(), type.empty() ? '\0' : type[0], tables));
+    return true;
+}
+
+// A sheet found by the directory pass
+struct SheetEntry {
+    std::string name;
+    uint64_t offset = 0; // Position of its start tag in the uncompressed text
+    std::shared_ptr<const AccessPoint> point;
+};
 
-    // Iterate through sheet elements
-    for (rapidxml::xml_node<>* sheet = root->first_node("sheet"); sheet; sheet = sheet->next_sibling("sheet")) {
-        std::string sheetName = sheet->first_attribute("name")->value();
-        dataStore->createSheet(sheetName);
+// Inflates the whole file once, looking only at sheet and workbook tags
+std::vector<SheetEntry> scanSheetDirectory(const std::shared_ptr<SharedFile>& file) {
+    std::vector<SheetEntry> sheets;
+    auto lastBoundary = std::make_shared<const AccessPoint>();
+    bool sawWorkbook = false;
+    std::string name;
+
+    XmlTagScanner scanner;
+    StreamInflater inflater(file);
+    inflater.run(
+        [&](const char* data, size_t size, uint64_t offset) {
+            return scanner.feed(data, size, offset, [&](std::string_view tag, uint64_t tagOffset) {
+                if (isStartTag(tag, "workbook")) {
+                    sawWorkbook = true;
+                } else if (isStartTag(tag, "sheet")) {
+                    bool named = false;
+                    forEachAttribute(tag, [&](std::string_view attribute, std::string_view value) {
+                        if (attribute == "name") {
+                            decodeEntities(value, name);
+                            named = true;
+                        }
+                    });
+                    if (!named) {
+                        throw std::runtime_error("Invalid XML: sheet without a name");
+                    }
+                    sheets.push_back(SheetEntry{name, tagOffset, lastBoundary});
+                }
+                return true;
+            });
+        },
+        [&](const AccessPoint& point) { lastBoundary = std::make_shared<const AccessPoint>(point); });
 
-        // Iterate through cell elements in the sheet
-        for (rapidxml::xml_node<>* cell = sheet->first_node("cell"); cell; cell = cell->next_sibling("cell")) {
-            int row = std::stoi(cell->first_attribute("row")->value());
-            int col = std::stoi(cell->first_attribute("col")->value());
-            std::string value = cell->first_attribute("value")->value();
+    if (!sawWorkbook) {
+        throw std::runtime_error("Invalid XML: missing workbook element");
+    }
+    return sheets;
+}
 
-            dataStore->setCellValue(sheetName, row, col, value);
+// Decodes one sheet by resuming inflation at its access point, handing cells to sink in
+// batches and stopping at the end of the sheet
+void loadSheet(const std::shared_ptr<SharedFile>& file, const SheetEntry& sheet, WorkbookTables& tables,
+               const LazySheet::BatchSink& sink) {
+    LazySheet::CellBatch batch;
+    batch.reserve(kCellBatch);
+    std::string value;
+
+    XmlTagScanner scanner;
+    StreamInflater inflater(file, *sheet.point);
+    inflater.run([&](const char* data, size_t size, uint64_t offset) {
+        // Skip the output between the access point and the sheet's start tag
+        if (offset + size <= sheet.offset) {
+            return true;
         }
+        const size_t skip = offset < sheet.offset ? static_cast<size_t>(sheet.offset - offset) : 0;
+        return scanner.feed(data + skip, size - skip, offset + skip, [&](std::string_view tag, uint64_t) {
+            if (decodeCellTag(tag, tables, value, batch)) {
+                if (batch.size() >= kCellBatch) {
+                    sink(batch);
+                    batch.clear();
+                }
+                return true;
+            }
+            if (isStartTag(tag, "sheet")) {
+                return !isEmptyElement(tag);
+            }
+            // Anything else ends the sheet: normally its end tag
+            return false;
+        });
+    });
+    if (!batch.empty()) {
+        sink(batch);
     }
 }
 
-std::vector<unsigned char> FileIO::compressData(const std::string& data) {
-    uLongf compressedSize = compressBound(data.size());
-    std::vector<unsigned char> compressedData(compressedSize);
+// Framed container, written by saveWorkbook. Each sheet's <cell> elements are cut into row
+// blocks and every block is deflated on its own as a frame, so blocks are compressed and
+// decompressed in parallel, and a directory at the end of the file finds any sheet without
+// reading the others. Each <cell> carries a type attribute (n, b, s or e) so text such as
+// "007" or "inf" comes back as text. Integers are little-endian.
+//
+//   header     "WBXFRAME", u32 version
+//   frames     u32 compressed size, u32 text size, u32 Adler-32 of the text, zlib data
+//   directory  u32 sheet count; per sheet: u32 name size, name, u32 frame count, u64 offsets
+//   footer     u64 directory offset, "WBXFEND!"
 
-    if (compress(compressedData.data(), &compressedSize, reinterpret_cast<const Bytef*>(data.data()), data.size()) != Z_OK) {
-        throw std::runtime_error("Compression failed");
+constexpr char kFrameMagic[8] = {'W', 'B', 'X', 'F', 'R', 'A', 'M', 'E'};
+constexpr char kFooterMagic[8] = {'W', 'B', 'X', 'F', 'E', 'N', 'D', '!'};
+constexpr uint32_t kFrameVersion = 1;
+constexpr uint32_t kFrameHeaderSize = 12;
+constexpr uint32_t kFooterSize = 16;
+// Rows per block, in whole storage chunks
+constexpr uint32_t kBlockRows = 16 * CellChunk::kChunkRows;
+
+void putU32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
     }
+}
+
+void putU64(std::vector<unsigned char>& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
 
-    compressedData.resize(compressedSize);
-    return compressedData;
+size_t workerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
 }
 
-std::string FileIO::decompressData(const std::vector<unsigned char>& compressedData) {
-    uLongf decompressedSize = compressedData.size() * 10; // Estimate decompressed size
-    std::vector<unsigned char> decompressedData(decompressedSize);
+// Runs produce(i) for i in [0, count) on worker threads and consume(i, result) on the calling
+// thread in index order. At most two results per worker wait to be consumed, which bounds
+// memory. The first exception from either side stops the pipeline and is rethrown.
+template <typename Result, typename Produce, typename Consume>
+void runOrderedPipeline(size_t count, Produce produce, Consume consume) {
+    const size_t threadCount = std::min(workerCount(), count);
+    const size_t window = 2 * std::max<size_t>(threadCount, 1);
+    std::vector<std::optional<Result>> slots(count);
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t nextTask = 0;
+    size_t consumed = 0;
+    std::exception_ptr error;
+
+    auto fail = [&](std::exception_ptr failure) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+            error = failure;
+        }
+    };
+
+    auto worker = [&]() {
+        while (true) {
+            size_t index = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return error || nextTask >= count || nextTask < consumed + window; });
+                if (error || nextTask >= count) {
+                    return;
+                }
+                index = nextTask++;
+            }
+            try {
+                Result result = produce(index);
+                std::lock_guard<std::mutex> lock(mutex);
+                slots[index] = std::move(result);
+            } catch (...) {
+                fail(std::current_exception());
+            }
+            changed.notify_all();
+        }
+    };
 
-    while (true) {
-        int result = uncompress(decompressedData.data(), &decompressedSize, compressedData.data(), compressedData.size());
-        if (result == Z_OK) {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        Result result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return error || slots[i].has_value(); });
+            if (error) {
+                break;
+            }
+            result = std::move(*slots[i]);
+            slots[i].reset();
+        }
+        try {
+            consume(i, std::move(result));
+        } catch (...) {
+            fail(std::current_exception());
+            changed.notify_all();
             break;
-        } else if (result == Z_BUF_ERROR) {
-            decompressedSize *= 2;
-            decompressedData.resize(decompressedSize);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            consumed = i + 1;
+        }
+        changed.notify_all();
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Deflates a block's text into a complete frame, header included
+std::vector<unsigned char> compressFrame(const std::string& text) {
+    uLongf compressedSize = compressBound(text.size());
+    std::vector<unsigned char> frame(kFrameHeaderSize + compressedSize);
+    if (compress(frame.data() + kFrameHeaderSize, &compressedSize, reinterpret_cast<const Bytef*>(text.data()), text.size()) != Z_OK) {
+        throw std::runtime_error("Compression failed");
+    }
+    frame.resize(kFrameHeaderSize + compressedSize);
+
+    std::vector<unsigned char> header;
+    putU32(header, static_cast<uint32_t>(compressedSize));
+    putU32(header, static_cast<uint32_t>(text.size()));
+    putU32(header, static_cast<uint32_t>(adler32(adler32(0, nullptr, 0), reinterpret_cast<const Bytef*>(text.data()), text.size())));
+    std::copy(header.begin(), header.end(), frame.begin());
+    return frame;
+}
+
+// Reads and inflates one frame, verifying its checksum
+std::string readFrame(SharedFile& file, uint64_t offset) {
+    unsigned char headerBytes[kFrameHeaderSize];
+    if (file.readAt(offset, headerBytes, kFrameHeaderSize) != kFrameHeaderSize) {
+        throw std::runtime_error("Unexpected end of file");
+    }
+    ByteReader header(headerBytes, kFrameHeaderSize);
+    const uint32_t compressedSize = header.u32();
+    const uint32_t textSize = header.u32();
+    const uint32_t checksum = header.u32();
+
+    std::vector<unsigned char> compressed(compressedSize);
+    if (file.readAt(offset + kFrameHeaderSize, compressed.data(), compressedSize) != compressedSize) {
+        throw std::runtime_error("Unexpected end of file");
+    }
+    std::string text(textSize, '\0');
+    uLongf decodedSize = textSize;
+    if (uncompress(reinterpret_cast<Bytef*>(&text[0]), &decodedSize, compressed.data(), compressedSize) != Z_OK ||
+        decodedSize != textSize ||
+        adler32(adler32(0, nullptr, 0), reinterpret_cast<const Bytef*>(text.data()), textSize) != checksum) {
+        throw std::runtime_error("Corrupt workbook frame");
+    }
+    return text;
+}
+
+struct FramedSheet {
+    std::string name;
+    std::vector<uint64_t> frames;
+};
+
+bool isFramedFile(SharedFile& file) {
+    char magic[sizeof(kFrameMagic)];
+    return file.readAt(0, reinterpret_cast<unsigned char*>(magic), sizeof(magic)) == sizeof(magic) &&
+           std::memcmp(magic, kFrameMagic, sizeof(magic)) == 0;
+}
+
+std::vector<FramedSheet> readFramedDirectory(SharedFile& file) {
+    const uint64_t fileSize = file.size();
+    if (fileSize < sizeof(kFrameMagic) + 4 + kFooterSize) {
+        throw std::runtime_error("Corrupt workbook file");
+    }
+    unsigned char footer[kFooterSize];
+    if (file.readAt(fileSize - kFooterSize, footer, kFooterSize) != kFooterSize) {
+        throw std::runtime_error("Unexpected end of file");
+    }
+    if (std::memcmp(footer + 8, kFooterMagic, sizeof(kFooterMagic)) != 0) {
+        throw std::runtime_error("Corrupt workbook file: missing directory");
+    }
+    const uint64_t directoryOffset = ByteReader(footer, 8).u64();
+    if (directoryOffset > fileSize - kFooterSize) {
+        throw std::runtime_error("Corrupt workbook directory");
+    }
+
+    unsigned char versionBytes[4];
+    if (file.readAt(sizeof(kFrameMagic), versionBytes, 4) != 4) {
+        throw std::runtime_error("Unexpected end of file");
+    }
+    if (ByteReader(versionBytes, 4).u32() != kFrameVersion) {
+        throw std::runtime_error("Unsupported workbook file version");
+    }
+
+    std::vector<unsigned char> bytes(fileSize - kFooterSize - directoryOffset);
+    if (file.readAt(directoryOffset, bytes.data(), bytes.size()) != bytes.size()) {
+        throw std::runtime_error("Unexpected end of file");
+    }
+    ByteReader directory(bytes.data(), bytes.size(), "Corrupt workbook directory");
+    std::vector<FramedSheet> sheets(directory.u32());
+    for (FramedSheet& sheet : sheets) {
+        sheet.name = directory.text(directory.u32());
+        const uint32_t frameCount = directory.u32();
+        for (uint32_t i = 0; i < frameCount; ++i) {
+            sheet.frames.push_back(directory.u64());
+        }
+    }
+    return sheets;
+}
+
+// Inflates and decodes a sheet's frames on worker threads and hands their cells to sink in
+// frame order
+void loadFramedSheet(const std::shared_ptr<SharedFile>& file, const FramedSheet& sheet, WorkbookTables& tables,
+                     const LazySheet::BatchSink& sink) {
+    runOrderedPipeline<LazySheet::CellBatch>(
+        sheet.frames.size(),
+        [&](size_t index) {
+            LazySheet::CellBatch batch;
+            std::string scratch;
+            std::string text = readFrame(*file, sheet.frames[index]);
+            XmlTagScanner scanner;
+            scanner.feed(text.data(), text.size(), 0, [&](std::string_view tag, uint64_t) {
+                if (!decodeCellTag(tag, tables, scratch, batch)) {
+                    throw std::runtime_error("Invalid XML: unexpected tag in workbook frame");
+                }
+                return true;
+            });
+            return batch;
+        },
+        [&](size_t, LazySheet::CellBatch batch) { sink(batch); });
+}
+
+} // namespace
+
+FileIO::FileIO(DataStore* store) : dataStore(store) {}
+
+bool FileIO::saveWorkbook(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(ioMutex);
+
+    // Stream into a temporary file and move it into place only once it is complete, so a
+    // failed save leaves the previous file intact
+    const std::string tempPath = filePath + ".tmp";
+    try {
+        // Serialize one pinned version so edits made during the save cannot tear the file
+        DataSnapshot snapshot = dataStore->createSnapshot();
+        const std::vector<std::string> sheetNames = snapshot.getSheetNames();
+
+        // One task per row block of each sheet, in file order
+        struct Block {
+            size_t sheet;
+            CellRange rows;
+        };
+        std::vector<Block> blocks;
+        for (size_t sheet = 0; sheet < sheetNames.size(); ++sheet) {
+            CellRange used;
+            if (!snapshot.getUsedRange(sheetNames[sheet], used)) {
+                continue;
+            }
+            for (uint32_t row = used.first.row - used.first.row % kBlockRows; row <= used.last.row; row += kBlockRows) {
+                const uint32_t lastRow = std::min(used.last.row, row + (kBlockRows - 1));
+                blocks.push_back(Block{sheet, CellRange{CellAddress{row, 0}, CellAddress{lastRow, used.last.column}}});
+                if (lastRow == used.last.row) {
+                    break;
+                }
+            }
+        }
+
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Unable to open file for writing");
+        }
+        auto write = [&file](const std::vector<unsigned char>& bytes) {
+            file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            if (!file) {
+                throw std::runtime_error("Error writing file");
+            }
+        };
+
+        std::vector<unsigned char> header(kFrameMagic, kFrameMagic + sizeof(kFrameMagic));
+        putU32(header, kFrameVersion);
+        write(header);
+        uint64_t offset = header.size();
+
+        // Workers serialize and deflate blocks; this thread writes the frames in order
+        std::vector<std::vector<uint64_t>> frameOffsets(sheetNames.size());
+        runOrderedPipeline<std::vector<unsigned char>>(
+            blocks.size(),
+            [&](size_t index) {
+                const Block& block = blocks[index];
+                return compressFrame(serializeBlock(snapshot, sheetNames[block.sheet], block.rows));
+            },
+            [&](size_t index, std::vector<unsigned char> frame) {
+                frameOffsets[blocks[index].sheet].push_back(offset);
+                write(frame);
+                offset += frame.size();
+            });
+
+        std::vector<unsigned char> directory;
+        putU32(directory, static_cast<uint32_t>(sheetNames.size()));
+        for (size_t sheet = 0; sheet < sheetNames.size(); ++sheet) {
+            putU32(directory, static_cast<uint32_t>(sheetNames[sheet].size()));
+            directory.insert(directory.end(), sheetNames[sheet].begin(), sheetNames[sheet].end());
+            putU32(directory, static_cast<uint32_t>(frameOffsets[sheet].size()));
+            for (uint64_t frameOffset : frameOffsets[sheet]) {
+                putU64(directory, frameOffset);
+            }
+        }
+        putU64(directory, offset);
+        directory.insert(directory.end(), kFooterMagic, kFooterMagic + sizeof(kFooterMagic));
+        write(directory);
+
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Error writing file");
+        }
+        if (std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+            throw std::runtime_error("Unable to replace file");
+        }
+        return true;
+    } catch (const std::exception& e) {
+        // Log error message
+        std::remove(tempPath.c_str());
+        return false;
+    }
+}
+
+bool FileIO::loadWorkbook(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(ioMutex);
+
+    try {
+        if (NativeWorkbook::isNativeFile(filePath)) {
+            // Mapped rather than read; sheets are decoded only when something uses them
+            dataStore->openLazySheets(NativeWorkbook::open(filePath), false);
+            return true;
+        }
+
+        // Open with the sheet directory only; each sheet is decoded on first access or in the
+        // background
+        auto file = std::make_shared<SharedFile>(filePath);
+        std::vector<std::pair<std::string, LazySheet::Loader>> directory;
+        if (isFramedFile(*file)) {
+            for (FramedSheet& sheet : readFramedDirectory(*file)) {
+                std::string name = sheet.name;
+                directory.emplace_back(std::move(name), [file, sheet = std::move(sheet)](WorkbookTables& tables, const LazySheet::BatchSink& sink) {
+                    loadFramedSheet(file, sheet, tables, sink);
+                });
+            }
         } else {
-            throw std::runtime_error("Decompression failed");
+            // Single-stream file: find the sheets with one inflate pass, then resume
+            // inflation at each sheet's access point
+            for (SheetEntry& sheet : scanSheetDirectory(file)) {
+                std::string name = sheet.name;
+                directory.emplace_back(std::move(name), [file, sheet = std::move(sheet)](WorkbookTables& tables, const LazySheet::BatchSink& sink) {
+                    loadSheet(file, sheet, tables, sink);
+                });
+            }
         }
+        dataStore->openLazySheets(std::move(directory));
+
+        return true;
+    } catch (const std::exception& e) {
+        // Log error message
+        return false;
     }
+}
 
-    return std::string(decompressedData.begin(), decompressedData.begin() + decompressedSize);
+bool FileIO::saveNativeWorkbook(const std::string& filePath, bool compressBlocks) {
+    std::lock_guard<std::mutex> lock(ioMutex);
+
+    // Replacing the file by rename also keeps a workbook opened from it by mapping intact
+    const std::string tempPath = filePath + ".tmp";
+    try {
+        NativeWorkbook::save(dataStore->createSnapshot(), tempPath, compressBlocks);
+        if (std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+            throw std::runtime_error("Unable to replace file");
+        }
+        return true;
+    } catch (const std::exception& e) {
+        // Log error message
+        std::remove(tempPath.c_str());
+        return false;
+    }
 }
 
 // Human tasks:
@@ -162,7 +948,6 @@ std::string FileIO::decompressData(const std::vector<unsigned char>& compressedD
 // TODO: Implement progress reporting for large file saves
 // TODO: Implement error handling for file read failures and corrupt data
 // TODO: Implement progress reporting for large file loads
-// TODO: Optimize XML creation for large workbooks
 // TODO: Add support for storing cell formulas and formatting in the XML
 // TODO: Implement error handling for malformed XML
 // TODO: Add support for parsing cell formulas and formatting
\ No newline at end of file
@@ -15,6 +15,10 @@ public:
 
     /**
      * @brief Saves the current workbook to a file
+     *
+     * Each sheet is cut into row blocks that are serialized and deflated independently on a
+     * pool of threads, then written in order as frames with a sheet directory at the end, so
+     * save time scales with cores. The file is replaced only once the save completes.
      * @param filePath Path to save the workbook
      * @return True if the save was successful, false otherwise
      */
@@ -22,11 +26,31 @@ public:
 
     /**
      * @brief Loads a workbook from a file
+     *
+     * Only the sheet directory is read up front; each sheet's cells are parsed on first
+     * access or by the DataStore's background loader, so the time to the first view does
+     * not grow with the number of sheets. A sheet's frames are inflated and parsed in
+     * parallel; files written as a single deflate stream are still read, by streaming
+     * decompression through fixed-size buffers. Native binary workbooks are memory-mapped
+     * instead: a sheet reads only its chunk index from the mapping, and each chunk of rows
+     * is decoded the first time it is read or written.
      * @param filePath Path to load the workbook from
      * @return True if the load was successful, false otherwise
      */
     bool loadWorkbook(const std::string& filePath);
 
+    /**
+     * @brief Saves the current workbook in the native binary format
+     *
+     * Meant for internal round trips such as autosave, server caches and worker handoff:
+     * cells are written as their storage chunks with the side tables they use, so saving and
+     * opening involve no XML. loadWorkbook recognizes these files.
+     * @param filePath Path to save the workbook
+     * @param compressBlocks Deflate blocks where that makes them smaller
+     * @return True if the save was successful, false otherwise
+     */
+    bool saveNativeWorkbook(const std::string& filePath, bool compressBlocks = false);
+
     /**
      * @brief Exports a specific sheet to a CSV file
      * @param sheetName Name of the sheet to export
@@ -0,0 +1,662 @@
+#include "NativeWorkbook.h"
+#include "ByteReader.h"
+#include "src/core/engine/StyleTable.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// File layout:
+//
+//   header     "WBXNATIV", u32 version, u32 byte order mark
+//   blocks     chunk records, per-sheet chunk indexes, string pages, the style table and
+//              the directory, each a checksummed run of bytes that may be deflated
+//   footer     BlockRef of the directory, "WBXNEND!"
+//
+//   directory  u32 sheet count; per sheet: name, BlockRef of its chunk index
+//              text table: u32 string count, u32 page count, BlockRef per page
+//              formula table: the same
+//              BlockRef of the style table
+//   index      u32 entry count; per chunk: u32 column, u32 chunk index, BlockRef
+//   chunk      ChunkHeader, u8 types[kChunkRows], then the lanes flagged in the header:
+//              f64 numbers[kChunkRows], u32 ids[kChunkRows], u32 styles[kChunkRows],
+//              and (u32 row offset, u32 formula) pairs
+//   page       u32 count, u32 end offset per string, the string bytes
+//
+// Names and strings are a u32 size followed by their bytes. Text, formula and style IDs
+// index the file's own tables, which hold only the entries its cells use.
+
+namespace {
+
+constexpr char kMagic[8] = {'W', 'B', 'X', 'N', 'A', 'T', 'I', 'V'};
+constexpr char kEndMagic[8] = {'W', 'B', 'X', 'N', 'E', 'N', 'D', '!'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr uint32_t kStringsPerPage = 4096;
+// Smaller blocks are never worth deflating
+constexpr size_t kMinCompressSize = 256;
+
+// Location of a block in the file
+struct BlockRef {
+    uint64_t offset = 0;
+    uint32_t storedSize = 0;
+    uint32_t rawSize = 0;
+    // CRC-32 of the raw bytes
+    uint32_t checksum = 0;
+    uint32_t compressed = 0;
+};
+
+static_assert(sizeof(BlockRef) == 24, "BlockRef is written as-is");
+
+enum ChunkLane : uint32_t { NumberLane = 1, IdLane = 2, StyleLane = 4 };
+
+struct ChunkHeader {
+    uint64_t present[CellChunk::kWords];
+    uint32_t cellCount;
+    uint32_t lanes;
+    uint32_t formulaCount;
+    uint32_t reserved;
+};
+
+constexpr size_t kFooterSize = sizeof(BlockRef) + sizeof(kEndMagic);
+constexpr size_t kHeaderSize = sizeof(kMagic) + 2 * sizeof(uint32_t);
+
+// Error of a ByteReader that runs past the end of a block
+constexpr char kTruncatedBlock[] = "Corrupt native workbook: truncated block";
+
+std::runtime_error corrupt(const char* what) {
+    return std::runtime_error(std::string("Corrupt native workbook: ") + what);
+}
+
+template <typename T>
+void append(std::string& out, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "only plain values are written as bytes");
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void appendArray(std::string& out, const T* values, size_t count) {
+    out.append(reinterpret_cast<const char*>(values), count * sizeof(T));
+}
+
+void appendText(std::string& out, const std::string& text) {
+    append(out, static_cast<uint32_t>(text.size()));
+    out += text;
+}
+
+// Read-only mapping of a whole file; the OS reads pages in as they are first touched
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open file");
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Unable to open file");
+        }
+        length = static_cast<size_t>(info.st_size);
+        void* mapped = length > 0 ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Unable to map file");
+        }
+        bytes = static_cast<const unsigned char*>(mapped);
+    }
+
+    ~MappedFile() {
+        if (bytes) {
+            munmap(const_cast<unsigned char*>(bytes), length);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+};
+
+// Raw bytes of a block: a view into the mapping, or the inflated copy of a deflated block
+struct Block {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    std::vector<unsigned char> inflated;
+};
+
+Block readBlock(const MappedFile& file, const BlockRef& ref) {
+    if (ref.offset > file.size() || ref.storedSize > file.size() - ref.offset) {
+        throw corrupt("block lies outside the file");
+    }
+    const unsigned char* stored = file.data() + ref.offset;
+    Block block;
+    block.size = ref.rawSize;
+    if (ref.compressed) {
+        block.inflated.resize(ref.rawSize);
+        uLongf inflatedSize = ref.rawSize;
+        if (uncompress(block.inflated.data(), &inflatedSize, stored, ref.storedSize) != Z_OK || inflatedSize != ref.rawSize) {
+            throw corrupt("bad deflate data");
+        }
+        block.data = block.inflated.data();
+    } else {
+        if (ref.storedSize != ref.rawSize) {
+            throw corrupt("block size mismatch");
+        }
+        block.data = stored;
+    }
+    if (crc32(crc32(0, Z_NULL, 0), block.data, ref.rawSize) != ref.checksum) {
+        throw corrupt("checksum mismatch");
+    }
+    return block;
+}
+
+// Appends checksummed blocks to the output file
+class BlockWriter {
+public:
+    BlockWriter(std::ofstream& output, bool compressBlocks) : stream(output), compress(compressBlocks) {}
+
+    BlockRef write(const std::string& raw) {
+        if (raw.size() > UINT32_MAX) {
+            throw std::runtime_error("Block too large");
+        }
+        BlockRef ref;
+        ref.offset = offset;
+        ref.rawSize = static_cast<uint32_t>(raw.size());
+        ref.checksum = static_cast<uint32_t>(crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(raw.data()), ref.rawSize));
+
+        const void* stored = raw.data();
+        ref.storedSize = ref.rawSize;
+        if (compress && raw.size() >= kMinCompressSize) {
+            uLongf deflatedSize = compressBound(raw.size());
+            scratch.resize(deflatedSize);
+            if (compress2(scratch.data(), &deflatedSize, reinterpret_cast<const Bytef*>(raw.data()), raw.size(), Z_BEST_SPEED) == Z_OK &&
+                deflatedSize < raw.size()) {
+                stored = scratch.data();
+                ref.storedSize = static_cast<uint32_t>(deflatedSize);
+                ref.compressed = 1;
+            }
+        }
+        writeBytes(stored, ref.storedSize);
+        return ref;
+    }
+
+    void writeBytes(const void* bytes, size_t length) {
+        stream.write(static_cast<const char*>(bytes), length);
+        if (!stream) {
+            throw std::runtime_error("Error writing file");
+        }
+        offset += length;
+    }
+
+private:
+    std::ofstream& stream;
+    bool compress;
+    uint64_t offset = 0;
+    std::vector<Bytef> scratch;
+};
+
+// Renumbers the IDs of one store side table densely, in order of first use. ID 0 (the empty
+// string, no formula, the default style) stays 0.
+class IdMap {
+public:
+    IdMap() : ids{{0, 0}}, sourceIds{0} {}
+
+    uint32_t map(uint32_t id) {
+        auto inserted = ids.emplace(id, static_cast<uint32_t>(sourceIds.size()));
+        if (inserted.second) {
+            sourceIds.push_back(id);
+        }
+        return inserted.first->second;
+    }
+
+    // Store IDs in file order
+    const std::vector<uint32_t>& used() const { return sourceIds; }
+
+private:
+    std::unordered_map<uint32_t, uint32_t> ids;
+    std::vector<uint32_t> sourceIds;
+};
+
+std::string encodeChunk(const CellChunk& chunk, IdMap& texts, IdMap& formulas, IdMap& styles) {
+    ChunkHeader header{};
+    std::memcpy(header.present, chunk.present, sizeof(header.present));
+    header.cellCount = chunk.cellCount;
+    if (!chunk.numbers.empty()) {
+        header.lanes |= NumberLane;
+    }
+    if (!chunk.ids.empty()) {
+        header.lanes |= IdLane;
+    }
+    if (!chunk.styles.empty()) {
+        header.lanes |= StyleLane;
+    }
+    header.formulaCount = static_cast<uint32_t>(chunk.formulas.size());
+
+    std::string raw;
+    append(raw, header);
+    appendArray(raw, chunk.types, CellChunk::kChunkRows);
+    if (!chunk.numbers.empty()) {
+        appendArray(raw, chunk.numbers.data(), CellChunk::kChunkRows);
+    }
+    if (!chunk.ids.empty()) {
+        // Only text IDs are renumbered; error codes are kept and stale entries cleared
+        std::vector<uint32_t> ids(CellChunk::kChunkRows, 0);
+        for (uint32_t offset = 0; offset < CellChunk::kChunkRows; ++offset) {
+            if (chunk.types[offset] == CellData::Text) {
+                ids[offset] = texts.map(chunk.ids[offset]);
+            } else if (chunk.types[offset] == CellData::Error) {
+                ids[offset] = chunk.ids[offset];
+            }
+        }
+        appendArray(raw, ids.data(), ids.size());
+    }
+    if (!chunk.styles.empty()) {
+        std::vector<StyleId> chunkStyles(CellChunk::kChunkRows);
+        for (uint32_t offset = 0; offset < CellChunk::kChunkRows; ++offset) {
+            chunkStyles[offset] = styles.map(chunk.styles[offset]);
+        }
+        appendArray(raw, chunkStyles.data(), chunkStyles.size());
+    }
+    for (const auto& formula : chunk.formulas) {
+        append(raw, formula.first);
+        append(raw, formulas.map(formula.second));
+    }
+    return raw;
+}
+
+// Writes a table of strings as pages of kStringsPerPage, so a reader inflates and checks only
+// the pages holding strings it needs
+template <typename Lookup>
+void writeStringTable(BlockWriter& writer, const std::vector<uint32_t>& ids, Lookup lookup, std::string& directory) {
+    std::vector<BlockRef> pages;
+    for (size_t first = 0; first < ids.size(); first += kStringsPerPage) {
+        const size_t count = std::min<size_t>(kStringsPerPage, ids.size() - first);
+        std::string bytes;
+        std::vector<uint32_t> ends;
+        ends.reserve(count);
+        for (size_t i = first; i < first + count; ++i) {
+            bytes += lookup(ids[i]);
+            ends.push_back(static_cast<uint32_t>(bytes.size()));
+        }
+        std::string page;
+        append(page, static_cast<uint32_t>(count));
+        appendArray(page, ends.data(), ends.size());
+        page += bytes;
+        pages.push_back(writer.write(page));
+    }
+    append(directory, static_cast<uint32_t>(ids.size()));
+    append(directory, static_cast<uint32_t>(pages.size()));
+    appendArray(directory, pages.data(), pages.size());
+}
+
+void appendFormat(std::string& out, const CellFormat& format) {
+    appendText(out, format.fontName);
+    append(out, format.fontSize);
+    append(out, static_cast<uint8_t>(format.isBold));
+    append(out, static_cast<uint8_t>(format.isItalic));
+    append(out, static_cast<uint8_t>(format.isUnderlined));
+    append(out, format.textColor);
+    append(out, format.backgroundColor);
+    append(out, static_cast<uint8_t>(format.horizontalAlignment));
+    append(out, static_cast<uint8_t>(format.verticalAlignment));
+    appendText(out, format.numberFormat);
+}
+
+CellFormat readFormat(ByteReader& reader) {
+    CellFormat format;
+    format.fontName = std::string(reader.text());
+    format.fontSize = reader.get<double>();
+    format.isBold = reader.get<uint8_t>() != 0;
+    format.isItalic = reader.get<uint8_t>() != 0;
+    format.isUnderlined = reader.get<uint8_t>() != 0;
+    format.textColor = reader.get<Color>();
+    format.backgroundColor = reader.get<Color>();
+    const uint8_t horizontal = reader.get<uint8_t>();
+    const uint8_t vertical = reader.get<uint8_t>();
+    if (horizontal > static_cast<uint8_t>(HorizontalAlignment::Justify) || vertical > static_cast<uint8_t>(VerticalAlignment::Bottom)) {
+        throw corrupt("bad alignment");
+    }
+    format.horizontalAlignment = static_cast<HorizontalAlignment>(horizontal);
+    format.verticalAlignment = static_cast<VerticalAlignment>(vertical);
+    format.numberFormat = std::string(reader.text());
+    return format;
+}
+
+// A paged string table of a mapped file. Pages are inflated and verified once, on first use.
+class StringPages {
+public:
+    void readDirectory(ByteReader& directory) {
+        count = directory.get<uint32_t>();
+        const uint32_t pageCount = directory.get<uint32_t>();
+        if (pageCount != (static_cast<uint64_t>(count) + kStringsPerPage - 1) / kStringsPerPage) {
+            throw corrupt("bad string table");
+        }
+        refs.resize(pageCount);
+        directory.getArray(refs.data(), pageCount);
+        pages.resize(pageCount);
+    }
+
+    std::string get(const MappedFile& file, uint32_t id) {
+        if (id >= count) {
+            throw corrupt("unknown string");
+        }
+        std::lock_guard<std::mutex> lock(pageMutex);
+        const uint32_t pageIndex = id / kStringsPerPage;
+        if (!pages[pageIndex]) {
+            pages[pageIndex] = std::make_unique<Block>(readBlock(file, refs[pageIndex]));
+        }
+        const Block& page = *pages[pageIndex];
+        ByteReader reader(page.data, page.size, kTruncatedBlock);
+        const uint32_t pageCount = reader.get<uint32_t>();
+        const uint32_t index = id % kStringsPerPage;
+        if (index >= pageCount) {
+            throw corrupt("bad string page");
+        }
+        const unsigned char* ends = reader.take(pageCount * sizeof(uint32_t));
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        if (index > 0) {
+            std::memcpy(&begin, ends + (index - 1) * sizeof(uint32_t), sizeof(uint32_t));
+        }
+        std::memcpy(&end, ends + index * sizeof(uint32_t), sizeof(uint32_t));
+        if (begin > end) {
+            throw corrupt("bad string page");
+        }
+        reader.take(begin);
+        return std::string(reinterpret_cast<const char*>(reader.take(end - begin)), end - begin);
+    }
+
+private:
+    uint32_t count = 0;
+    std::vector<BlockRef> refs;
+    std::vector<std::unique_ptr<Block>> pages;
+    std::mutex pageMutex;
+};
+
+// An opened file, shared by the loaders of its sheets
+struct NativeFile {
+    explicit NativeFile(const std::string& path) : mapping(path) {}
+
+    MappedFile mapping;
+    StringPages texts;
+    StringPages formulas;
+    std::vector<CellFormat> styles;
+};
+
+// Translates the file's table IDs to IDs in the store's tables, interning entries on first
+// use. Each chunk decode has its own, so the shared tables are locked once per distinct ID.
+class IdResolver {
+public:
+    IdResolver(NativeFile& source, WorkbookTables& target) : file(source), tables(target) {}
+
+    StringId text(uint32_t id) {
+        return resolve(texts, id, [this](uint32_t fileId) { return tables.texts.intern(file.texts.get(file.mapping, fileId)); });
+    }
+
+    FormulaId formula(uint32_t id) {
+        const uint32_t formulaId = resolve(formulas, id, [this](uint32_t fileId) {
+            return tables.formulas.intern(file.formulas.get(file.mapping, fileId));
+        });
+        if (formulaId > kMaxFormulaId) {
+            throw std::runtime_error("Too many distinct formulas");
+        }
+        return formulaId;
+    }
+
+    StyleId style(uint32_t id) {
+        return resolve(styles, id, [this](uint32_t fileId) {
+            if (fileId >= file.styles.size()) {
+                throw corrupt("unknown style");
+            }
+            return tables.styles->intern(file.styles[fileId]);
+        });
+    }
+
+private:
+    NativeFile& file;
+    WorkbookTables& tables;
+    std::unordered_map<uint32_t, uint32_t> texts;
+    std::unordered_map<uint32_t, uint32_t> formulas;
+    std::unordered_map<uint32_t, uint32_t> styles;
+
+    template <typename Intern>
+    uint32_t resolve(std::unordered_map<uint32_t, uint32_t>& cache, uint32_t id, Intern intern) {
+        if (id == 0) {
+            return 0;
+        }
+        auto it = cache.find(id);
+        if (it == cache.end()) {
+            it = cache.emplace(id, intern(id)).first;
+        }
+        return it->second;
+    }
+};
+
+std::shared_ptr<CellChunk> decodeChunk(const Block& block, IdResolver& ids) {
+    ByteReader reader(block.data, block.size, kTruncatedBlock);
+    const ChunkHeader header = reader.get<ChunkHeader>();
+    if (header.formulaCount > CellChunk::kChunkRows) {
+        throw corrupt("bad chunk");
+    }
+
+    auto chunk = std::make_shared<CellChunk>();
+    std::memcpy(chunk->present, header.present, sizeof(chunk->present));
+    chunk->cellCount = header.cellCount;
+    uint32_t populated = 0;
+    for (uint64_t word : chunk->present) {
+        populated += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+    reader.getArray(chunk->types, CellChunk::kChunkRows);
+    if (populated != chunk->cellCount ||
+        std::any_of(std::begin(chunk->types), std::end(chunk->types), [](uint8_t type) { return type > CellData::Error; })) {
+        throw corrupt("bad chunk");
+    }
+
+    if (header.lanes & NumberLane) {
+        chunk->numbers.resize(CellChunk::kChunkRows);
+        reader.getArray(chunk->numbers.data(), CellChunk::kChunkRows);
+    }
+    if (header.lanes & IdLane) {
+        chunk->ids.resize(CellChunk::kChunkRows);
+        reader.getArray(chunk->ids.data(), CellChunk::kChunkRows);
+        for (uint32_t offset = 0; offset < CellChunk::kChunkRows; ++offset) {
+            if (chunk->types[offset] == CellData::Text) {
+                chunk->ids[offset] = ids.text(chunk->ids[offset]);
+            }
+        }
+    }
+    if (header.lanes & StyleLane) {
+        chunk->styles.resize(CellChunk::kChunkRows);
+        reader.getArray(chunk->styles.data(), CellChunk::kChunkRows);
+        for (StyleId& style : chunk->styles) {
+            style = ids.style(style);
+        }
+    }
+    chunk->formulas.resize(header.formulaCount);
+    for (auto& formula : chunk->formulas) {
+        formula.first = reader.get<uint32_t>();
+        formula.second = ids.formula(reader.get<uint32_t>());
+        if (formula.first >= CellChunk::kChunkRows || (&formula != &chunk->formulas.front() && formula.first <= (&formula - 1)->first)) {
+            throw corrupt("bad chunk");
+        }
+    }
+    return chunk;
+}
+
+struct ChunkEntry {
+    uint32_t column;
+    uint32_t chunkIndex;
+    BlockRef block;
+};
+
+// Builds a sheet from its chunk index alone; each chunk is decoded from the mapping the first
+// time it is read or written, so opening a sheet costs the same whatever its size
+std::shared_ptr<const SheetData> loadSheet(const std::shared_ptr<NativeFile>& file, const BlockRef& indexRef,
+                                           WorkbookTables& tables) {
+    std::vector<ChunkEntry> entries;
+    {
+        Block index = readBlock(file->mapping, indexRef);
+        ByteReader reader(index.data, index.size, kTruncatedBlock);
+        const uint32_t count = reader.get<uint32_t>();
+        if (count > index.size / sizeof(ChunkEntry)) {
+            throw corrupt("bad chunk index");
+        }
+        entries.resize(count);
+        for (ChunkEntry& entry : entries) {
+            entry.column = reader.get<uint32_t>();
+            entry.chunkIndex = reader.get<uint32_t>();
+            entry.block = reader.get<BlockRef>();
+            if (entry.column >= kMaxColumns || entry.chunkIndex >= kMaxRows / CellChunk::kChunkRows) {
+                throw corrupt("chunk lies outside the sheet");
+            }
+        }
+    }
+
+    // The tables outlive every version that can reach these chunks, as they do the sheet
+    auto sheet = std::make_shared<SheetData>();
+    for (const ChunkEntry& entry : entries) {
+        if (sheet->columns.size() <= entry.column) {
+            sheet->columns.resize(entry.column + 1);
+        }
+        auto& column = sheet->columns[entry.column];
+        if (!column) {
+            column = std::make_shared<ColumnData>();
+        }
+        if (column->lazyChunks.size() <= entry.chunkIndex) {
+            column->lazyChunks.resize(entry.chunkIndex + 1);
+        }
+        auto lazy = std::make_shared<LazyChunk>();
+        lazy->load = [file, block = entry.block, &tables]() {
+            IdResolver ids(*file, tables);
+            return decodeChunk(readBlock(file->mapping, block), ids);
+        };
+        column->lazyChunks[entry.chunkIndex] = std::move(lazy);
+    }
+    return sheet;
+}
+
+} // namespace
+
+bool NativeWorkbook::isNativeFile(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+}
+
+void NativeWorkbook::save(const DataSnapshot& snapshot, const std::string& filePath, bool compressBlocks) {
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Unable to open file for writing");
+    }
+    BlockWriter writer(file, compressBlocks);
+
+    std::string header(kMagic, sizeof(kMagic));
+    append(header, kVersion);
+    append(header, kByteOrderMark);
+    writer.writeBytes(header.data(), header.size());
+
+    IdMap texts;
+    IdMap formulas;
+    IdMap styles;
+    std::string directory;
+    const std::vector<std::string> sheetNames = snapshot.getSheetNames();
+    append(directory, static_cast<uint32_t>(sheetNames.size()));
+    for (const std::string& sheetName : sheetNames) {
+        std::string index;
+        uint32_t count = 0;
+        append(index, count);
+        snapshot.forEachChunk(sheetName, [&](uint32_t column, uint32_t chunkIndex, const CellChunk& chunk) {
+            const BlockRef block = writer.write(encodeChunk(chunk, texts, formulas, styles));
+            append(index, column);
+            append(index, chunkIndex);
+            append(index, block);
+            ++count;
+        });
+        std::memcpy(&index[0], &count, sizeof(count));
+
+        appendText(directory, sheetName);
+        append(directory, writer.write(index));
+    }
+
+    writeStringTable(writer, texts.used(), [&snapshot](uint32_t id) -> const std::string& { return snapshot.getText(id); }, directory);
+    writeStringTable(writer, formulas.used(), [&snapshot](uint32_t id) -> const std::string& { return snapshot.getFormula(id); }, directory);
+
+    std::string styleTable;
+    append(styleTable, static_cast<uint32_t>(styles.used().size()));
+    for (StyleId id : styles.used()) {
+        appendFormat(styleTable, snapshot.getFormat(id));
+    }
+    append(directory, writer.write(styleTable));
+
+    std::string footer;
+    append(footer, writer.write(directory));
+    footer.append(kEndMagic, sizeof(kEndMagic));
+    writer.writeBytes(footer.data(), footer.size());
+
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Error writing file");
+    }
+}
+
+std::vector<std::pair<std::string, LazySheet::SheetLoader>> NativeWorkbook::open(const std::string& filePath) {
+    auto file = std::make_shared<NativeFile>(filePath);
+    const MappedFile& mapping = file->mapping;
+    if (mapping.size() < kHeaderSize + kFooterSize || std::memcmp(mapping.data(), kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("Not a native workbook");
+    }
+    ByteReader header(mapping.data() + sizeof(kMagic), kHeaderSize - sizeof(kMagic), kTruncatedBlock);
+    if (header.get<uint32_t>() != kVersion) {
+        throw std::runtime_error("Unsupported native workbook version");
+    }
+    if (header.get<uint32_t>() != kByteOrderMark) {
+        throw std::runtime_error("Native workbook was written with another byte order");
+    }
+
+    const unsigned char* footer = mapping.data() + mapping.size() - kFooterSize;
+    if (std::memcmp(footer + sizeof(BlockRef), kEndMagic, sizeof(kEndMagic)) != 0) {
+        throw corrupt("missing directory");
+    }
+    const Block directory = readBlock(mapping, ByteReader(footer, sizeof(BlockRef), kTruncatedBlock).get<BlockRef>());
+    ByteReader reader(directory.data, directory.size, kTruncatedBlock);
+
+    const uint32_t sheetCount = reader.get<uint32_t>();
+    std::vector<std::pair<std::string, BlockRef>> sheets;
+    for (uint32_t i = 0; i < sheetCount; ++i) {
+        std::string name(reader.text());
+        sheets.emplace_back(std::move(name), reader.get<BlockRef>());
+    }
+    file->texts.readDirectory(reader);
+    file->formulas.readDirectory(reader);
+
+    const Block styleTable = readBlock(mapping, reader.get<BlockRef>());
+    ByteReader styleReader(styleTable.data, styleTable.size, kTruncatedBlock);
+    const uint32_t styleCount = styleReader.get<uint32_t>();
+    for (uint32_t i = 0; i < styleCount; ++i) {
+        file->styles.push_back(readFormat(styleReader));
+    }
+
+    std::vector<std::pair<std::string, LazySheet::SheetLoader>> loaders;
+    loaders.reserve(sheets.size());
+    for (auto& sheet : sheets) {
+        loaders.emplace_back(std::move(sheet.first), [file, index = sheet.second](WorkbookTables& tables) {
+            return loadSheet(file, index, tables);
+        });
+    }
+    return loaders;
+}
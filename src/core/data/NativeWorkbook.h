@@ -0,0 +1,41 @@
+#ifndef NATIVE_WORKBOOK_H
+#define NATIVE_WORKBOOK_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "src/core/data/DataStore.h"
+
+// Native binary workbook format for internal round trips (autosave, server cache, worker
+// handoff), where nothing needs to read XML. Cells are stored as the DataStore keeps them:
+// one block per column chunk holding its typed lanes, next to paged string and formula
+// tables and a style table. Every block carries a CRC-32 and may be deflated.
+// The file is opened by memory-mapping it and reading only its directory, so opening takes
+// the same time whatever the workbook's size. A sheet's chunk index is read when the sheet is
+// first used, and each chunk is paged in and decoded when its rows are first read, so
+// untouched sheets and rows are never read from disk.
+// Values are written in host byte order; files from a host of the other order are rejected.
+class NativeWorkbook {
+public:
+    // Returns true if the file starts with the native format's signature
+    static bool isNativeFile(const std::string& filePath);
+
+    // Writes every sheet of a snapshot to filePath, with the text, formulas and styles its
+    // cells use. With compressBlocks, blocks are deflated where that makes them smaller.
+    // Throws std::runtime_error if the file cannot be written.
+    static void save(const DataSnapshot& snapshot, const std::string& filePath, bool compressBlocks);
+
+    // Maps filePath and reads its directory; returns a loader per sheet, in file order, that
+    // reads the sheet's chunk index from the mapping on first use and leaves each chunk to be
+    // decoded on first access. The mapping is released once every loader and undecoded chunk
+    // is gone. Throws std::runtime_error if the file is not a valid native workbook; a loader
+    // throws if its sheet's index is corrupt, and reading a chunk throws if its block is.
+    static std::vector<std::pair<std::string, LazySheet::SheetLoader>> open(const std::string& filePath);
+};
+
+// Human tasks:
+// - Map files through CreateFileMapping on Windows
+// - Store compiled formula programs once the calculation engine has a compiled form
+// - Copy undecoded chunks' blocks as they are when saving, instead of decoding and re-encoding
+
+#endif // NATIVE_WORKBOOK_H
@@ -0,0 +1,226 @@
+#include "SortEngine.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// Below this many rows per thread, splitting the sort costs more than it saves
+constexpr size_t kMinRowsPerThread = 16 * 1024;
+
+// Optimistic sorts tried before sorting with the sheet's writers held off
+constexpr int kOptimisticSortAttempts = 3;
+
+// Type order of a sort; blanks sort last in either direction
+enum KeyClass : uint8_t { NumberKey, TextKey, BooleanKey, ErrorKey, BlankKey };
+
+// One extracted key column: a class per row, and within a class a value that orders it
+// (the number, the text's collation rank, or 0/1 for booleans)
+struct KeyColumn {
+    std::vector<uint8_t> classes;
+    std::vector<double> values;
+    bool ascending = true;
+};
+
+KeyColumn extractKey(const DataSnapshot& snapshot, const std::string& sheetName, const CellRange& range, const SortKey& key) {
+    std::vector<CellData> cells = snapshot.getColumnCells(sheetName, key.column, range.first.row, range.last.row);
+
+    // Rank the distinct strings once so rows compare by number instead of by string
+    std::vector<StringId> textIds;
+    for (const CellData& cell : cells) {
+        if (cell.getType() == CellData::Text) {
+            textIds.push_back(cell.getTextId());
+        }
+    }
+    std::sort(textIds.begin(), textIds.end());
+    textIds.erase(std::unique(textIds.begin(), textIds.end()), textIds.end());
+
+    std::vector<std::pair<std::string, StringId>> collation;
+    collation.reserve(textIds.size());
+    for (StringId id : textIds) {
+        const std::string& text = snapshot.getText(id);
+        collation.emplace_back(key.caseSensitive ? text : foldCase(text), id);
+    }
+    std::sort(collation.begin(), collation.end());
+    std::unordered_map<StringId, double> textRanks;
+    double rank = 0;
+    for (size_t i = 0; i < collation.size(); ++i) {
+        if (i > 0 && collation[i].first != collation[i - 1].first) {
+            ++rank;
+        }
+        textRanks[collation[i].second] = rank;
+    }
+
+    KeyColumn column;
+    column.ascending = key.ascending;
+    column.classes.resize(cells.size());
+    column.values.resize(cells.size());
+    for (size_t row = 0; row < cells.size(); ++row) {
+        const CellData& cell = cells[row];
+        switch (cell.getType()) {
+            case CellData::Number:
+                column.classes[row] = NumberKey;
+                column.values[row] = cell.getNumber();
+                break;
+            case CellData::Text:
+                column.classes[row] = TextKey;
+                column.values[row] = textRanks[cell.getTextId()];
+                break;
+            case CellData::Boolean:
+                column.classes[row] = BooleanKey;
+                column.values[row] = cell.getNumber();
+                break;
+            case CellData::Error:
+                column.classes[row] = ErrorKey;
+                break;
+            case CellData::Empty:
+                column.classes[row] = BlankKey;
+                break;
+        }
+    }
+    return column;
+}
+
+} // namespace
+
+SortEngine::SortEngine(DataStore* store, size_t threads)
+    : dataStore(store), threadCount(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+std::vector<uint32_t> SortEngine::getSortPermutation(const DataSnapshot& snapshot, const std::string& qualifiedRange,
+                                                     const std::vector<SortKey>& keys) const {
+    std::string sheetName;
+    CellRange range;
+    snapshot.resolveQualifiedRange(qualifiedRange, sheetName, range);
+    if (keys.empty()) {
+        throw std::invalid_argument("No sort keys given");
+    }
+
+    std::vector<KeyColumn> keyColumns;
+    for (const SortKey& key : keys) {
+        if (key.column < range.first.column || key.column > range.last.column) {
+            throw std::invalid_argument("Sort key column lies outside the range");
+        }
+        keyColumns.push_back(extractKey(snapshot, sheetName, range, key));
+    }
+
+    auto less = [&keyColumns](uint32_t a, uint32_t b) {
+        for (const KeyColumn& key : keyColumns) {
+            const uint8_t classA = key.classes[a];
+            const uint8_t classB = key.classes[b];
+            if (classA != classB) {
+                if (classA == BlankKey || classB == BlankKey) {
+                    return classB == BlankKey;
+                }
+                return key.ascending ? classA < classB : classA > classB;
+            }
+            const double valueA = key.values[a];
+            const double valueB = key.values[b];
+            if (valueA != valueB) {
+                return key.ascending ? valueA < valueB : valueA > valueB;
+            }
+        }
+        return false;
+    };
+
+    // Stable-sort one run per thread, then merge neighbouring runs pairwise in parallel.
+    // std::merge takes from the left run on ties, so the result stays stable.
+    const size_t rowCount = range.rowCount();
+    std::vector<uint32_t> permutation(rowCount);
+    std::iota(permutation.begin(), permutation.end(), 0u);
+
+    const size_t runCount = std::max<size_t>(1, std::min(threadCount, rowCount / kMinRowsPerThread));
+    std::vector<size_t> bounds(runCount + 1);
+    for (size_t i = 0; i <= runCount; ++i) {
+        bounds[i] = rowCount * i / runCount;
+    }
+
+    auto runParallel = [](size_t count, auto task) {
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < count; ++i) {
+            threads.emplace_back(task, i);
+        }
+        task(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+
+    runParallel(runCount, [&](size_t run) {
+        std::stable_sort(permutation.begin() + bounds[run], permutation.begin() + bounds[run + 1], less);
+    });
+
+    std::vector<uint32_t> merged(rowCount);
+    while (bounds.size() > 2) {
+        const size_t pairs = (bounds.size() - 1) / 2;
+        runParallel(pairs, [&](size_t pair) {
+            const size_t begin = bounds[2 * pair];
+            const size_t middle = bounds[2 * pair + 1];
+            const size_t end = bounds[2 * pair + 2];
+            std::merge(permutation.begin() + begin, permutation.begin() + middle,
+                       permutation.begin() + middle, permutation.begin() + end,
+                       merged.begin() + begin, less);
+        });
+
+        // An odd run out has nothing to merge with this round
+        if ((bounds.size() - 1) % 2 == 1) {
+            std::copy(permutation.begin() + bounds[bounds.size() - 2], permutation.end(),
+                      merged.begin() + bounds[bounds.size() - 2]);
+        }
+        permutation.swap(merged);
+
+        std::vector<size_t> next;
+        for (size_t i = 0; i < bounds.size(); i += 2) {
+            next.push_back(bounds[i]);
+        }
+        if (next.back() != rowCount) {
+            next.push_back(rowCount);
+        }
+        bounds.swap(next);
+    }
+    return permutation;
+}
+
+std::vector<uint32_t> SortEngine::sortRange(const std::string& qualifiedRange, const std::vector<SortKey>& keys) {
+    std::lock_guard<std::mutex> lock(sortMutex);
+
+    // Sort a snapshot without blocking writers, then commit only if the range is unchanged;
+    // an edit that landed meanwhile means sorting the new contents again
+    std::string sheetName;
+    CellRange range;
+    for (int attempt = 0; attempt < kOptimisticSortAttempts; ++attempt) {
+        DataSnapshot snapshot = dataStore->createSnapshot();
+        std::vector<uint32_t> permutation = getSortPermutation(snapshot, qualifiedRange, keys);
+        snapshot.resolveQualifiedRange(qualifiedRange, sheetName, range);
+        if (dataStore->setCellValuesIfUnchanged(sheetName, snapshot, range, permuteRows(snapshot, sheetName, range, permutation))) {
+            return permutation;
+        }
+    }
+
+    // The range keeps changing under us, so sort once more with the sheet's writers held off
+    std::vector<uint32_t> permutation;
+    dataStore->updateCells(sheetName, [&](const DataSnapshot& snapshot) {
+        permutation = getSortPermutation(snapshot, qualifiedRange, keys);
+        return permuteRows(snapshot, sheetName, range, permutation);
+    });
+    return permutation;
+}
+
+// Apply the permutation to every column of the range; rows that stay put are not written
+std::vector<std::pair<CellAddress, CellData>> SortEngine::permuteRows(const DataSnapshot& snapshot, const std::string& sheetName,
+                                                                      const CellRange& range,
+                                                                      const std::vector<uint32_t>& permutation) {
+    std::vector<std::pair<CellAddress, CellData>> writes;
+    for (uint32_t col = range.first.column; col <= range.last.column; ++col) {
+        std::vector<CellData> cells = snapshot.getColumnCells(sheetName, col, range.first.row, range.last.row);
+        for (uint32_t row = 0; row < permutation.size(); ++row) {
+            const CellData& moved = cells[permutation[row]];
+            if (permutation[row] != row && !(moved.isEmpty() && cells[row].isEmpty())) {
+                writes.emplace_back(CellAddress{range.first.row + row, col}, moved);
+            }
+        }
+    }
+    return writes;
+}
+
@@ -0,0 +1,54 @@
+#ifndef SORT_ENGINE_H
+#define SORT_ENGINE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+#include "src/core/data/DataStore.h"
+
+// One sort key: a column of the sheet and its direction
+struct SortKey {
+    uint32_t column = 0;
+    bool ascending = true;
+    bool caseSensitive = false;
+};
+
+// Sorts the rows of a range by several keys, the way a spreadsheet does: stable, and ordered by
+// type first (numbers, then text, then booleans, then errors) with blanks always last.
+// Keys are extracted once from a snapshot into flat per-column arrays, a permutation is sorted
+// by a parallel merge sort over them, and the permutation is then applied to every column of
+// the range in a single committed version.
+class SortEngine {
+public:
+    // threadCount 0 uses the hardware concurrency
+    explicit SortEngine(DataStore* store, size_t threadCount = 0);
+
+    // Sorts the rows of a range such as "Sheet1!A2:F100000" (without its header row) and
+    // returns the permutation applied: row i of the result came from row result[i] of the
+    // range. Cells move as they are; formulas are not re-pointed. If writes keep changing the
+    // range while it is sorted, the last attempt holds the sheet's writers off until it commits.
+    // Throws std::invalid_argument if there are no keys or a key lies outside the range.
+    std::vector<uint32_t> sortRange(const std::string& qualifiedRange, const std::vector<SortKey>& keys);
+
+    // Computes the stable sort permutation of a range without changing any cells
+    std::vector<uint32_t> getSortPermutation(const DataSnapshot& snapshot, const std::string& qualifiedRange,
+                                             const std::vector<SortKey>& keys) const;
+
+private:
+    DataStore* dataStore;
+    size_t threadCount;
+    mutable std::mutex sortMutex;
+
+    // Cells to write so the range's rows end up in permutation order
+    static std::vector<std::pair<CellAddress, CellData>> permuteRows(const DataSnapshot& snapshot, const std::string& sheetName,
+                                                                     const CellRange& range,
+                                                                     const std::vector<uint32_t>& permutation);
+};
+
+// Human tasks:
+// - Adjust relative references of formulas moved by a sort
+// - Add custom sort lists (e.g. month and weekday names) and sorting by cell color or icon
+// - Support sorting columns left to right
+
+#endif // SORT_ENGINE_H
@@ -0,0 +1,51 @@
+#include "StringTable.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <limits>
+
+// Constructor: ID 0 is the empty string
+StringTable::StringTable() {
+    strings.emplace_back();
+    stringIds.emplace(strings.back(), kEmptyStringId);
+}
+
+// Intern a string, returning the ID of an existing equal string where possible
+StringId StringTable::intern(const std::string& value) {
+    std::lock_guard<std::mutex> lock(stringMutex);
+
+    auto it = stringIds.find(value);
+    if (it != stringIds.end()) {
+        return it->second;
+    }
+
+    if (strings.size() >= std::numeric_limits<StringId>::max()) {
+        throw std::length_error("String table is full");
+    }
+
+    StringId id = static_cast<StringId>(strings.size());
+    strings.push_back(value);
+    stringIds.emplace(strings.back(), id);
+    return id;
+}
+
+// Look up a string by ID
+const std::string& StringTable::get(StringId id) const {
+    std::lock_guard<std::mutex> lock(stringMutex);
+    if (id >= strings.size()) {
+        throw std::out_of_range("Unknown string ID: " + std::to_string(id));
+    }
+    return strings[id];
+}
+
+size_t StringTable::size() const {
+    std::lock_guard<std::mutex> lock(stringMutex);
+    return strings.size();
+}
+
+std::string foldCase(std::string_view text) {
+    std::string folded(text);
+    std::transform(folded.begin(), folded.end(), folded.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return folded;
+}
@@ -0,0 +1,46 @@
+#ifndef STRING_TABLE_H
+#define STRING_TABLE_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <mutex>
+
+// Identifier of a string interned in a StringTable; 0 is always the empty string
+using StringId = uint32_t;
+constexpr StringId kEmptyStringId = 0;
+
+// Workbook-wide table of distinct strings (cell text, formula text).
+// Each distinct string is stored once and cells carry only its 32-bit ID. Strings are never
+// removed, so IDs held by older snapshots stay valid and returned references stay stable.
+class StringTable {
+public:
+    // Initializes the table with the empty string as ID 0
+    StringTable();
+
+    StringTable(const StringTable&) = delete;
+    StringTable& operator=(const StringTable&) = delete;
+
+    // Returns the ID of an equal string, adding it to the table if it is new
+    StringId intern(const std::string& value);
+
+    // Returns the string for an ID; throws std::out_of_range for unknown IDs
+    const std::string& get(StringId id) const;
+
+    // Returns the number of distinct strings
+    size_t size() const;
+
+private:
+    // deque keeps element addresses stable, so the index can key on views into it
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, StringId> stringIds;
+    mutable std::mutex stringMutex;
+};
+
+// Returns text lowered byte by byte: the case-insensitive form that sorting and filtering
+// both compare, so sort order and filter matches agree
+std::string foldCase(std::string_view text);
+
+#endif // STRING_TABLE_H
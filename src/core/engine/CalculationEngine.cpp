@@ -1,6 +1,8 @@
 #include "CalculationEngine.h"
 #include "FormulaParser.h"
 #include "CellManager.h"
+#include "CellAddress.h"
+#include <string_view>
 #include <queue>
 #include <unordered_set>
 #include <stdexcept>
@@ -18,14 +20,19 @@ CalculationEngine::CalculationEngine(FormulaParser* parser, CellManager* manager
 // Recalculate a specific cell
 void CalculationEngine::recalculateCell(const std::string& cellReference) {
     std::lock_guard<std::mutex> lock(calculationMutex);
+    evaluateCell(cellReference);
+}
 
+void CalculationEngine::evaluateCell(const std::string& cellReference) {
     // Get the current cell value from CellManager
     std::string cellValue = cellManager->getCellValue(cellReference);
 
     // If the cell contains a formula, parse and evaluate it
     if (cellValue.length() > 0 && cellValue[0] == '=') {
         try {
-            double result = formulaParser->parseFormula(cellValue.substr(1));
+            double result = formulaParser->parseFormula(cellValue.substr(1), [this](const std::string& reference) {
+                return cellManager->getCellValue(reference);
+            });
             cellManager->setCellValue(cellReference, std::to_string(result));
         } catch (const std::runtime_error& e) {
             // Handle formula parsing or evaluation errors
@@ -34,38 +41,172 @@ void CalculationEngine::recalculateCell(const std::string& cellReference) {
     }
 }
 
-// Recalculate all cells in the spreadsheet
+// Recalculate all cells in the spreadsheet, in dependency order (Kahn's algorithm)
 void CalculationEngine::recalculateAll() {
     std::lock_guard<std::mutex> lock(calculationMutex);
     isCalculating = true;
 
-    // Get all cell references from CellManager
-    std::vector<std::string> allCells = cellManager->getAllCellReferences();
-
-    // Create a queue of cells to recalculate
+    // Count each graph cell's precedents; cells without any are ready first
+    std::unordered_map<std::string, size_t> pendingPrecedents;
+    for (const auto& entry : dependencyGraph) {
+        for (const auto& dependentCell : entry.second) {
+            ++pendingPrecedents[dependentCell];
+        }
+    }
     std::queue<std::string> cellQueue;
-    for (const auto& cell : allCells) {
-        cellQueue.push(cell);
+    for (const auto& entry : dependencyGraph) {
+        if (pendingPrecedents.count(entry.first) == 0) {
+            cellQueue.push(entry.first);
+        }
     }
 
-    // Process the queue
+    // Process the queue; a dependent becomes ready once all its precedents are evaluated
+    std::unordered_set<std::string> evaluated;
     while (!cellQueue.empty()) {
-        std::string currentCell = cellQueue.front();
+        std::string currentCell = std::move(cellQueue.front());
         cellQueue.pop();
 
-        recalculateCell(currentCell);
+        evaluateCell(currentCell);
+        evaluated.insert(currentCell);
 
-        // Add dependent cells to the queue
-        if (dependencyGraph.find(currentCell) != dependencyGraph.end()) {
-            for (const auto& dependentCell : dependencyGraph[currentCell]) {
-                cellQueue.push(dependentCell);
+        auto it = dependencyGraph.find(currentCell);
+        if (it != dependencyGraph.end()) {
+            for (const auto& dependentCell : it->second) {
+                if (--pendingPrecedents[dependentCell] == 0) {
+                    cellQueue.push(dependentCell);
+                }
             }
         }
     }
 
+    // Cells outside the graph, and cells on a circular reference, which never became ready
+    for (const auto& cell : cellManager->getAllCellReferences()) {
+        if (evaluated.count(cell) == 0) {
+            evaluateCell(cell);
+        }
+    }
+
     isCalculating = false;
 }
 
+// Rebuild the graph from scratch from the references of every formula cell
+void CalculationEngine::buildDependencyGraph() {
+    std::lock_guard<std::mutex> lock(calculationMutex);
+    dependencyGraph.clear();
+
+    for (const auto& cell : cellManager->getAllCellReferences()) {
+        std::string cellValue = cellManager->getCellValue(cell);
+        if (cellValue.empty() || cellValue[0] != '=') {
+            continue;
+        }
+        try {
+            for (const auto& reference : formulaParser->compile(cellValue.substr(1)).references()) {
+                // Key precedents by their canonical form, as recalculateRange looks them up
+                dependencyGraph[formatCellAddress(parseCellAddress(reference))].insert(cell);
+            }
+        } catch (const std::exception&) {
+            // A malformed formula or reference gets no edges; evaluating it reports the error
+        }
+    }
+}
+
+void CalculationEngine::recalculate(const std::string& cellReference) {
+    CellAddress cell = parseCellAddress(cellReference);
+    recalculateRange(CellRange{cell, cell});
+}
+
+// Recalculate the block's own formulas, then walk the dependency graph outwards from it
+void CalculationEngine::recalculateRange(const CellRange& range) {
+    std::vector<std::string> order;
+    std::vector<std::string_view> values;
+    cellManager->readBlock(range, values);
+    const uint32_t cols = range.columnCount();
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (!values[i].empty() && values[i][0] == '=') {
+            order.push_back(formatCellAddress(CellAddress{range.first.row + static_cast<uint32_t>(i / cols),
+                                                          range.first.column + static_cast<uint32_t>(i % cols)}));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(calculationMutex);
+    std::queue<std::string> pending;
+    auto enqueueDependents = [&](const std::unordered_set<std::string>& dependents) {
+        for (const auto& dependent : dependents) {
+            pending.push(dependent);
+        }
+    };
+
+    // Probe the block's cells or scan the graph, whichever is smaller
+    if (range.cellCount() < dependencyGraph.size()) {
+        for (uint32_t row = range.first.row; row <= range.last.row; ++row) {
+            for (uint32_t col = range.first.column; col <= range.last.column; ++col) {
+                auto it = dependencyGraph.find(formatCellAddress(CellAddress{row, col}));
+                if (it != dependencyGraph.end()) {
+                    enqueueDependents(it->second);
+                }
+            }
+        }
+    } else {
+        for (const auto& entry : dependencyGraph) {
+            if (range.contains(parseCellAddress(entry.first))) {
+                enqueueDependents(entry.second);
+            }
+        }
+    }
+
+    std::unordered_set<std::string> visited(order.begin(), order.end());
+    while (!pending.empty()) {
+        std::string cell = std::move(pending.front());
+        pending.pop();
+        if (!visited.insert(cell).second) {
+            continue;
+        }
+        auto it = dependencyGraph.find(cell);
+        if (it != dependencyGraph.end()) {
+            enqueueDependents(it->second);
+        }
+        order.push_back(std::move(cell));
+    }
+
+    // Evaluating a formula replaces it with its value, so precedents must go before their
+    // dependents: order the affected cells by the graph's edges among them, cycles last
+    std::unordered_map<std::string, size_t> pendingPrecedents;
+    for (const auto& cell : order) {
+        auto it = dependencyGraph.find(cell);
+        if (it != dependencyGraph.end()) {
+            for (const auto& dependent : it->second) {
+                ++pendingPrecedents[dependent];
+            }
+        }
+    }
+    std::queue<std::string> ready;
+    for (const auto& cell : order) {
+        if (pendingPrecedents.count(cell) == 0) {
+            ready.push(cell);
+        }
+    }
+    std::unordered_set<std::string> evaluated;
+    while (!ready.empty()) {
+        std::string cell = std::move(ready.front());
+        ready.pop();
+        evaluateCell(cell);
+        evaluated.insert(cell);
+        auto it = dependencyGraph.find(cell);
+        if (it != dependencyGraph.end()) {
+            for (const auto& dependent : it->second) {
+                if (--pendingPrecedents[dependent] == 0) {
+                    ready.push(dependent);
+                }
+            }
+        }
+    }
+    for (const auto& cell : order) {
+        if (evaluated.count(cell) == 0) {
+            evaluateCell(cell);
+        }
+    }
+}
+
 // Update the dependency graph when a cell formula changes
 void CalculationEngine::updateDependencyGraph(const std::string& cellReference, const std::vector<std::string>& dependencies) {
     std::lock_guard<std::mutex> lock(calculationMutex);
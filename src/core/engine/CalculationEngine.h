@@ -9,6 +9,7 @@
 
 class FormulaParser;
 class CellManager;
+struct CellRange;
 
 class CalculationEngine {
 public:
@@ -18,9 +19,20 @@ public:
     // Recalculates the value of a specific cell
     void recalculateCell(const std::string& cellReference);
 
-    // Recalculates all cells in the spreadsheet
+    // Recalculates all cells in the spreadsheet, precedents before dependents; cells on a
+    // circular reference are evaluated last, once each, in no particular order
     void recalculateAll();
 
+    // Rebuilds the dependency graph from the formulas of every cell, e.g. after a bulk import
+    void buildDependencyGraph();
+
+    // Recalculates a changed cell if it holds a formula, then every cell that depends on it
+    void recalculate(const std::string& cellReference);
+
+    // Recalculates the formula cells of a written block, then every cell that depends on a
+    // cell inside it, each once, instead of the whole sheet
+    void recalculateRange(const CellRange& range);
+
     // Updates the dependency graph when a cell formula changes
     void updateDependencyGraph(const std::string& cellReference, const std::vector<std::string>& dependencies);
 
@@ -34,7 +46,8 @@ private:
     mutable std::mutex calculationMutex;
     bool isCalculating;
 
-    // Add any additional private methods here
+    // Evaluates a formula cell and stores the result. Caller must hold calculationMutex.
+    void evaluateCell(const std::string& cellReference);
 };
 
 // Human tasks:
@@ -0,0 +1,138 @@
+#ifndef CELL_ADDRESS_H
+#define CELL_ADDRESS_H
+
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+
+// Largest row and column supported by the engine (A1:XFD1048576)
+constexpr uint32_t kMaxRows = 1048576;
+constexpr uint32_t kMaxColumns = 16384;
+
+// Zero-based integer coordinates of a single cell
+struct CellAddress {
+    uint32_t row = 0;
+    uint32_t column = 0;
+
+    bool operator==(const CellAddress& other) const { return row == other.row && column == other.column; }
+    bool operator!=(const CellAddress& other) const { return !(*this == other); }
+};
+
+// Inclusive rectangle of cells, e.g. A1:C10
+struct CellRange {
+    CellAddress first;
+    CellAddress last;
+
+    uint32_t rowCount() const { return last.row - first.row + 1; }
+    uint32_t columnCount() const { return last.column - first.column + 1; }
+    uint64_t cellCount() const { return static_cast<uint64_t>(rowCount()) * columnCount(); }
+
+    bool contains(const CellAddress& cell) const {
+        return cell.row >= first.row && cell.row <= last.row &&
+               cell.column >= first.column && cell.column <= last.column;
+    }
+
+    bool intersects(const CellRange& other) const {
+        return first.row <= other.last.row && other.first.row <= last.row &&
+               first.column <= other.last.column && other.first.column <= last.column;
+    }
+};
+
+// Converts a zero-based column index to letters (0 -> "A", 27 -> "AB")
+inline std::string columnToLetters(uint32_t column) {
+    std::string letters;
+    ++column;
+    while (column > 0) {
+        --column;
+        letters.insert(letters.begin(), static_cast<char>('A' + column % 26));
+        column /= 26;
+    }
+    return letters;
+}
+
+// Parses a reference such as "B12" or "$B$12" into zero-based coordinates
+inline CellAddress parseCellAddress(const std::string& reference) {
+    size_t pos = 0;
+    uint32_t column = 0;
+    uint64_t row = 0;
+
+    if (pos < reference.size() && reference[pos] == '$') ++pos;
+    size_t letterStart = pos;
+    while (pos < reference.size() && std::isalpha(static_cast<unsigned char>(reference[pos]))) {
+        column = column * 26 + static_cast<uint32_t>(std::toupper(static_cast<unsigned char>(reference[pos])) - 'A' + 1);
+        if (column > kMaxColumns) {
+            throw std::invalid_argument("Column out of range: " + reference);
+        }
+        ++pos;
+    }
+    if (pos == letterStart) {
+        throw std::invalid_argument("Invalid cell reference: " + reference);
+    }
+
+    if (pos < reference.size() && reference[pos] == '$') ++pos;
+    size_t digitStart = pos;
+    while (pos < reference.size() && std::isdigit(static_cast<unsigned char>(reference[pos]))) {
+        row = row * 10 + static_cast<uint64_t>(reference[pos] - '0');
+        if (row > kMaxRows) {
+            throw std::invalid_argument("Row out of range: " + reference);
+        }
+        ++pos;
+    }
+    if (pos == digitStart || pos != reference.size() || row == 0) {
+        throw std::invalid_argument("Invalid cell reference: " + reference);
+    }
+
+    return CellAddress{static_cast<uint32_t>(row - 1), column - 1};
+}
+
+// Formats zero-based coordinates as a reference such as "B12"
+inline std::string formatCellAddress(const CellAddress& cell) {
+    return columnToLetters(cell.column) + std::to_string(cell.row + 1);
+}
+
+// Parses "A1:C10", "A1" (single cell), "A:C" (whole columns) or "1:5" (whole rows)
+inline CellRange parseCellRange(const std::string& range) {
+    size_t colonPos = range.find(':');
+    if (colonPos == std::string::npos) {
+        CellAddress cell = parseCellAddress(range);
+        return CellRange{cell, cell};
+    }
+
+    std::string startPart = range.substr(0, colonPos);
+    std::string endPart = range.substr(colonPos + 1);
+    auto isAllAlpha = [](const std::string& s) {
+        return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '$'; });
+    };
+    auto isAllDigit = [](const std::string& s) {
+        return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) || c == '$'; });
+    };
+
+    CellRange result;
+    if (isAllAlpha(startPart) && isAllAlpha(endPart)) {
+        result.first = CellAddress{0, parseCellAddress(startPart + "1").column};
+        result.last = CellAddress{kMaxRows - 1, parseCellAddress(endPart + "1").column};
+    } else if (isAllDigit(startPart) && isAllDigit(endPart)) {
+        result.first = CellAddress{parseCellAddress("A" + startPart).row, 0};
+        result.last = CellAddress{parseCellAddress("A" + endPart).row, kMaxColumns - 1};
+    } else {
+        result.first = parseCellAddress(startPart);
+        result.last = parseCellAddress(endPart);
+    }
+
+    // Normalize so first is the top-left corner
+    if (result.first.row > result.last.row) std::swap(result.first.row, result.last.row);
+    if (result.first.column > result.last.column) std::swap(result.first.column, result.last.column);
+    return result;
+}
+
+// Formats a rectangle as "A1:C10", or "A1" for a single cell
+inline std::string formatCellRange(const CellRange& range) {
+    if (range.first == range.last) {
+        return formatCellAddress(range.first);
+    }
+    return formatCellAddress(range.first) + ":" + formatCellAddress(range.last);
+}
+
+#endif // CELL_ADDRESS_H
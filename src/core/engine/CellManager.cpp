@@ -1,14 +1,17 @@
 #include "CellManager.h"
+#include "CellAddress.h"
+#include "ChangeFeed.h"
 #include <stdexcept>
 #include <algorithm>
 #include <cctype>
 #include <sstream>
 #include <mutex>
+#include <shared_mutex>
 
 // Constructor implementation
-CellManager::CellManager() {
+CellManager::CellManager() : changeFeed(nullptr) {
     // Initialize the cells unordered_map and cellMutex
-    // (No explicit initialization needed for std::unordered_map and std::mutex)
+    // (No explicit initialization needed for std::unordered_map and std::shared_mutex)
 }
 
 void CellManager::setCellValue(const std::string& cellReference, const std::string& value) {
@@ -17,16 +20,22 @@ void CellManager::setCellValue(const std::string& cellReference, const std::stri
         throw std::runtime_error("Invalid cell reference: " + cellReference);
     }
 
-    // Acquire lock on cellMutex
-    std::lock_guard<std::mutex> lock(cellMutex);
+    CellAddress address = parseCellAddress(cellReference);
+
+    // Acquire exclusive lock on cellMutex
+    std::unique_lock<std::shared_mutex> lock(cellMutex);
 
     // Create a new Cell object if it doesn't exist
-    auto& cell = cells[cellReference];
+    auto& cell = cells[cellKey(address)];
 
     // Set the value of the Cell object
     cell.setValue(value);
 
-    // Lock is automatically released when lock_guard goes out of scope
+    if (changeFeed) {
+        changeFeed->recordChange(address, value);
+    }
+
+    // Exclusive lock is released when unique_lock goes out of scope
 }
 
 std::string CellManager::getCellValue(const std::string& cellReference) {
@@ -35,11 +44,13 @@ std::string CellManager::getCellValue(const std::string& cellReference) {
         throw std::runtime_error("Invalid cell reference: " + cellReference);
     }
 
-    // Acquire lock on cellMutex
-    std::lock_guard<std::mutex> lock(cellMutex);
+    uint64_t key = cellKey(parseCellAddress(cellReference));
+
+    // Acquire shared lock on cellMutex so readers run in parallel
+    std::shared_lock<std::shared_mutex> lock(cellMutex);
 
     // Retrieve the Cell object from the cells map
-    auto it = cells.find(cellReference);
+    auto it = cells.find(key);
     if (it == cells.end()) {
         return ""; // Return empty string for non-existent cells
     }
@@ -47,12 +58,148 @@ std::string CellManager::getCellValue(const std::string& cellReference) {
     // Get the value from the Cell object
     std::string value = it->second.getValue();
 
-    // Lock is automatically released when lock_guard goes out of scope
+    // Shared lock is released when shared_lock goes out of scope
 
     // Return the cell value
     return value;
 }
 
+void CellManager::setCellBlock(const CellRange& range, const std::vector<std::string>& values) {
+    if (values.size() != range.cellCount()) {
+        throw std::invalid_argument("Value count does not match range size");
+    }
+    if (!isWithinSheet(range.last)) {
+        throw std::runtime_error("Invalid cell range: " + formatCellRange(range));
+    }
+
+    // Acquire exclusive lock on cellMutex once for the whole block
+    std::unique_lock<std::shared_mutex> lock(cellMutex);
+
+    const uint32_t cols = range.columnCount();
+    for (uint32_t row = 0; row < range.rowCount(); ++row) {
+        for (uint32_t col = 0; col < cols; ++col) {
+            const std::string& value = values[static_cast<size_t>(row) * cols + col];
+            CellAddress address{range.first.row + row, range.first.column + col};
+
+            // Blank values remove the cell so cleared ranges do not keep empty entries
+            if (value.empty()) {
+                cells.erase(cellKey(address));
+            } else {
+                cells[cellKey(address)].setValue(value);
+            }
+            if (changeFeed) {
+                changeFeed->recordChange(address, value);
+            }
+        }
+    }
+}
+
+void CellManager::clear() {
+    std::unique_lock<std::shared_mutex> lock(cellMutex);
+
+    if (changeFeed) {
+        for (const auto& entry : cells) {
+            changeFeed->recordChange(
+                CellAddress{static_cast<uint32_t>(entry.first >> 32), static_cast<uint32_t>(entry.first)}, std::string());
+        }
+    }
+    cells.clear();
+}
+
+void CellManager::readBlock(const CellRange& range, std::vector<std::string_view>& out) const {
+    const uint32_t cols = range.columnCount();
+    out.assign(range.cellCount(), std::string_view());
+
+    std::shared_lock<std::shared_mutex> lock(cellMutex);
+
+    if (cells.size() < range.cellCount()) {
+        // Sparse sheet or huge range: scan the populated cells instead of probing every address
+        for (const auto& entry : cells) {
+            CellAddress address{static_cast<uint32_t>(entry.first >> 32), static_cast<uint32_t>(entry.first)};
+            if (range.contains(address)) {
+                out[static_cast<size_t>(address.row - range.first.row) * cols + (address.column - range.first.column)] =
+                    entry.second.getValue();
+            }
+        }
+        return;
+    }
+
+    for (uint32_t row = 0; row < range.rowCount(); ++row) {
+        for (uint32_t col = 0; col < cols; ++col) {
+            auto it = cells.find(cellKey(CellAddress{range.first.row + row, range.first.column + col}));
+            if (it != cells.end()) {
+                out[static_cast<size_t>(row) * cols + col] = it->second.getValue();
+            }
+        }
+    }
+}
+
+void CellManager::pinBlock(const CellRange& range, std::vector<std::shared_ptr<const std::string>>& out) const {
+    const uint32_t cols = range.columnCount();
+    out.assign(range.cellCount(), nullptr);
+
+    std::shared_lock<std::shared_mutex> lock(cellMutex);
+
+    if (cells.size() < range.cellCount()) {
+        for (const auto& entry : cells) {
+            CellAddress address{static_cast<uint32_t>(entry.first >> 32), static_cast<uint32_t>(entry.first)};
+            if (range.contains(address)) {
+                out[static_cast<size_t>(address.row - range.first.row) * cols + (address.column - range.first.column)] =
+                    entry.second.getSharedValue();
+            }
+        }
+        return;
+    }
+
+    for (uint32_t row = 0; row < range.rowCount(); ++row) {
+        for (uint32_t col = 0; col < cols; ++col) {
+            auto it = cells.find(cellKey(CellAddress{range.first.row + row, range.first.column + col}));
+            if (it != cells.end()) {
+                out[static_cast<size_t>(row) * cols + col] = it->second.getSharedValue();
+            }
+        }
+    }
+}
+
+std::vector<std::string> CellManager::getAllCellReferences() const {
+    std::shared_lock<std::shared_mutex> lock(cellMutex);
+
+    std::vector<std::string> references;
+    references.reserve(cells.size());
+    for (const auto& entry : cells) {
+        references.push_back(formatCellAddress(
+            CellAddress{static_cast<uint32_t>(entry.first >> 32), static_cast<uint32_t>(entry.first)}));
+    }
+    return references;
+}
+
+size_t CellManager::getMemoryUsage() const {
+    std::shared_lock<std::shared_mutex> lock(cellMutex);
+
+    // Buckets and hash nodes (key, cell, next pointer, cached hash) plus the shared value:
+    // control block, string header and text
+    constexpr size_t kNodeOverhead = sizeof(uint64_t) + sizeof(Cell) + 2 * sizeof(void*);
+    constexpr size_t kValueOverhead = 2 * sizeof(long) + sizeof(std::string);
+    size_t bytes = cells.bucket_count() * sizeof(void*) + cells.size() * kNodeOverhead;
+    for (const auto& entry : cells) {
+        bytes += kValueOverhead + entry.second.getValue().size();
+    }
+    return bytes;
+}
+
+uint64_t CellManager::cellKey(const CellAddress& cell) {
+    return (static_cast<uint64_t>(cell.row) << 32) | cell.column;
+}
+
+bool CellManager::isWithinSheet(const CellAddress& cell) {
+    return cell.row < kMaxRows && cell.column < kMaxColumns;
+}
+
+void CellManager::setChangeFeed(ChangeFeed* feed) {
+    std::unique_lock<std::shared_mutex> lock(cellMutex);
+    changeFeed = feed;
+}
+
 bool CellManager::validateCellReference(const std::string& cellReference) {
     // Check if the cell reference is empty
     if (cellReference.empty()) {
@@ -72,30 +219,23 @@ bool CellManager::validateCellReference(const std::string& cellReference) {
     // Read row number
     ss >> rowNumber;
 
-    // Validate the column letters (A-ZZ)
-    if (columnLetters.empty() || columnLetters.length() > 2) {
+    // At most three letters (A-XFD) and a positive row
+    if (columnLetters.empty() || columnLetters.length() > 3 || rowNumber < 1 || !ss.eof()) {
         return false;
     }
 
+    uint32_t column = 0;
     for (char c : columnLetters) {
-        if (c < 'A' || c > 'Z') {
-            return false;
-        }
-    }
-
-    // Validate the row number (1-1048576)
-    if (rowNumber < 1 || rowNumber > 1048576) {
-        return false;
+        column = column * 26 + static_cast<uint32_t>(c - 'A' + 1);
     }
 
-    // Return true if both column and row are valid
-    return true;
+    // Validate against the same bounds as block writes
+    return isWithinSheet(CellAddress{static_cast<uint32_t>(rowNumber - 1), column - 1});
 }
 
 // Human tasks:
 // TODO: Implement proper error handling for invalid cell references
 // TODO: Add support for different data types (numbers, dates, etc.)
-// TODO: Implement cell value change notification mechanism
 // TODO: Implement caching mechanism for frequently accessed cell values
 // TODO: Add support for retrieving formatted cell values
 // TODO: Optimize the validation algorithm for better performance
@@ -0,0 +1,82 @@
+#ifndef CELL_MANAGER_H
+#define CELL_MANAGER_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <shared_mutex>
+
+struct CellAddress;
+struct CellRange;
+class ChangeFeed;
+
+// Holds the raw contents of a single cell. The text is immutable and shared, so a write
+// replaces it instead of changing it and readers that pinned the old text keep it alive.
+class Cell {
+public:
+    void setValue(const std::string& newValue) { value = std::make_shared<const std::string>(newValue); }
+    const std::string& getValue() const { return value ? *value : emptyValue(); }
+    const std::shared_ptr<const std::string>& getSharedValue() const { return value; }
+
+private:
+    std::shared_ptr<const std::string> value;
+
+    static const std::string& emptyValue() {
+        static const std::string empty;
+        return empty;
+    }
+};
+
+// Owns the cells of a worksheet and guards them with a reader/writer lock,
+// so concurrent readers do not serialize behind each other
+class CellManager {
+public:
+    // Constructor
+    CellManager();
+
+    // Sets the value of a single cell
+    void setCellValue(const std::string& cellReference, const std::string& value);
+
+    // Writes a row-major block of values under one exclusive lock; empty values clear cells
+    void setCellBlock(const CellRange& range, const std::vector<std::string>& values);
+
+    // Removes every cell
+    void clear();
+
+    // Retrieves the value of a cell, or an empty string if it is not set
+    std::string getCellValue(const std::string& cellReference);
+
+    // Fills out with row-major views of every cell in range under one shared lock; blank cells
+    // are empty views. Views stay valid only until the next write, so callers must keep
+    // writers out while they use them.
+    void readBlock(const CellRange& range, std::vector<std::string_view>& out) const;
+
+    // Fills out with the row-major shared text of every cell in range under one shared lock;
+    // blank cells are null. The pinned text outlives later writes, so no lock need be held.
+    void pinBlock(const CellRange& range, std::vector<std::shared_ptr<const std::string>>& out) const;
+
+    // Retrieves the references of all populated cells
+    std::vector<std::string> getAllCellReferences() const;
+
+    // Returns an estimate of the bytes held by the cell store
+    size_t getMemoryUsage() const;
+
+    // Sets the feed that records every value write, including recalculation results
+    void setChangeFeed(ChangeFeed* feed);
+
+private:
+    // Keyed by packed (row, column) so block reads never format or hash reference strings
+    std::unordered_map<uint64_t, Cell> cells;
+    mutable std::shared_mutex cellMutex;
+    ChangeFeed* changeFeed;
+
+    bool validateCellReference(const std::string& cellReference);
+    // Sheet bounds shared by single-cell and block writes: rows 1-1048576, columns A-XFD
+    static bool isWithinSheet(const CellAddress& cell);
+    static uint64_t cellKey(const CellAddress& cell);
+};
+
+#endif // CELL_MANAGER_H
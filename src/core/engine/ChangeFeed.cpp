@@ -0,0 +1,154 @@
+#include "ChangeFeed.h"
+#include <stdexcept>
+#include <algorithm>
+#include <exception>
+
+ChangeFeed::ChangeFeed() : nextSubscriptionId(1) {}
+
+size_t ChangeFeed::subscribe(const CellRange& range, ChangeHandler handler) {
+    if (!handler) {
+        throw std::invalid_argument("Change subscription requires a handler");
+    }
+
+    std::lock_guard<std::mutex> lock(subscriptionMutex);
+    size_t subscriptionId = nextSubscriptionId++;
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->handler = std::move(handler);
+    subscriptions[subscriptionId] = Subscription{range, std::move(subscriber)};
+    subscriptionIndex.insert(range, subscriptionId);
+    return subscriptionId;
+}
+
+void ChangeFeed::updateSubscription(size_t subscriptionId, const CellRange& range) {
+    std::lock_guard<std::mutex> lock(subscriptionMutex);
+    auto it = subscriptions.find(subscriptionId);
+    if (it == subscriptions.end()) {
+        throw std::invalid_argument("Unknown change subscription");
+    }
+    if (it->second.range.first == range.first && it->second.range.last == range.last) {
+        return;
+    }
+
+    subscriptionIndex.removeIntersecting(it->second.range,
+                                         [subscriptionId](const CellRange&, size_t id) { return id == subscriptionId; });
+    it->second.range = range;
+    subscriptionIndex.insert(range, subscriptionId);
+}
+
+void ChangeFeed::unsubscribe(size_t subscriptionId) {
+    std::unique_lock<std::mutex> lock(subscriptionMutex);
+    auto it = subscriptions.find(subscriptionId);
+    if (it == subscriptions.end()) {
+        return;
+    }
+    std::shared_ptr<Subscriber> subscriber = std::move(it->second.subscriber);
+    subscriptionIndex.removeIntersecting(it->second.range,
+                                         [subscriptionId](const CellRange&, size_t id) { return id == subscriptionId; });
+    subscriptions.erase(it);
+    subscriber->removed = true;
+
+    // A publish that already picked this subscriber may still be calling it
+    const std::thread::id self = std::this_thread::get_id();
+    handlersIdle.wait(lock, [&subscriber, self]() {
+        return std::all_of(subscriber->callers.begin(), subscriber->callers.end(),
+                           [self](std::thread::id caller) { return caller == self; });
+    });
+}
+
+void ChangeFeed::recordChange(const CellAddress& cell, const std::string& value) {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    auto inserted = pendingIndex.emplace(cellKey(cell), pendingChanges.size());
+    if (inserted.second) {
+        pendingChanges.push_back(CellChange{cell, value});
+    } else {
+        pendingChanges[inserted.first->second].value = value;
+    }
+}
+
+// Route each coalesced change to the subscriptions containing it, then deliver
+void ChangeFeed::publish() {
+    std::vector<CellChange> changes;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        changes.swap(pendingChanges);
+        pendingIndex.clear();
+    }
+    if (changes.empty()) {
+        return;
+    }
+
+    std::vector<std::pair<std::shared_ptr<Subscriber>, std::vector<CellChange>>> batches;
+    {
+        std::lock_guard<std::mutex> lock(subscriptionMutex);
+        if (subscriptions.empty()) {
+            return;
+        }
+
+        std::unordered_map<size_t, size_t> batchForSubscription;
+        for (const auto& change : changes) {
+            subscriptionIndex.forEachContaining(change.cell, [&](const CellRange&, size_t subscriptionId) {
+                auto inserted = batchForSubscription.emplace(subscriptionId, batches.size());
+                if (inserted.second) {
+                    batches.emplace_back(subscriptions[subscriptionId].subscriber, std::vector<CellChange>());
+                }
+                batches[inserted.first->second].second.push_back(change);
+            });
+        }
+    }
+
+    // Handlers may subscribe or unsubscribe, so no lock is held while they run. A throwing
+    // handler does not stop delivery to the others; the first error is rethrown afterwards.
+    std::exception_ptr firstError;
+    for (const auto& batch : batches) {
+        try {
+            deliver(*batch.first, batch.second);
+        } catch (...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+void ChangeFeed::deliver(Subscriber& subscriber, const std::vector<CellChange>& changes) {
+    {
+        std::lock_guard<std::mutex> lock(subscriptionMutex);
+        if (subscriber.removed) {
+            return;
+        }
+        subscriber.callers.push_back(std::this_thread::get_id());
+    }
+
+    std::exception_ptr error;
+    try {
+        subscriber.handler(changes);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(subscriptionMutex);
+        subscriber.callers.erase(std::find(subscriber.callers.begin(), subscriber.callers.end(), std::this_thread::get_id()));
+    }
+    handlersIdle.notify_all();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+size_t ChangeFeed::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    return pendingChanges.size();
+}
+
+size_t ChangeFeed::getSubscriptionCount() const {
+    std::lock_guard<std::mutex> lock(subscriptionMutex);
+    return subscriptions.size();
+}
+
+uint64_t ChangeFeed::cellKey(const CellAddress& cell) {
+    return (static_cast<uint64_t>(cell.row) << 32) | cell.column;
+}
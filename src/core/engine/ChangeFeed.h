@@ -0,0 +1,87 @@
+#ifndef CHANGE_FEED_H
+#define CHANGE_FEED_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+#include "CellAddress.h"
+#include "RectangleIndex.h"
+
+// A changed cell and its value after the commit
+struct CellChange {
+    CellAddress cell;
+    std::string value;
+};
+
+// Delivers cell changes to range subscribers (viewports, charts, sparklines, pivots,
+// conditional formats). Changes recorded during a write batch are coalesced per cell, then
+// routed through a spatial index of subscription ranges so each subscriber receives a
+// single batch holding only the changed cells inside its range.
+class ChangeFeed {
+public:
+    using ChangeHandler = std::function<void(const std::vector<CellChange>& changes)>;
+
+    ChangeFeed();
+
+    // Registers a handler for changes inside range; returns an ID for later updates
+    size_t subscribe(const CellRange& range, ChangeHandler handler);
+
+    // Moves an existing subscription to a new range, e.g. when a viewport scrolls
+    void updateSubscription(size_t subscriptionId, const CellRange& range);
+
+    // Removes a subscription by the ID returned from subscribe. Waits for calls of its handler
+    // running on other threads to return, so the handler's captures may be destroyed
+    // afterwards; a handler may unsubscribe itself.
+    void unsubscribe(size_t subscriptionId);
+
+    // Records a changed cell; repeated changes to the same cell keep only the latest value
+    void recordChange(const CellAddress& cell, const std::string& value);
+
+    // Delivers the recorded changes, one batch per affected subscriber, and resets the feed.
+    // Handlers run on the calling thread with no feed locks held. Every handler runs even if
+    // an earlier one throws; the first exception is rethrown once all have been called.
+    void publish();
+
+    // Returns the number of changes waiting to be published
+    size_t getPendingCount() const;
+
+    // Returns the number of active subscriptions
+    size_t getSubscriptionCount() const;
+
+private:
+    // A subscriber's handler and the threads currently inside it
+    struct Subscriber {
+        ChangeHandler handler;
+        bool removed = false;
+        std::vector<std::thread::id> callers;
+    };
+
+    struct Subscription {
+        CellRange range;
+        std::shared_ptr<Subscriber> subscriber;
+    };
+
+    // Pending changes in first-change order, with their positions keyed by cell
+    std::vector<CellChange> pendingChanges;
+    std::unordered_map<uint64_t, size_t> pendingIndex;
+    mutable std::mutex pendingMutex;
+
+    std::unordered_map<size_t, Subscription> subscriptions;
+    RectangleIndex<size_t> subscriptionIndex;
+    size_t nextSubscriptionId;
+    mutable std::mutex subscriptionMutex;
+    std::condition_variable handlersIdle;
+
+    // Calls one subscriber unless it was removed meanwhile, tracking the call for unsubscribe
+    void deliver(Subscriber& subscriber, const std::vector<CellChange>& changes);
+
+    static uint64_t cellKey(const CellAddress& cell);
+};
+
+#endif // CHANGE_FEED_H
@@ -1,20 +1,206 @@
 #include "DataValidation.h"
+#include "FormulaParser.h"
 #include <stdexcept>
-#include <regex>
 #include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <exception>
+#include <thread>
 #include <mutex>
 
+namespace {
+
+// validateRange gives each worker at least this many cells; smaller inputs run inline
+constexpr size_t kMinCellsPerThread = 16384;
+
+// Parses the whole string as a finite number without allocating
+bool parseNumber(const std::string& text, double& value) {
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    if (begin != end && *begin == '+') {
+        ++begin;
+    }
+    auto parsed = std::from_chars(begin, end, value);
+    return begin != end && parsed.ec == std::errc() && parsed.ptr == end && std::isfinite(value);
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+// Spreadsheet date serials count days from 1899-12-30
+constexpr int64_t kSerialEpochOffset = 25569;
+
+} // namespace
+
+// Compile a rule into its ready-to-run form
+std::shared_ptr<const CompiledValidator> CompiledValidator::compile(const ValidationRule& rule, const FormulaParser* formulaParser) {
+    auto validator = std::make_shared<CompiledValidator>();
+    validator->type = rule.getType();
+    const auto& params = rule.parameters;
+
+    switch (rule.getType()) {
+        case ValidationRule::Type::NUMBER:
+        case ValidationRule::Type::DATE: {
+            bool isDate = rule.getType() == ValidationRule::Type::DATE;
+            auto parseBound = [isDate](const std::string& text, double& bound) {
+                return isDate ? parseDateSerial(text, bound) : parseNumber(text, bound);
+            };
+            if (params.size() > 0 && !params[0].empty()) {
+                if (!parseBound(params[0], validator->minimum)) {
+                    throw std::invalid_argument("Invalid minimum for validation rule: " + params[0]);
+                }
+                validator->hasMinimum = true;
+            }
+            if (params.size() > 1 && !params[1].empty()) {
+                if (!parseBound(params[1], validator->maximum)) {
+                    throw std::invalid_argument("Invalid maximum for validation rule: " + params[1]);
+                }
+                validator->hasMaximum = true;
+            }
+            break;
+        }
+        case ValidationRule::Type::LIST:
+            validator->allowedValues.insert(params.begin(), params.end());
+            break;
+        case ValidationRule::Type::CUSTOM:
+            if (params.empty() || params[0].empty()) {
+                throw std::invalid_argument("Custom validation rule requires a formula");
+            }
+            if (!formulaParser) {
+                throw std::invalid_argument("No formula parser set for custom validation");
+            }
+            try {
+                validator->formula = std::make_shared<const CompiledFormula>(
+                    formulaParser->compile(params[0][0] == '=' ? params[0].substr(1) : params[0]));
+            } catch (const std::runtime_error& e) {
+                throw std::invalid_argument("Invalid custom validation formula: " + std::string(e.what()));
+            }
+            {
+                // The formula sees only the value being validated, not the sheet, so it may name
+                // one cell, which stands for that value; a second cell would silently alias it
+                std::unordered_set<std::string> cells;
+                for (const auto& reference : validator->formula->references()) {
+                    try {
+                        cells.insert(formatCellAddress(parseCellAddress(reference)));
+                    } catch (const std::exception&) {
+                        cells.insert(reference);
+                    }
+                }
+                if (cells.size() > 1) {
+                    throw std::invalid_argument("Custom validation formula may reference only the validated cell: " + params[0]);
+                }
+            }
+            break;
+        case ValidationRule::Type::TEXT:
+            break;
+    }
+
+    return validator;
+}
+
+// Check a value against the compiled rule
+bool CompiledValidator::accepts(const std::string& data) const {
+    switch (type) {
+        case ValidationRule::Type::NUMBER: {
+            double value;
+            return parseNumber(data, value) && inBounds(value);
+        }
+        case ValidationRule::Type::DATE: {
+            double serial;
+            return parseDateSerial(data, serial) && inBounds(serial);
+        }
+        case ValidationRule::Type::LIST:
+            return allowedValues.count(data) > 0;
+        case ValidationRule::Type::CUSTOM: {
+            // The formula's single reference resolves to the value being validated; a value the
+            // formula cannot evaluate (e.g. text where it expects a number) fails the rule
+            try {
+                double result = formula->evaluate([&data](const std::string&) { return data; });
+                return result != 0.0;
+            } catch (const std::exception&) {
+                return false;
+            }
+        }
+        case ValidationRule::Type::TEXT:
+            return true; // All text is valid
+    }
+    throw std::runtime_error("Unknown validation rule type");
+}
+
+// Parse YYYY-MM-DD or a numeric serial into a date serial
+bool CompiledValidator::parseDateSerial(const std::string& text, double& serial) {
+    if (text.size() == 10 && text[4] == '-' && text[7] == '-') {
+        int year = 0;
+        unsigned month = 0;
+        unsigned day = 0;
+        const char* s = text.data();
+        if (std::from_chars(s, s + 4, year).ptr != s + 4 ||
+            std::from_chars(s + 5, s + 7, month).ptr != s + 7 ||
+            std::from_chars(s + 8, s + 10, day).ptr != s + 10 ||
+            month < 1 || month > 12 || day < 1 || day > 31) {
+            return false;
+        }
+        // Reject dates such as 2023-02-30 by round-tripping through the day count
+        int64_t days = daysFromCivil(year, month, day);
+        unsigned nextMonth = month == 12 ? 1 : month + 1;
+        int nextYear = month == 12 ? year + 1 : year;
+        if (days >= daysFromCivil(nextYear, nextMonth, 1)) {
+            return false;
+        }
+        serial = static_cast<double>(days + kSerialEpochOffset);
+        return true;
+    }
+    return parseNumber(text, serial);
+}
+
+bool CompiledValidator::inBounds(double value) const {
+    return (!hasMinimum || value >= minimum) && (!hasMaximum || value <= maximum);
+}
+
 // Constructor
-DataValidation::DataValidation() {
-    // Initialize the validationRules map
-    // (Empty initialization as rules will be added later)
+DataValidation::DataValidation() : nextSequence(0), formulaParser(nullptr) {
+    // Rules and their spatial index start empty
+}
+
+// Set the parser used to evaluate CUSTOM formula rules
+void DataValidation::setFormulaParser(FormulaParser* parser) {
+    std::lock_guard<std::mutex> lock(validationMutex);
+    formulaParser = parser;
 }
 
 // Set a validation rule for a specific cell or range of cells
 void DataValidation::setValidationRule(const std::string& cellRange, const ValidationRule& rule) {
+    // Parse and compile before locking so an invalid rule leaves the rules untouched
+    CellRange range = parseCellRange(cellRange);
+    FormulaParser* parser = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(validationMutex);
+        parser = formulaParser;
+    }
+    std::shared_ptr<const CompiledValidator> validator = CompiledValidator::compile(rule, parser);
+
     std::lock_guard<std::mutex> lock(validationMutex);
-    // Add or update the validation rule for the specified cell range
-    validationRules[cellRange] = rule;
+
+    auto it = validationRules.find(cellRange);
+    if (it != validationRules.end()) {
+        // Replace an existing rule for the same range key
+        const StoredRule* existing = &it->second;
+        ruleIndex.removeIntersecting(existing->range,
+                                     [existing](const CellRange&, const StoredRule* stored) { return stored == existing; });
+        it->second = StoredRule{range, rule, validator, nextSequence++};
+    } else {
+        it = validationRules.emplace(cellRange, StoredRule{range, rule, validator, nextSequence++}).first;
+    }
+
+    // unordered_map nodes are stable, so the index can point at the stored rule directly
+    ruleIndex.insert(range, &it->second);
 }
 
 // Remove a validation rule for a specific cell or range of cells
@@ -23,67 +209,167 @@ bool DataValidation::removeValidationRule(const std::string& cellRange) {
     // Remove the validation rule for the specified cell range if it exists
     auto it = validationRules.find(cellRange);
     if (it != validationRules.end()) {
+        const StoredRule* existing = &it->second;
+        ruleIndex.removeIntersecting(existing->range,
+                                     [existing](const CellRange&, const StoredRule* stored) { return stored == existing; });
         validationRules.erase(it);
         return true;
     }
     return false;
 }
 
-// Validate data against the set rules for a specific cell
-bool DataValidation::validateData(const std::string& cellReference, const std::string& data) {
+// Validate data against the rule that applies to a specific cell
+bool DataValidation::validateData(const std::string& cellReference, const std::string& data) const {
+    CellAddress cell = parseCellAddress(cellReference);
+
     std::lock_guard<std::mutex> lock(validationMutex);
-    
-    // Find the matching validation rule for the cell
-    ValidationRule* rule = findMatchingRule(cellReference);
-    
-    // If a rule is found, validate the data against the rule
-    if (rule) {
-        // Implement the validation logic based on the rule type
-        // This is a simplified example and should be expanded based on actual rule types
-        switch (rule->getType()) {
-            case ValidationRule::Type::NUMBER:
-                return std::regex_match(data, std::regex("^-?[0-9]*\\.?[0-9]+$"));
-            case ValidationRule::Type::TEXT:
-                return true; // All text is valid
-            case ValidationRule::Type::DATE:
-                // Implement date validation logic
-                return false; // Placeholder
-            case ValidationRule::Type::LIST:
-                // Implement list validation logic
-                return false; // Placeholder
-            default:
-                throw std::runtime_error("Unknown validation rule type");
-        }
+
+    // Find the matching validation rule for the cell and run its compiled check
+    const StoredRule* stored = findMatchingRule(cell);
+    if (stored) {
+        return stored->validator->accepts(data);
     }
-    
+
     // If no rule is found, the data is considered valid
     return true;
 }
 
-// Find the validation rule that applies to a specific cell
-ValidationRule* DataValidation::findMatchingRule(const std::string& cellReference) {
-    // Iterate through the validationRules map
-    auto it = std::find_if(validationRules.begin(), validationRules.end(),
-        [&cellReference](const auto& pair) {
-            // Check if the cell reference falls within the rule's range
-            // This is a simplified check and should be improved for actual cell ranges
-            return pair.first == cellReference;
+// Validate a block of values in parallel, returning a failure bitmap
+std::vector<uint64_t> DataValidation::validateRange(const std::string& cellRange, const std::vector<std::string>& values) const {
+    CellRange range = parseCellRange(cellRange);
+    if (values.size() != range.cellCount()) {
+        throw std::invalid_argument("Value count does not match range size");
+    }
+
+    // Snapshot the rules touching the block, best first, so the checks can run unlocked
+    struct RangeRule {
+        CellRange range;
+        std::shared_ptr<const CompiledValidator> validator;
+        int priority;
+        uint64_t sequence;
+    };
+    std::vector<RangeRule> rules;
+    {
+        std::lock_guard<std::mutex> lock(validationMutex);
+        ruleIndex.forEachIntersecting(range, [&rules](const CellRange& rect, const StoredRule* stored) {
+            rules.push_back(RangeRule{rect, stored->validator, stored->rule.priority, stored->sequence});
         });
-    
-    // Return a pointer to the first matching rule found
-    if (it != validationRules.end()) {
-        return &(it->second);
     }
-    
-    // If no matching rule is found, return nullptr
-    return nullptr;
+    std::sort(rules.begin(), rules.end(), [](const RangeRule& a, const RangeRule& b) {
+        return a.priority != b.priority ? a.priority > b.priority : a.sequence > b.sequence;
+    });
+
+    std::vector<uint64_t> failures((values.size() + 63) / 64, 0);
+    if (rules.empty()) {
+        return failures;
+    }
+
+    // When the winning rule covers the whole block, every cell uses it without a lookup
+    const CompiledValidator* uniform = nullptr;
+    if (rules.front().range.contains(range.first) && rules.front().range.contains(range.last)) {
+        uniform = rules.front().validator.get();
+    }
+
+    const uint32_t cols = range.columnCount();
+    auto validateWords = [&](size_t firstWord, size_t lastWord) {
+        for (size_t word = firstWord; word < lastWord; ++word) {
+            uint64_t bits = 0;
+            size_t end = std::min(values.size(), (word + 1) * 64);
+            for (size_t i = word * 64; i < end; ++i) {
+                const CompiledValidator* validator = uniform;
+                if (!validator) {
+                    CellAddress cell{range.first.row + static_cast<uint32_t>(i / cols),
+                                     range.first.column + static_cast<uint32_t>(i % cols)};
+                    for (const auto& rule : rules) {
+                        if (rule.range.contains(cell)) {
+                            validator = rule.validator.get();
+                            break;
+                        }
+                    }
+                }
+                if (validator && !validator->accepts(values[i])) {
+                    bits |= uint64_t(1) << (i - word * 64);
+                }
+            }
+            failures[word] = bits;
+        }
+    };
+
+    // Small blocks such as a typical paste run inline; spawning threads would cost more
+    const size_t wordCount = failures.size();
+    if (values.size() < 2 * kMinCellsPerThread) {
+        validateWords(0, wordCount);
+        return failures;
+    }
+
+    // Each worker owns whole 64-bit words, so no synchronization is needed on the bitmap
+    const size_t minWordsPerThread = kMinCellsPerThread / 64;
+    size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                          wordCount / minWordsPerThread);
+    if (threadCount <= 1) {
+        validateWords(0, wordCount);
+        return failures;
+    }
+
+    // An exception must not escape a worker thread; the first one is rethrown here
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto runWords = [&](size_t firstWord, size_t lastWord) {
+        try {
+            validateWords(firstWord, lastWord);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t wordsPerThread = (wordCount + threadCount - 1) / threadCount;
+    for (size_t start = 0; start < wordCount; start += wordsPerThread) {
+        workers.emplace_back(runWords, start, std::min(wordCount, start + wordsPerThread));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return failures;
+}
+
+// Retrieve the rule that applies to a specific cell
+const ValidationRule* DataValidation::getValidationRule(const std::string& cellReference) const {
+    CellAddress cell = parseCellAddress(cellReference);
+
+    std::lock_guard<std::mutex> lock(validationMutex);
+    const StoredRule* stored = findMatchingRule(cell);
+    return stored ? &stored->rule : nullptr;
+}
+
+size_t DataValidation::getRuleCount() const {
+    std::lock_guard<std::mutex> lock(validationMutex);
+    return validationRules.size();
+}
+
+// Find the validation rule that applies to a specific cell
+const DataValidation::StoredRule* DataValidation::findMatchingRule(const CellAddress& cell) const {
+    const StoredRule* best = nullptr;
+
+    // Visit only the rules whose rectangles cover the cell and keep the winner
+    ruleIndex.forEachContaining(cell, [&best](const CellRange&, const StoredRule* stored) {
+        if (!best ||
+            stored->rule.priority > best->rule.priority ||
+            (stored->rule.priority == best->rule.priority && stored->sequence > best->sequence)) {
+            best = stored;
+        }
+    });
+
+    return best;
 }
 
 // Human tasks:
-// TODO: Implement support for overlapping cell ranges
-// TODO: Add validation for the cell range format
 // TODO: Implement cleanup of partially overlapping cell ranges
-// TODO: Implement more complex validation rules (e.g., custom formulas)
 // TODO: Add support for localized error messages
-// TODO: Optimize the search algorithm for large numbers of rules
-// TODO: Implement support for rule priorities in case of overlapping ranges
\ No newline at end of file
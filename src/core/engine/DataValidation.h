@@ -5,75 +5,123 @@
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include "CellAddress.h"
+#include "RectangleIndex.h"
+
+// Forward declarations
+class FormulaParser;
+class CompiledFormula;
 
 // Represents a data validation rule for Excel cells
 class ValidationRule {
 public:
-    enum class ValidationType {
-        // Add validation types here (e.g., NUMBER, TEXT, DATE, etc.)
+    enum class Type {
+        NUMBER,     // parameters: optional minimum, optional maximum
+        TEXT,
+        DATE,       // parameters: optional earliest, optional latest (YYYY-MM-DD or serial)
+        LIST,       // parameters: the allowed values
+        CUSTOM      // parameters[0]: formula; the value is valid when it evaluates non-zero. The
+                    // formula may reference one cell, which resolves to the validated value
     };
 
-    ValidationType type;
+    Type type = Type::TEXT;
     std::vector<std::string> parameters;
     std::string errorMessage;
 
-    // Checks if the given data is valid according to the rule
-    bool isValid(const std::string& data) const {
-        // Implement validation logic here
-        return true; // Placeholder
-    }
+    // Higher priority wins where rule ranges overlap; ties go to the most recently set rule
+    int priority = 0;
+
+    Type getType() const { return type; }
+};
+
+// A ValidationRule compiled once into a ready-to-run check: parsed numeric or date
+// bounds, a hashed membership set for lists, or a compiled custom formula.
+// Immutable after compilation and lock-free to run, so it can be shared across validation
+// threads.
+class CompiledValidator {
+public:
+    // Compiles a rule; throws std::invalid_argument for malformed parameters, or for a CUSTOM
+    // rule when formulaParser is null, cannot compile its formula, or the formula references
+    // more than one cell
+    static std::shared_ptr<const CompiledValidator> compile(const ValidationRule& rule, const FormulaParser* formulaParser);
+
+    // Checks a value
+    bool accepts(const std::string& data) const;
+
+    // Parses a date as YYYY-MM-DD or as a numeric serial; returns false if neither
+    static bool parseDateSerial(const std::string& text, double& serial);
+
+private:
+    ValidationRule::Type type = ValidationRule::Type::TEXT;
+    double minimum = 0.0;
+    double maximum = 0.0;
+    bool hasMinimum = false;
+    bool hasMaximum = false;
+    std::unordered_set<std::string> allowedValues;
+    std::shared_ptr<const CompiledFormula> formula;
+
+    bool inBounds(double value) const;
 };
 
-// Manages data validation rules and performs validation checks on cell data
+// Manages data validation rules and performs validation checks on cell data.
+// Rules are keyed by their range string and indexed spatially, so a rule set on
+// "A1:C100" applies to every cell inside it and lookups stay O(log n).
 class DataValidation {
 private:
-    std::unordered_map<std::string, ValidationRule> validationRules;
+    struct StoredRule {
+        CellRange range;
+        ValidationRule rule;
+        std::shared_ptr<const CompiledValidator> validator;
+        uint64_t sequence;
+    };
+
+    std::unordered_map<std::string, StoredRule> validationRules;
+    RectangleIndex<const StoredRule*> ruleIndex;
+    uint64_t nextSequence;
+    FormulaParser* formulaParser;
     mutable std::mutex validationMutex;
 
+    // Finds the highest-priority rule covering the cell. Caller must hold validationMutex.
+    const StoredRule* findMatchingRule(const CellAddress& cell) const;
+
 public:
     // Initializes the DataValidation object
-    DataValidation() = default;
+    DataValidation();
 
     // Sets a validation rule for a specific cell or range of cells
-    void setValidationRule(const std::string& cellRange, const ValidationRule& rule) {
-        std::lock_guard<std::mutex> lock(validationMutex);
-        validationRules[cellRange] = rule;
-    }
+    void setValidationRule(const std::string& cellRange, const ValidationRule& rule);
 
     // Removes a validation rule for a specific cell or range of cells
-    bool removeValidationRule(const std::string& cellRange) {
-        std::lock_guard<std::mutex> lock(validationMutex);
-        return validationRules.erase(cellRange) > 0;
-    }
-
-    // Validates data against the set rules for a specific cell
-    bool validateData(const std::string& cellReference, const std::string& data) const {
-        std::lock_guard<std::mutex> lock(validationMutex);
-        auto it = validationRules.find(cellReference);
-        if (it != validationRules.end()) {
-            return it->second.isValid(data);
-        }
-        return true; // No rule set, consider valid
-    }
-
-    // Retrieves the validation rule for a specific cell
-    const ValidationRule* getValidationRule(const std::string& cellReference) const {
-        std::lock_guard<std::mutex> lock(validationMutex);
-        auto it = validationRules.find(cellReference);
-        if (it != validationRules.end()) {
-            return &(it->second);
-        }
-        return nullptr;
-    }
+    bool removeValidationRule(const std::string& cellRange);
+
+    // Validates data against the rule that applies to a specific cell
+    bool validateData(const std::string& cellReference, const std::string& data) const;
+
+    // Validates a whole block of values (e.g. a pasted or imported column) in one pass.
+    // values are row-major for cellRange; returns a bitmap with bit i set when values[i] fails.
+    // Rules are resolved once under the lock and the checks run without it, in parallel for
+    // large blocks.
+    std::vector<uint64_t> validateRange(const std::string& cellRange, const std::vector<std::string>& values) const;
+
+    // Retrieves the rule that applies to a specific cell, or nullptr if none does
+    const ValidationRule* getValidationRule(const std::string& cellReference) const;
+
+    // Sets the parser that compiles CUSTOM formula rules; set it before adding such rules
+    void setFormulaParser(FormulaParser* parser);
+
+    // Returns the number of rules set
+    size_t getRuleCount() const;
 };
 
 // Human tasks:
 // - Add comprehensive documentation for each method, including usage examples and best practices
-// - Implement support for custom validation functions
 // - Add a method to bulk set validation rules for multiple cell ranges
 // - Implement a mechanism to export and import validation rules
 // - Consider adding support for conditional validation rules
 // - Implement a notification system for validation failures
 // - Add support for localization of error messages
 
-#endif // DATA_VALIDATION_H
\ No newline at end of file
+#endif // DATA_VALIDATION_H
@@ -0,0 +1,155 @@
+#include "FormatViewportCache.h"
+#include <algorithm>
+#include <stdexcept>
+
+FormatViewportCache::FormatViewportCache(FormattingEngine* engine) : FormatViewportCache(engine, nullptr) {}
+
+FormatViewportCache::FormatViewportCache(FormattingEngine* engine, ChangeFeed* feed)
+    : formattingEngine(engine), listenerId(0), changeFeed(feed), subscriptionId(0) {
+    if (!formattingEngine) {
+        throw std::invalid_argument("FormatViewportCache requires a FormattingEngine");
+    }
+    // Base format changes invalidate only the tiles they touch
+    listenerId = formattingEngine->addFormatChangeListener([this](const CellRange& range) { invalidate(range); });
+
+    // Value changes anywhere on the sheet invalidate the tiles of the changed cells
+    if (changeFeed) {
+        CellRange sheet{CellAddress{0, 0}, CellAddress{kMaxRows - 1, kMaxColumns - 1}};
+        try {
+            subscriptionId = changeFeed->subscribe(sheet, [this](const std::vector<CellChange>& changes) {
+                invalidateCells(changes);
+            });
+        } catch (...) {
+            formattingEngine->removeFormatChangeListener(listenerId);
+            throw;
+        }
+    }
+}
+
+FormatViewportCache::~FormatViewportCache() {
+    // Both removals wait for running notifications, so none can reach a destroyed cache
+    if (changeFeed) {
+        changeFeed->unsubscribe(subscriptionId);
+    }
+    formattingEngine->removeFormatChangeListener(listenerId);
+}
+
+void FormatViewportCache::setConditionalOverlay(ConditionalOverlay overlay) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    conditionalOverlay = std::move(overlay);
+    tiles.clear();
+}
+
+// Evict tiles outside the new window and resolve the newly exposed ones
+void FormatViewportCache::setViewport(const CellRange& viewport) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    const uint32_t firstTileRow = viewport.first.row / kTileRows;
+    const uint32_t lastTileRow = viewport.last.row / kTileRows;
+    const uint32_t firstTileColumn = viewport.first.column / kTileColumns;
+    const uint32_t lastTileColumn = viewport.last.column / kTileColumns;
+
+    for (auto it = tiles.begin(); it != tiles.end();) {
+        uint32_t tileRow = static_cast<uint32_t>(it->first >> 32);
+        uint32_t tileColumn = static_cast<uint32_t>(it->first);
+        if (tileRow < firstTileRow || tileRow > lastTileRow ||
+            tileColumn < firstTileColumn || tileColumn > lastTileColumn) {
+            it = tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (uint32_t tileRow = firstTileRow; tileRow <= lastTileRow; ++tileRow) {
+        for (uint32_t tileColumn = firstTileColumn; tileColumn <= lastTileColumn; ++tileColumn) {
+            ensureTile(tileRow, tileColumn);
+        }
+    }
+}
+
+// Array lookup into the cell's tile
+StyleId FormatViewportCache::getStyleId(const CellAddress& cell) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    Tile& tile = ensureTile(cell.row / kTileRows, cell.column / kTileColumns);
+    return tile.styles[(cell.row % kTileRows) * kTileColumns + cell.column % kTileColumns];
+}
+
+const CellFormat& FormatViewportCache::getFormat(const CellAddress& cell) {
+    return formattingEngine->getStyle(getStyleId(cell));
+}
+
+// Mark the tiles intersecting the range dirty; they are re-resolved on next access
+void FormatViewportCache::invalidate(const CellRange& range) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    const uint64_t touchedTiles =
+        static_cast<uint64_t>(range.last.row / kTileRows - range.first.row / kTileRows + 1) *
+        (range.last.column / kTileColumns - range.first.column / kTileColumns + 1);
+
+    if (touchedTiles > tiles.size()) {
+        // Large ranges (whole columns, sheets): scan the cached tiles instead
+        for (auto& entry : tiles) {
+            uint32_t tileRow = static_cast<uint32_t>(entry.first >> 32);
+            uint32_t tileColumn = static_cast<uint32_t>(entry.first);
+            if (tileRange(tileRow, tileColumn).intersects(range)) {
+                entry.second.dirty = true;
+            }
+        }
+        return;
+    }
+
+    for (uint32_t tileRow = range.first.row / kTileRows; tileRow <= range.last.row / kTileRows; ++tileRow) {
+        for (uint32_t tileColumn = range.first.column / kTileColumns; tileColumn <= range.last.column / kTileColumns; ++tileColumn) {
+            auto it = tiles.find(tileKey(tileRow, tileColumn));
+            if (it != tiles.end()) {
+                it->second.dirty = true;
+            }
+        }
+    }
+}
+
+void FormatViewportCache::invalidateCells(const std::vector<CellChange>& changes) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (const auto& change : changes) {
+        auto it = tiles.find(tileKey(change.cell.row / kTileRows, change.cell.column / kTileColumns));
+        if (it != tiles.end()) {
+            it->second.dirty = true;
+        }
+    }
+}
+
+void FormatViewportCache::invalidateAll() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    tiles.clear();
+}
+
+size_t FormatViewportCache::getTileCount() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return tiles.size();
+}
+
+uint64_t FormatViewportCache::tileKey(uint32_t tileRow, uint32_t tileColumn) {
+    return (static_cast<uint64_t>(tileRow) << 32) | tileColumn;
+}
+
+CellRange FormatViewportCache::tileRange(uint32_t tileRow, uint32_t tileColumn) {
+    return CellRange{
+        CellAddress{tileRow * kTileRows, tileColumn * kTileColumns},
+        CellAddress{tileRow * kTileRows + kTileRows - 1, tileColumn * kTileColumns + kTileColumns - 1}};
+}
+
+// Resolve a tile in one bulk pass: base styles first, then the conditional overlay
+FormatViewportCache::Tile& FormatViewportCache::ensureTile(uint32_t tileRow, uint32_t tileColumn) {
+    Tile& tile = tiles[tileKey(tileRow, tileColumn)];
+    if (!tile.styles.empty() && !tile.dirty) {
+        return tile;
+    }
+
+    CellRange range = tileRange(tileRow, tileColumn);
+    formattingEngine->resolveStyles(range, tile.styles);
+    if (conditionalOverlay) {
+        conditionalOverlay(range, tile.styles);
+    }
+    tile.dirty = false;
+    return tile;
+}
@@ -0,0 +1,86 @@
+#ifndef FORMAT_VIEWPORT_CACHE_H
+#define FORMAT_VIEWPORT_CACHE_H
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <cstdint>
+#include "FormattingEngine.h"
+#include "ChangeFeed.h"
+#include "CellAddress.h"
+
+// Caches the fully resolved effective style of the visible window for rendering.
+// The sheet is divided into fixed-size tiles; each tile holds a dense row-major array of
+// StyleIds resolved in one bulk pass (base layers, row/column styles, then the conditional
+// formatting overlay). Scrolling resolves only newly exposed tiles, and format or value
+// changes mark just the intersecting tiles dirty.
+class FormatViewportCache {
+public:
+    static constexpr uint32_t kTileRows = 32;
+    static constexpr uint32_t kTileColumns = 16;
+
+    // Adjusts resolved base styles in place for conditional formatting; styles is row-major
+    // for tile and any new effective styles must be interned in the workbook StyleTable
+    using ConditionalOverlay = std::function<void(const CellRange& tile, std::vector<StyleId>& styles)>;
+
+    // Initializes the cache and subscribes to format changes of the given engine
+    explicit FormatViewportCache(FormattingEngine* engine);
+
+    // Also subscribes to value changes, which can change conditional formatting; the feed
+    // must outlive the cache
+    FormatViewportCache(FormattingEngine* engine, ChangeFeed* feed);
+
+    // Unsubscribes, waiting for notifications already running to return
+    ~FormatViewportCache();
+
+    FormatViewportCache(const FormatViewportCache&) = delete;
+    FormatViewportCache& operator=(const FormatViewportCache&) = delete;
+
+    // Sets the conditional formatting overlay and drops all cached tiles
+    void setConditionalOverlay(ConditionalOverlay overlay);
+
+    // Moves the visible window; tiles outside it are evicted and exposed tiles are resolved
+    void setViewport(const CellRange& viewport);
+
+    // Returns the effective style for a cell, resolving its tile if needed
+    StyleId getStyleId(const CellAddress& cell);
+
+    // Returns the effective format for a cell
+    const CellFormat& getFormat(const CellAddress& cell);
+
+    // Marks tiles intersecting the range dirty, e.g. after changes the cache is not subscribed
+    // to; format changes, and value changes when built with a feed, are picked up automatically
+    void invalidate(const CellRange& range);
+
+    // Drops every cached tile
+    void invalidateAll();
+
+    // Returns the number of tiles currently cached
+    size_t getTileCount() const;
+
+private:
+    struct Tile {
+        std::vector<StyleId> styles;
+        bool dirty = false;
+    };
+
+    FormattingEngine* formattingEngine;
+    size_t listenerId;
+    ChangeFeed* changeFeed;
+    size_t subscriptionId;
+    ConditionalOverlay conditionalOverlay;
+    std::unordered_map<uint64_t, Tile> tiles;
+    mutable std::mutex cacheMutex;
+
+    static uint64_t tileKey(uint32_t tileRow, uint32_t tileColumn);
+    static CellRange tileRange(uint32_t tileRow, uint32_t tileColumn);
+
+    // Marks the tiles holding the changed cells dirty
+    void invalidateCells(const std::vector<CellChange>& changes);
+
+    // Returns the resolved tile, resolving it if missing or dirty. Caller must hold cacheMutex.
+    Tile& ensureTile(uint32_t tileRow, uint32_t tileColumn);
+};
+
+#endif // FORMAT_VIEWPORT_CACHE_H
@@ -1,93 +1,219 @@
 #include "FormattingEngine.h"
+#include "StyleTable.h"
+#include "CellAddress.h"
 #include <stdexcept>
 #include <algorithm>
 #include <mutex>
 
 // Constructor implementation
-FormattingEngine::FormattingEngine() {
-    // Initialize the cellFormats map
-    // No initialization needed as the map is empty by default
+FormattingEngine::FormattingEngine(std::shared_ptr<StyleTable> styles)
+    : styleTable(styles ? std::move(styles) : std::make_shared<StyleTable>()),
+      nextSequence(0),
+      nextListenerId(0) {
+    // Cells not covered by any layer use the default style
 }
 
 // Set the format for a specific cell or range of cells
 void FormattingEngine::setCellFormat(const std::string& cellRange, const CellFormat& format) {
-    std::lock_guard<std::mutex> lock(formatMutex);
-    
-    // Expand the cell range into individual cell references
-    std::vector<std::string> cells = expandCellRange(cellRange);
-    
-    // For each cell reference, set or update the format in cellFormats
-    for (const auto& cell : cells) {
-        cellFormats[cell] = format;
+    CellRange range = parseCellRange(cellRange);
+
+    // Intern the format once; every cell in the range shares the same ID
+    StyleId styleId = styleTable->intern(format);
+
+    {
+        std::lock_guard<std::mutex> lock(formatMutex);
+        addLayer(range, styleId);
     }
+    notifyFormatChange(range);
 }
 
 // Retrieve the format for a specific cell
-CellFormat FormattingEngine::getCellFormat(const std::string& cellReference) {
+CellFormat FormattingEngine::getCellFormat(const std::string& cellReference) const {
+    return styleTable->getStyle(getCellStyleId(cellReference));
+}
+
+// Retrieve the style ID for a specific cell
+StyleId FormattingEngine::getCellStyleId(const std::string& cellReference) const {
+    CellAddress cell = parseCellAddress(cellReference);
+
     std::lock_guard<std::mutex> lock(formatMutex);
-    
-    // Look up the cell reference in cellFormats
-    auto it = cellFormats.find(cellReference);
-    
-    // If found, return the associated CellFormat
-    if (it != cellFormats.end()) {
-        return it->second;
+
+    // The newest layer covering the cell wins; uncovered cells use the default style
+    StyleId styleId = kDefaultStyleId;
+    uint64_t newest = 0;
+    bool found = false;
+    formatLayers.forEachContaining(cell, [&](const CellRange&, const FormatLayer& layer) {
+        if (!found || layer.sequence > newest) {
+            styleId = layer.styleId;
+            newest = layer.sequence;
+            found = true;
+        }
+    });
+    return styleId;
+}
+
+// Resolve a whole block of styles with one lock acquisition and one index query
+void FormattingEngine::resolveStyles(const CellRange& range, std::vector<StyleId>& styles) const {
+    struct ClippedLayer {
+        CellRange rect;
+        FormatLayer layer;
+    };
+    std::vector<ClippedLayer> layers;
+    {
+        std::lock_guard<std::mutex> lock(formatMutex);
+        formatLayers.forEachIntersecting(range, [&](const CellRange& rect, const FormatLayer& layer) {
+            CellRange clipped{
+                CellAddress{std::max(rect.first.row, range.first.row), std::max(rect.first.column, range.first.column)},
+                CellAddress{std::min(rect.last.row, range.last.row), std::min(rect.last.column, range.last.column)}};
+            layers.push_back(ClippedLayer{clipped, layer});
+        });
     }
-    
-    // If not found, return a default CellFormat
-    return CellFormat();
+
+    // Paint oldest to newest so the newest layer ends up on top
+    std::sort(layers.begin(), layers.end(), [](const ClippedLayer& a, const ClippedLayer& b) {
+        return a.layer.sequence < b.layer.sequence;
+    });
+
+    const uint32_t cols = range.columnCount();
+    styles.assign(range.cellCount(), kDefaultStyleId);
+    for (const auto& clipped : layers) {
+        for (uint32_t row = clipped.rect.first.row; row <= clipped.rect.last.row; ++row) {
+            auto rowStart = styles.begin() + static_cast<std::ptrdiff_t>(static_cast<size_t>(row - range.first.row) * cols);
+            std::fill(rowStart + (clipped.rect.first.column - range.first.column),
+                      rowStart + (clipped.rect.last.column - range.first.column + 1),
+                      clipped.layer.styleId);
+        }
+    }
+}
+
+// Register a format change listener
+size_t FormattingEngine::addFormatChangeListener(FormatChangeListener listener) {
+    std::lock_guard<std::mutex> lock(listenerMutex);
+    size_t listenerId = nextListenerId++;
+    auto entry = std::make_shared<ListenerEntry>();
+    entry->id = listenerId;
+    entry->callback = std::move(listener);
+    changeListeners.push_back(std::move(entry));
+    return listenerId;
+}
+
+// Unregister a format change listener, then wait until no other thread is still inside it
+void FormattingEngine::removeFormatChangeListener(size_t listenerId) {
+    std::unique_lock<std::mutex> lock(listenerMutex);
+    auto it = std::find_if(changeListeners.begin(), changeListeners.end(),
+                           [listenerId](const auto& entry) { return entry->id == listenerId; });
+    if (it == changeListeners.end()) {
+        return;
+    }
+    std::shared_ptr<ListenerEntry> entry = *it;
+    changeListeners.erase(it);
+    entry->removed = true;
+
+    const std::thread::id self = std::this_thread::get_id();
+    listenerIdle.wait(lock, [&entry, self]() {
+        return std::all_of(entry->callers.begin(), entry->callers.end(),
+                           [self](std::thread::id caller) { return caller == self; });
+    });
+}
+
+void FormattingEngine::notifyFormatChange(const CellRange& range) {
+    std::vector<std::shared_ptr<ListenerEntry>> listeners;
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listeners = changeListeners;
+    }
+    for (const auto& entry : listeners) {
+        // Listeners removed since the copy was taken are skipped; the rest are marked busy
+        {
+            std::lock_guard<std::mutex> lock(listenerMutex);
+            if (entry->removed) {
+                continue;
+            }
+            entry->callers.push_back(std::this_thread::get_id());
+        }
+        try {
+            entry->callback(range);
+        } catch (...) {
+            finishListenerCall(*entry);
+            throw;
+        }
+        finishListenerCall(*entry);
+    }
+}
+
+void FormattingEngine::finishListenerCall(ListenerEntry& entry) {
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        entry.callers.erase(std::find(entry.callers.begin(), entry.callers.end(), std::this_thread::get_id()));
+    }
+    listenerIdle.notify_all();
+}
+
+// Resolve a style ID to its format
+const CellFormat& FormattingEngine::getStyle(StyleId styleId) const {
+    return styleTable->getStyle(styleId);
+}
+
+std::shared_ptr<StyleTable> FormattingEngine::getStyleTable() const {
+    return styleTable;
+}
+
+size_t FormattingEngine::getLayerCount() const {
+    std::lock_guard<std::mutex> lock(formatMutex);
+    return formatLayers.size();
 }
 
 // Clear the format for a specific cell or range of cells
 void FormattingEngine::clearCellFormat(const std::string& cellRange) {
-    std::lock_guard<std::mutex> lock(formatMutex);
-    
-    // Expand the cell range into individual cell references
-    std::vector<std::string> cells = expandCellRange(cellRange);
-    
-    // For each cell reference, remove the format from cellFormats if it exists
-    for (const auto& cell : cells) {
-        cellFormats.erase(cell);
+    CellRange range = parseCellRange(cellRange);
+
+    // Clearing is a default-style layer, which also hides everything underneath it
+    {
+        std::lock_guard<std::mutex> lock(formatMutex);
+        addLayer(range, kDefaultStyleId);
     }
+    notifyFormatChange(range);
 }
 
-// Expand a cell range string into individual cell references
-std::vector<std::string> FormattingEngine::expandCellRange(const std::string& cellRange) {
-    std::vector<std::string> result;
-    
-    // Parse the cell range string (e.g., 'A1:B3')
-    size_t colonPos = cellRange.find(':');
-    if (colonPos == std::string::npos) {
-        // Single cell reference
-        result.push_back(cellRange);
-        return result;
-    }
-    
-    std::string startCell = cellRange.substr(0, colonPos);
-    std::string endCell = cellRange.substr(colonPos + 1);
-    
-    // Determine the start and end columns and rows
-    char startCol = startCell[0];
-    int startRow = std::stoi(startCell.substr(1));
-    char endCol = endCell[0];
-    int endRow = std::stoi(endCell.substr(1));
-    
-    // Generate all cell references within the range
-    for (char col = startCol; col <= endCol; ++col) {
-        for (int row = startRow; row <= endRow; ++row) {
-            result.push_back(std::string(1, col) + std::to_string(row));
+// Add a layer on top of the existing ones
+void FormattingEngine::addLayer(const CellRange& range, StyleId styleId) {
+    // Take out every layer the new one overlaps, updating only the index nodes around range
+    std::vector<std::pair<CellRange, FormatLayer>> overlapped;
+    formatLayers.removeIntersecting(range, [&overlapped](const CellRange& rect, const FormatLayer& layer) {
+        overlapped.emplace_back(rect, layer);
+        return true;
+    });
+
+    // Put back what lies outside range: full-width bands above and below, then the parts to
+    // the left and right within range's rows
+    for (const auto& entry : overlapped) {
+        const CellRange& rect = entry.first;
+        const uint32_t top = std::max(rect.first.row, range.first.row);
+        const uint32_t bottom = std::min(rect.last.row, range.last.row);
+        if (rect.first.row < range.first.row) {
+            formatLayers.insert(CellRange{rect.first, CellAddress{range.first.row - 1, rect.last.column}}, entry.second);
         }
+        if (rect.last.row > range.last.row) {
+            formatLayers.insert(CellRange{CellAddress{range.last.row + 1, rect.first.column}, rect.last}, entry.second);
+        }
+        if (rect.first.column < range.first.column) {
+            formatLayers.insert(CellRange{CellAddress{top, rect.first.column}, CellAddress{bottom, range.first.column - 1}},
+                                entry.second);
+        }
+        if (rect.last.column > range.last.column) {
+            formatLayers.insert(CellRange{CellAddress{top, range.last.column + 1}, CellAddress{bottom, rect.last.column}},
+                                entry.second);
+        }
+    }
+
+    // Uncovered cells already use the default style
+    if (styleId != kDefaultStyleId) {
+        formatLayers.insert(range, FormatLayer{styleId, nextSequence++});
     }
-    
-    return result;
 }
 
 // Human tasks:
-// TODO: Implement efficient storage for shared formats across multiple cells
 // TODO: Add support for conditional formatting
 // TODO: Implement caching mechanism for frequently accessed cell formats
-// TODO: Add support for inheriting formats from column or row styles
-// TODO: Implement bulk clear operation for improved performance
 // TODO: Add support for clearing specific format properties while retaining others
-// TODO: Optimize the expansion algorithm for large ranges
 // TODO: Add support for non-contiguous ranges (e.g., 'A1:B3,D5:E7')
\ No newline at end of file
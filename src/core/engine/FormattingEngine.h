@@ -4,10 +4,18 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <memory>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <cstdint>
+#include "CellAddress.h"
+#include "RectangleIndex.h"
 
 // Forward declarations
 class ConditionalFormat;
+class StyleTable;
 
 // Enum for horizontal alignment
 enum class HorizontalAlignment {
@@ -30,6 +38,11 @@ public:
     unsigned char r, g, b, a;
     Color(unsigned char r = 0, unsigned char g = 0, unsigned char b = 0, unsigned char a = 255)
         : r(r), g(g), b(b), a(a) {}
+
+    bool operator==(const Color& other) const {
+        return r == other.r && g == other.g && b == other.b && a == other.a;
+    }
+    bool operator!=(const Color& other) const { return !(*this == other); }
 };
 
 // CellFormat class to represent the formatting properties of a cell
@@ -51,17 +64,68 @@ public:
                    isUnderlined(false), textColor(0, 0, 0), backgroundColor(255, 255, 255),
                    horizontalAlignment(HorizontalAlignment::Left),
                    verticalAlignment(VerticalAlignment::Top), numberFormat("General") {}
+
+    bool operator==(const CellFormat& other) const {
+        return fontSize == other.fontSize && isBold == other.isBold && isItalic == other.isItalic &&
+               isUnderlined == other.isUnderlined && textColor == other.textColor &&
+               backgroundColor == other.backgroundColor && horizontalAlignment == other.horizontalAlignment &&
+               verticalAlignment == other.verticalAlignment && fontName == other.fontName &&
+               numberFormat == other.numberFormat;
+    }
+    bool operator!=(const CellFormat& other) const { return !(*this == other); }
 };
 
-// FormattingEngine class to manage cell formatting
+// Identifier of a CellFormat interned in a StyleTable; 0 is always the default format
+using StyleId = uint32_t;
+constexpr StyleId kDefaultStyleId = 0;
+
+// FormattingEngine class to manage cell formatting.
+// Formats are interned in a workbook StyleTable and stored as styled rectangles (whole rows
+// and columns are just wide rectangles) in a spatial index. A new layer clips the older ones
+// it overlaps, so layers never overlap and their number stays proportional to the distinct
+// regions; applying, clearing or querying a range costs O(rectangles), not O(cells).
 class FormattingEngine {
 private:
-    std::unordered_map<std::string, CellFormat> cellFormats;
+    struct FormatLayer {
+        StyleId styleId;
+        uint64_t sequence;
+    };
+
+public:
+    // Called with the affected range after formats change
+    using FormatChangeListener = std::function<void(const CellRange& range)>;
+
+private:
+    std::shared_ptr<StyleTable> styleTable;
+    RectangleIndex<FormatLayer> formatLayers;
+    uint64_t nextSequence;
+    // A registered listener and the threads currently inside it
+    struct ListenerEntry {
+        size_t id;
+        FormatChangeListener callback;
+        bool removed = false;
+        std::vector<std::thread::id> callers;
+    };
+
+    std::vector<std::shared_ptr<ListenerEntry>> changeListeners;
+    size_t nextListenerId;
     mutable std::mutex formatMutex;
+    mutable std::mutex listenerMutex;
+    std::condition_variable listenerIdle;
+
+    // Ends one call of a listener and wakes removers waiting for it
+    void finishListenerCall(ListenerEntry& entry);
+
+    // Invokes the change listeners; must be called without formatMutex held
+    void notifyFormatChange(const CellRange& range);
+
+    // Adds a layer on top, cutting its area out of the older layers it overlaps; a default
+    // style only cuts. Caller must hold formatMutex.
+    void addLayer(const CellRange& range, StyleId styleId);
 
 public:
-    // Constructor
-    FormattingEngine() = default;
+    // Constructor: uses the given workbook style table, or creates a private one
+    explicit FormattingEngine(std::shared_ptr<StyleTable> styles = nullptr);
 
     // Sets the format for a specific cell or range of cells
     void setCellFormat(const std::string& cellRange, const CellFormat& format);
@@ -69,6 +133,30 @@ public:
     // Retrieves the format for a specific cell
     CellFormat getCellFormat(const std::string& cellReference) const;
 
+    // Retrieves the style ID for a specific cell without copying the format
+    StyleId getCellStyleId(const std::string& cellReference) const;
+
+    // Resolves the style of every cell in a block in one pass, row-major, by painting the
+    // intersecting layers oldest to newest into the output array
+    void resolveStyles(const CellRange& range, std::vector<StyleId>& styles) const;
+
+    // Registers a listener notified after setCellFormat and clearCellFormat; returns its ID
+    size_t addFormatChangeListener(FormatChangeListener listener);
+
+    // Unregisters a listener by the ID returned from addFormatChangeListener. Waits for calls
+    // of it running on other threads to return, so its captures may be destroyed afterwards;
+    // a listener may remove itself.
+    void removeFormatChangeListener(size_t listenerId);
+
+    // Resolves a style ID to its format; the reference stays valid for the table's lifetime
+    const CellFormat& getStyle(StyleId styleId) const;
+
+    // Returns the workbook style table shared by this engine
+    std::shared_ptr<StyleTable> getStyleTable() const;
+
+    // Returns the number of stored format rectangles
+    size_t getLayerCount() const;
+
     // Clears the format for a specific cell or range of cells
     void clearCellFormat(const std::string& cellRange);
 
@@ -81,11 +169,9 @@ public:
 
 // Human tasks:
 // TODO: Add comprehensive documentation for each method, including usage examples and best practices
-// TODO: Implement support for named styles that can be applied to multiple cells
 // TODO: Add methods for bulk formatting operations to improve performance
 // TODO: Implement a mechanism to export and import cell formats
 // TODO: Add support for gradients and other advanced fill options in cell backgrounds
-// TODO: Implement a notification system for format changes to update UI
 // TODO: Add support for format inheritance (e.g., from column or row styles)
 
 #endif // FORMATTING_ENGINE_H
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <stdexcept>
 #include <cmath>
 #include <algorithm>
+#include <numeric>
 #include <mutex>
 
 // Constructor implementation
@@ -33,6 +34,12 @@ FormulaParser::FormulaParser() {
 
 // Parse and evaluate the formula
 double FormulaParser::parseFormula(const std::string& formula, const std::function<std::string(const std::string&)>& cellValueProvider) {
+    // Only the translation needs the lock; the compiled program evaluates without it
+    return compile(formula).evaluate(cellValueProvider);
+}
+
+// Convert the formula to Reverse Polish Notation and resolve its operators and functions
+CompiledFormula FormulaParser::compile(const std::string& formula) const {
     std::lock_guard<std::mutex> lock(parserMutex);
 
     // Tokenize the input formula
@@ -81,8 +88,37 @@ double FormulaParser::parseFormula(const std::string& formula, const std::functi
         operatorStack.pop();
     }
 
-    // Evaluate the RPN expression
-    return evaluateRPN(rpnTokens, cellValueProvider);
+    // Resolve each RPN token into a step; separators such as ',' produce none
+    CompiledFormula program;
+    for (const auto& token : rpnTokens) {
+        CompiledFormula::Step step;
+        if (std::isdigit(token[0]) || (token[0] == '-' && token.length() > 1)) {
+            step.kind = CompiledFormula::Step::Number;
+            try {
+                step.number = std::stod(token);
+            } catch (const std::exception&) {
+                throw std::runtime_error("Invalid formula: bad number " + token);
+            }
+        } else if (std::isalpha(token[0])) {
+            auto function = functions.find(token);
+            if (function != functions.end()) {
+                step.kind = CompiledFormula::Step::Function;
+                step.function = function->second;
+            } else {
+                step.kind = CompiledFormula::Step::Reference;
+                step.reference = token;
+            }
+        } else {
+            auto op = operators.find(token);
+            if (op == operators.end()) {
+                continue;
+            }
+            step.kind = CompiledFormula::Step::Operator;
+            step.binary = op->second;
+        }
+        program.steps.push_back(std::move(step));
+    }
+    return program;
 }
 
 // Tokenize the formula string
@@ -122,34 +158,51 @@ std::vector<std::string> FormulaParser::tokenize(const std::string& formula) {
     return tokens;
 }
 
-// Evaluate the RPN expression
-double FormulaParser::evaluateRPN(const std::vector<std::string>& rpnTokens, const std::function<std::string(const std::string&)>& cellValueProvider) {
-    std::stack<double> operandStack;
+std::vector<std::string> CompiledFormula::references() const {
+    std::vector<std::string> result;
+    for (const auto& step : steps) {
+        if (step.kind == Step::Reference && std::find(result.begin(), result.end(), step.reference) == result.end()) {
+            result.push_back(step.reference);
+        }
+    }
+    return result;
+}
 
-    for (const auto& token : rpnTokens) {
-        if (std::isdigit(token[0]) || (token[0] == '-' && token.length() > 1)) {
-            operandStack.push(std::stod(token));
-        } else if (std::isalpha(token[0])) {
-            if (functions.find(token) != functions.end()) {
-                // Function call
-                std::vector<double> args;
-                while (!operandStack.empty()) {
-                    args.push_back(operandStack.top());
-                    operandStack.pop();
+// Evaluate the compiled RPN program
+double CompiledFormula::evaluate(const std::function<std::string(const std::string&)>& cellValueProvider) const {
+    std::vector<double> operandStack;
+
+    for (const auto& step : steps) {
+        switch (step.kind) {
+            case Step::Number:
+                operandStack.push_back(step.number);
+                break;
+            case Step::Reference: {
+                std::string cellValue = cellValueProvider(step.reference);
+                try {
+                    operandStack.push_back(std::stod(cellValue));
+                } catch (const std::exception&) {
+                    throw std::runtime_error("Cell " + step.reference + " does not hold a number");
                 }
-                std::reverse(args.begin(), args.end());
-                operandStack.push(functions[token](args));
-            } else {
-                // Cell reference
-                std::string cellValue = cellValueProvider(token);
-                operandStack.push(std::stod(cellValue));
+                break;
+            }
+            case Step::Function: {
+                // A function call takes every operand on the stack
+                std::vector<double> args(operandStack.begin(), operandStack.end());
+                operandStack.clear();
+                operandStack.push_back(step.function(args));
+                break;
+            }
+            case Step::Operator: {
+                if (operandStack.size() < 2) {
+                    throw std::runtime_error("Invalid formula: operator is missing an operand");
+                }
+                double b = operandStack.back();
+                operandStack.pop_back();
+                double a = operandStack.back();
+                operandStack.back() = step.binary(a, b);
+                break;
             }
-        } else if (operators.find(token) != operators.end()) {
-            double b = operandStack.top();
-            operandStack.pop();
-            double a = operandStack.top();
-            operandStack.pop();
-            operandStack.push(operators[token](a, b));
         }
     }
 
@@ -157,7 +210,7 @@ double FormulaParser::evaluateRPN(const std::vector<std::string>& rpnTokens, con
         throw std::runtime_error("Invalid formula: unexpected number of operands");
     }
 
-    return operandStack.top();
+    return operandStack.back();
 }
 
 // Human tasks:
@@ -7,6 +7,33 @@
 #include <functional>
 #include <mutex>
 
+// A formula translated once into a postfix program with its operators and functions already
+// resolved. Evaluating it takes no lock, so one program can run on many threads at once.
+class CompiledFormula {
+public:
+    // Evaluates the program; cell references are resolved through cellValueProvider and
+    // must yield numbers. Throws std::runtime_error for a malformed formula.
+    double evaluate(const std::function<std::string(const std::string&)>& cellValueProvider) const;
+
+    // Returns the cell references the program reads, each once, in order of first use
+    std::vector<std::string> references() const;
+
+private:
+    friend class FormulaParser;
+
+    struct Step {
+        enum Kind { Number, Reference, Operator, Function };
+
+        Kind kind = Number;
+        double number = 0.0;
+        std::string reference;
+        double (*binary)(double, double) = nullptr;
+        double (*function)(const std::vector<double>&) = nullptr;
+    };
+
+    std::vector<Step> steps;
+};
+
 class FormulaParser {
 public:
     // Constructor: Initializes the FormulaParser with standard operators and functions
@@ -18,6 +45,11 @@ public:
     // @return: The result of the formula evaluation
     double parseFormula(const std::string& formula, const std::function<std::string(const std::string&)>& cellValueProvider);
 
+    // Translates a formula into a program that can be evaluated repeatedly without the parser
+    // @param formula: The Excel formula, without a leading '='
+    // @return: The compiled program; later operator or function registrations do not affect it
+    CompiledFormula compile(const std::string& formula) const;
+
     // Registers a custom operator
     // @param op: The operator symbol (e.g., "+", "-", "*", "/")
     // @param func: A pointer to the function that implements the operator
@@ -37,6 +69,9 @@ private:
 
     // Mutex for thread-safe operations
     mutable std::mutex parserMutex;
+
+    // Splits a formula into number, reference, function, operator and parenthesis tokens
+    static std::vector<std::string> tokenize(const std::string& formula);
 };
 
 // Human tasks:
@@ -0,0 +1,314 @@
+#include "RangeSnapshot.h"
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+
+// Returns true and sets result if text is a number whose shortest representation
+// reproduces text exactly, so storing it as a double is lossless
+bool parseExactNumber(std::string_view text, double& result) {
+    if (text.empty() || text.size() > 24) {
+        return false;
+    }
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    auto parsed = std::from_chars(begin, end, result);
+    if (parsed.ec != std::errc() || parsed.ptr != end) {
+        return false;
+    }
+    char buffer[32];
+    auto printed = std::to_chars(buffer, buffer + sizeof(buffer), result);
+    return printed.ec == std::errc() && std::string_view(buffer, static_cast<size_t>(printed.ptr - buffer)) == text;
+}
+
+std::string formatNumber(double value) {
+    char buffer[32];
+    auto printed = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, printed.ptr);
+}
+
+template <typename T>
+void appendValue(std::string& out, const T& value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+// Appends a count followed by the raw elements
+template <typename T>
+void appendArray(std::string& out, const std::vector<T>& values) {
+    appendValue(out, static_cast<uint32_t>(values.size()));
+    if (!values.empty()) {
+        out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+}
+
+template <typename T>
+T readValue(const std::string& in, size_t& pos) {
+    if (pos > in.size() || in.size() - pos < sizeof(T)) {
+        throw std::runtime_error("Range snapshot encoding is truncated");
+    }
+    T value;
+    std::memcpy(&value, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+template <typename T>
+std::vector<T> readArray(const std::string& in, size_t& pos) {
+    uint32_t count = readValue<uint32_t>(in, pos);
+    if ((in.size() - pos) / sizeof(T) < count) {
+        throw std::runtime_error("Range snapshot encoding is truncated");
+    }
+    std::vector<T> values(count);
+    if (count > 0) {
+        std::memcpy(values.data(), in.data() + pos, count * sizeof(T));
+    }
+    pos += count * sizeof(T);
+    return values;
+}
+
+} // namespace
+
+// Capture the block column by column, run-length encoding blanks
+RangeSnapshot RangeSnapshot::capture(const CellRange& range, const BlockReader& reader) {
+    RangeSnapshot snapshot;
+    snapshot.range = range;
+    snapshot.columns.resize(range.columnCount());
+
+    std::vector<std::string_view> block;
+    reader(range, block);
+    if (block.size() != range.cellCount()) {
+        throw std::runtime_error("Block read does not match range size");
+    }
+
+    // Keys view the block, which stays valid until the next write
+    std::unordered_map<std::string_view, uint32_t> stringIds;
+    const uint32_t rows = range.rowCount();
+    const uint32_t cols = range.columnCount();
+
+    for (uint32_t col = 0; col < cols; ++col) {
+        ColumnLanes& lanes = snapshot.columns[col];
+        for (uint32_t row = 0; row < rows; ++row) {
+            std::string_view value = block[static_cast<size_t>(row) * cols + col];
+
+            if (value.empty()) {
+                // Extend the current blank run or start a new one
+                if (!lanes.blankRuns.empty() &&
+                    lanes.blankRuns.back().startRow + lanes.blankRuns.back().length == row) {
+                    ++lanes.blankRuns.back().length;
+                } else {
+                    lanes.blankRuns.push_back(BlankRun{row, 1});
+                }
+                continue;
+            }
+
+            double number = 0.0;
+            if (parseExactNumber(value, number)) {
+                lanes.kinds.push_back(LaneKind::Number);
+                lanes.numbers.push_back(number);
+            } else {
+                auto inserted = stringIds.emplace(value, static_cast<uint32_t>(snapshot.stringPool.size()));
+                if (inserted.second) {
+                    snapshot.stringPool.emplace_back(value);
+                }
+                lanes.kinds.push_back(LaneKind::Text);
+                lanes.textIds.push_back(inserted.first->second);
+            }
+        }
+
+        lanes.blankRuns.shrink_to_fit();
+        lanes.kinds.shrink_to_fit();
+        lanes.numbers.shrink_to_fit();
+        lanes.textIds.shrink_to_fit();
+    }
+
+    return snapshot;
+}
+
+// Decode the column lanes back into a row-major block of values
+std::vector<std::string> RangeSnapshot::toRowMajor() const {
+    const uint32_t rows = range.rowCount();
+    const uint32_t cols = range.columnCount();
+    std::vector<std::string> values(static_cast<size_t>(rows) * cols);
+
+    for (uint32_t col = 0; col < cols; ++col) {
+        const ColumnLanes& lanes = columns[col];
+        size_t runIndex = 0;
+        size_t kindIndex = 0;
+        size_t numberIndex = 0;
+        size_t textIndex = 0;
+
+        for (uint32_t row = 0; row < rows; ++row) {
+            if (runIndex < lanes.blankRuns.size() && row >= lanes.blankRuns[runIndex].startRow) {
+                // Skip the whole blank run; values are already empty
+                row = lanes.blankRuns[runIndex].startRow + lanes.blankRuns[runIndex].length - 1;
+                ++runIndex;
+                continue;
+            }
+
+            std::string& target = values[static_cast<size_t>(row) * cols + col];
+            if (lanes.kinds[kindIndex++] == LaneKind::Number) {
+                target = formatNumber(lanes.numbers[numberIndex++]);
+            } else {
+                target = stringPool[lanes.textIds[textIndex++]];
+            }
+        }
+    }
+
+    return values;
+}
+
+size_t RangeSnapshot::memoryFootprint() const {
+    size_t bytes = sizeof(RangeSnapshot) + columns.capacity() * sizeof(ColumnLanes);
+    for (const auto& lanes : columns) {
+        bytes += lanes.blankRuns.capacity() * sizeof(BlankRun) +
+                 lanes.kinds.capacity() * sizeof(LaneKind) +
+                 lanes.numbers.capacity() * sizeof(double) +
+                 lanes.textIds.capacity() * sizeof(uint32_t);
+    }
+    for (const auto& text : stringPool) {
+        bytes += sizeof(std::string) + text.capacity();
+    }
+    return bytes;
+}
+
+// Range, then per column its blank runs and lanes, then the string pool
+void RangeSnapshot::serialize(std::string& out) const {
+    appendValue(out, range.first.row);
+    appendValue(out, range.first.column);
+    appendValue(out, range.last.row);
+    appendValue(out, range.last.column);
+    for (const auto& lanes : columns) {
+        appendArray(out, lanes.blankRuns);
+        appendArray(out, lanes.kinds);
+        appendArray(out, lanes.numbers);
+        appendArray(out, lanes.textIds);
+    }
+    appendValue(out, static_cast<uint32_t>(stringPool.size()));
+    for (const auto& text : stringPool) {
+        appendValue(out, static_cast<uint32_t>(text.size()));
+        out.append(text);
+    }
+}
+
+RangeSnapshot RangeSnapshot::deserialize(const std::string& in, size_t& pos) {
+    RangeSnapshot snapshot;
+    snapshot.range.first.row = readValue<uint32_t>(in, pos);
+    snapshot.range.first.column = readValue<uint32_t>(in, pos);
+    snapshot.range.last.row = readValue<uint32_t>(in, pos);
+    snapshot.range.last.column = readValue<uint32_t>(in, pos);
+    if (snapshot.range.last.row < snapshot.range.first.row || snapshot.range.last.column < snapshot.range.first.column ||
+        snapshot.range.columnCount() > in.size() - pos) {
+        throw std::runtime_error("Range snapshot encoding is malformed");
+    }
+
+    snapshot.columns.resize(snapshot.range.columnCount());
+    for (auto& lanes : snapshot.columns) {
+        lanes.blankRuns = readArray<BlankRun>(in, pos);
+        lanes.kinds = readArray<LaneKind>(in, pos);
+        lanes.numbers = readArray<double>(in, pos);
+        lanes.textIds = readArray<uint32_t>(in, pos);
+    }
+
+    uint32_t poolSize = readValue<uint32_t>(in, pos);
+    for (uint32_t i = 0; i < poolSize; ++i) {
+        uint32_t length = readValue<uint32_t>(in, pos);
+        if (in.size() - pos < length) {
+            throw std::runtime_error("Range snapshot encoding is truncated");
+        }
+        snapshot.stringPool.emplace_back(in, pos, length);
+        pos += length;
+    }
+
+    // toRowMajor trusts the lanes, so check they describe exactly the block's cells
+    const uint32_t rows = snapshot.range.rowCount();
+    for (const auto& lanes : snapshot.columns) {
+        uint64_t blanks = 0;
+        uint32_t nextRow = 0;
+        for (const auto& run : lanes.blankRuns) {
+            if (run.startRow < nextRow || run.length == 0 || run.length > rows - run.startRow) {
+                throw std::runtime_error("Range snapshot encoding is malformed");
+            }
+            nextRow = run.startRow + run.length;
+            blanks += run.length;
+        }
+        size_t numberCount = std::count(lanes.kinds.begin(), lanes.kinds.end(), LaneKind::Number);
+        bool validKinds = std::all_of(lanes.kinds.begin(), lanes.kinds.end(),
+                                      [](LaneKind kind) { return kind == LaneKind::Number || kind == LaneKind::Text; });
+        bool validIds = std::all_of(lanes.textIds.begin(), lanes.textIds.end(),
+                                    [&snapshot](uint32_t id) { return id < snapshot.stringPool.size(); });
+        if (blanks + lanes.kinds.size() != rows || !validKinds || !validIds || numberCount != lanes.numbers.size() ||
+            lanes.kinds.size() - numberCount != lanes.textIds.size()) {
+            throw std::runtime_error("Range snapshot encoding is malformed");
+        }
+    }
+    return snapshot;
+}
+
+RangeSnapshotAction::RangeSnapshotAction(RangeSnapshot before, RangeSnapshot::BlockReader reader, BlockWriter writer)
+    : beforeSnapshot(std::move(before)),
+      hasAfterSnapshot(false),
+      blockReader(std::move(reader)),
+      blockWriter(std::move(writer)) {
+    if (!blockReader || !blockWriter) {
+        throw std::invalid_argument("RangeSnapshotAction requires a block reader and a block writer");
+    }
+}
+
+// Restore the previous contents, first capturing what is being replaced for redo
+void RangeSnapshotAction::undo() {
+    if (!hasAfterSnapshot) {
+        afterSnapshot = RangeSnapshot::capture(beforeSnapshot.getRange(), blockReader);
+        hasAfterSnapshot = true;
+    }
+    blockWriter(beforeSnapshot.getRange(), beforeSnapshot.toRowMajor());
+}
+
+// Reapply the contents captured at the first undo
+void RangeSnapshotAction::redo() {
+    if (!hasAfterSnapshot) {
+        return;
+    }
+    blockWriter(afterSnapshot.getRange(), afterSnapshot.toRowMajor());
+}
+
+size_t RangeSnapshotAction::memoryFootprint() const {
+    size_t bytes = sizeof(RangeSnapshotAction) + beforeSnapshot.memoryFootprint();
+    if (hasAfterSnapshot) {
+        bytes += afterSnapshot.memoryFootprint();
+    }
+    return bytes;
+}
+
+// The before snapshot, then the after snapshot once the first undo has captured it
+bool RangeSnapshotAction::serialize(std::string& out) const {
+    beforeSnapshot.serialize(out);
+    out.push_back(hasAfterSnapshot ? 1 : 0);
+    if (hasAfterSnapshot) {
+        afterSnapshot.serialize(out);
+    }
+    return true;
+}
+
+std::unique_ptr<RangeSnapshotAction> RangeSnapshotAction::deserialize(const std::string& encoded, RangeSnapshot::BlockReader reader,
+                                                                      BlockWriter writer) {
+    size_t pos = 0;
+    auto action = std::make_unique<RangeSnapshotAction>(RangeSnapshot::deserialize(encoded, pos), std::move(reader),
+                                                        std::move(writer));
+    if (pos >= encoded.size()) {
+        throw std::runtime_error("Range snapshot encoding is truncated");
+    }
+    if (encoded[pos++] != 0) {
+        action->afterSnapshot = RangeSnapshot::deserialize(encoded, pos);
+        action->hasAfterSnapshot = true;
+    }
+    if (pos != encoded.size()) {
+        throw std::runtime_error("Range snapshot encoding is malformed");
+    }
+    return action;
+}
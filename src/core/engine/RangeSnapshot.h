@@ -0,0 +1,92 @@
+#ifndef RANGE_SNAPSHOT_H
+#define RANGE_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include "UndoRedoStack.h"
+#include "CellAddress.h"
+
+// Compressed column-major copy of a rectangular block of cell values.
+// Each column stores runs of blank cells plus typed lanes for the populated ones:
+// numbers that round-trip exactly are kept as doubles, everything else as an
+// index into a deduplicated string pool.
+class RangeSnapshot {
+public:
+    // Reads a block's current values row-major into out, as views valid until the next write;
+    // empty means blank
+    using BlockReader = std::function<void(const CellRange& range, std::vector<std::string_view>& out)>;
+
+    // Captures the contents of the given block with one block read
+    static RangeSnapshot capture(const CellRange& range, const BlockReader& reader);
+
+    // Expands the snapshot into row-major values suitable for a single bulk write
+    std::vector<std::string> toRowMajor() const;
+
+    // Returns the captured block
+    const CellRange& getRange() const { return range; }
+
+    // Approximate number of bytes held by the snapshot
+    size_t memoryFootprint() const;
+
+    // Appends a binary encoding of the snapshot, in host byte order, to out
+    void serialize(std::string& out) const;
+
+    // Decodes a snapshot written by serialize starting at pos and advances pos past it.
+    // Throws std::runtime_error if the encoding is malformed.
+    static RangeSnapshot deserialize(const std::string& in, size_t& pos);
+
+private:
+    enum class LaneKind : uint8_t {
+        Number,
+        Text
+    };
+
+    struct BlankRun {
+        uint32_t startRow;   // Offset from the top of the block
+        uint32_t length;
+    };
+
+    struct ColumnLanes {
+        std::vector<BlankRun> blankRuns;
+        std::vector<LaneKind> kinds;       // One per populated cell, in row order
+        std::vector<double> numbers;
+        std::vector<uint32_t> textIds;
+    };
+
+    CellRange range;
+    std::vector<ColumnLanes> columns;
+    std::vector<std::string> stringPool;
+};
+
+// Undo action for bulk range operations (paste, sort, fill, clear).
+// Holds the previous contents of the block as a RangeSnapshot and restores it with
+// one bulk write; the contents being replaced are captured lazily on first undo so redo
+// is equally cheap.
+class RangeSnapshotAction : public Action {
+public:
+    // Writes row-major values into a block and triggers a single recalculation
+    using BlockWriter = std::function<void(const CellRange& range, const std::vector<std::string>& values)>;
+
+    RangeSnapshotAction(RangeSnapshot before, RangeSnapshot::BlockReader reader, BlockWriter writer);
+
+    void undo() override;
+    void redo() override;
+    size_t memoryFootprint() const override;
+    bool serialize(std::string& out) const override;
+
+    // Rebuilds an action from its serialize output around the given reader and writer
+    static std::unique_ptr<RangeSnapshotAction> deserialize(const std::string& encoded, RangeSnapshot::BlockReader reader, BlockWriter writer);
+
+private:
+    RangeSnapshot beforeSnapshot;
+    RangeSnapshot afterSnapshot;
+    bool hasAfterSnapshot;
+    RangeSnapshot::BlockReader blockReader;
+    BlockWriter blockWriter;
+};
+
+#endif // RANGE_SNAPSHOT_H
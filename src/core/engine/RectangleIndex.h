@@ -0,0 +1,245 @@
+#ifndef RECTANGLE_INDEX_H
+#define RECTANGLE_INDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include "CellAddress.h"
+
+// Spatial index of values keyed by cell rectangles.
+// Indexed entries live in a packed R-tree (Sort-Tile-Recursive bulk load) so point and
+// range queries visit O(log n) nodes. New entries go to a small unindexed tail that is
+// scanned linearly and folded into the tree once it grows past a fraction of the total,
+// keeping inserts amortized O(log n). Removing an indexed entry only marks it dead; the
+// tree is rebuilt once dead entries pass a fraction of it, so removals are amortized too.
+// Not thread-safe; callers provide locking.
+template <typename T>
+class RectangleIndex {
+public:
+    RectangleIndex() : indexedCount(0), deadCount(0), pendingRebuild(false) {}
+
+    // Adds a value covering the given rectangle
+    void insert(const CellRange& rect, T value) {
+        entries.push_back(Entry{rect, std::move(value), true});
+        if (entries.size() - indexedCount > std::max<size_t>(kMinPending, indexedCount / 8)) {
+            rebuild();
+        }
+    }
+
+    // Removes every entry for which pred(rect, value) returns true; returns the number removed.
+    // Visits every entry; prefer removeIntersecting when the candidates share a region.
+    template <typename Pred>
+    size_t removeIf(Pred pred) {
+        size_t removed = 0;
+        for (size_t i = 0; i < indexedCount; ++i) {
+            if (entries[i].live && pred(entries[i].rect, entries[i].value)) {
+                markDead(i);
+                ++removed;
+            }
+        }
+        return removed + removeFromTail(pred);
+    }
+
+    // Removes every entry intersecting range for which pred(rect, value) returns true;
+    // returns the number removed. Only visits the tree nodes that overlap range.
+    template <typename Pred>
+    size_t removeIntersecting(const CellRange& range, Pred pred) {
+        size_t removed = 0;
+        forEachIndexedIntersecting(range, [&](size_t i) {
+            if (pred(entries[i].rect, entries[i].value)) {
+                markDead(i);
+                ++removed;
+            }
+        });
+        return removed + removeFromTail([&](const CellRange& rect, const T& value) {
+            return rect.intersects(range) && pred(rect, value);
+        });
+    }
+
+    // Calls visit(rect, value) for every entry whose rectangle contains the cell
+    template <typename Visitor>
+    void forEachContaining(const CellAddress& cell, Visitor visit) const {
+        forEachIntersecting(CellRange{cell, cell}, visit);
+    }
+
+    // Calls visit(rect, value) for every entry whose rectangle intersects the range
+    template <typename Visitor>
+    void forEachIntersecting(const CellRange& range, Visitor visit) const {
+        forEachIndexedIntersecting(range, [&](size_t i) { visit(entries[i].rect, entries[i].value); });
+
+        for (size_t i = indexedCount; i < entries.size(); ++i) {
+            if (entries[i].rect.intersects(range)) {
+                visit(entries[i].rect, entries[i].value);
+            }
+        }
+    }
+
+    // Calls visit(rect, value) for every entry
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        for (const auto& entry : entries) {
+            if (entry.live) {
+                visit(entry.rect, entry.value);
+            }
+        }
+    }
+
+    size_t size() const { return entries.size() - deadCount; }
+    bool empty() const { return size() == 0; }
+
+    void clear() {
+        entries.clear();
+        nodes.clear();
+        indexedCount = 0;
+        deadCount = 0;
+    }
+
+private:
+    static constexpr size_t kFanout = 16;
+    static constexpr size_t kMinPending = 32;
+
+    struct Entry {
+        CellRange rect;
+        T value;
+        // False once removed from the tree; dead entries are dropped at the next rebuild
+        bool live;
+    };
+
+    // Leaf nodes span entries[first, first + count); internal nodes span nodes[first, first + count)
+    struct Node {
+        CellRange bounds;
+        uint32_t first;
+        uint32_t count;
+        bool leaf;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<Node> nodes;
+    size_t indexedCount;
+    size_t deadCount;
+    // Set once dead entries pass the threshold; the removal in progress then rebuilds
+    bool pendingRebuild;
+
+    // Calls visit(index) for every live indexed entry intersecting range
+    template <typename Visitor>
+    void forEachIndexedIntersecting(const CellRange& range, Visitor visit) const {
+        if (nodes.empty()) {
+            return;
+        }
+        std::vector<uint32_t> pending{static_cast<uint32_t>(nodes.size() - 1)};
+        while (!pending.empty()) {
+            const Node& node = nodes[pending.back()];
+            pending.pop_back();
+            if (!node.bounds.intersects(range)) {
+                continue;
+            }
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                if (node.leaf) {
+                    if (entries[i].live && entries[i].rect.intersects(range)) {
+                        visit(i);
+                    }
+                } else {
+                    pending.push_back(i);
+                }
+            }
+        }
+    }
+
+    // Marks an indexed entry dead and rebuilds once too much of the tree is dead. Leaves are
+    // only repacked by rebuild, so node bounds stay valid, if loose, until then.
+    void markDead(size_t i) {
+        entries[i].live = false;
+        ++deadCount;
+        if (deadCount > std::max<size_t>(kMinPending, indexedCount / 4)) {
+            pendingRebuild = true;
+        }
+    }
+
+    // Unindexed entries are simply erased; then any rebuild a kill asked for is done
+    template <typename Pred>
+    size_t removeFromTail(Pred&& pred) {
+        size_t tailEnd = entries.size();
+        size_t kept = indexedCount;
+        for (size_t i = indexedCount; i < tailEnd; ++i) {
+            if (pred(entries[i].rect, entries[i].value)) {
+                continue;
+            }
+            if (kept != i) {
+                entries[kept] = std::move(entries[i]);
+            }
+            ++kept;
+        }
+        entries.erase(entries.begin() + static_cast<std::ptrdiff_t>(kept), entries.end());
+        if (pendingRebuild) {
+            rebuild();
+        }
+        return tailEnd - kept;
+    }
+
+    static uint64_t centerRow(const CellRange& r) { return static_cast<uint64_t>(r.first.row) + r.last.row; }
+    static uint64_t centerColumn(const CellRange& r) { return static_cast<uint64_t>(r.first.column) + r.last.column; }
+
+    static CellRange merge(const CellRange& a, const CellRange& b) {
+        return CellRange{
+            CellAddress{std::min(a.first.row, b.first.row), std::min(a.first.column, b.first.column)},
+            CellAddress{std::max(a.last.row, b.last.row), std::max(a.last.column, b.last.column)}};
+    }
+
+    // Bulk-load every entry into a fresh packed tree
+    void rebuild() {
+        if (deadCount > 0) {
+            entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry) { return !entry.live; }),
+                          entries.end());
+            deadCount = 0;
+        }
+        pendingRebuild = false;
+        nodes.clear();
+        indexedCount = entries.size();
+        if (entries.empty()) {
+            return;
+        }
+
+        // Sort-Tile-Recursive: slice by column centre, then sort each slice by row centre
+        size_t leafCount = (entries.size() + kFanout - 1) / kFanout;
+        size_t sliceCount = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(leafCount))));
+        size_t sliceSize = sliceCount * kFanout;
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return centerColumn(a.rect) < centerColumn(b.rect);
+        });
+        for (size_t start = 0; start < entries.size(); start += sliceSize) {
+            auto sliceEnd = entries.begin() + static_cast<std::ptrdiff_t>(std::min(entries.size(), start + sliceSize));
+            std::sort(entries.begin() + static_cast<std::ptrdiff_t>(start), sliceEnd, [](const Entry& a, const Entry& b) {
+                return centerRow(a.rect) < centerRow(b.rect);
+            });
+        }
+
+        // Pack leaves
+        for (size_t start = 0; start < entries.size(); start += kFanout) {
+            Node leaf{entries[start].rect, static_cast<uint32_t>(start),
+                      static_cast<uint32_t>(std::min(kFanout, entries.size() - start)), true};
+            for (size_t i = start + 1; i < start + leaf.count; ++i) {
+                leaf.bounds = merge(leaf.bounds, entries[i].rect);
+            }
+            nodes.push_back(leaf);
+        }
+
+        // Pack upper levels until a single root remains; the root is the last node
+        size_t levelStart = 0;
+        size_t levelEnd = nodes.size();
+        while (levelEnd - levelStart > 1) {
+            for (size_t start = levelStart; start < levelEnd; start += kFanout) {
+                Node parent{nodes[start].bounds, static_cast<uint32_t>(start),
+                            static_cast<uint32_t>(std::min(kFanout, levelEnd - start)), false};
+                for (size_t i = start + 1; i < start + parent.count; ++i) {
+                    parent.bounds = merge(parent.bounds, nodes[i].bounds);
+                }
+                nodes.push_back(parent);
+            }
+            levelStart = levelEnd;
+            levelEnd = nodes.size();
+        }
+    }
+};
+
+#endif // RECTANGLE_INDEX_H
@@ -6,10 +6,16 @@
 #include "UndoRedoStack.h"
 #include "DataValidation.h"
 #include "FormattingEngine.h"
+#include "RangeSnapshot.h"
+#include "CellAddress.h"
 #include <stdexcept>
 #include <algorithm>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
+#include <fstream>
+#include <cstdint>
+#include <iterator>
 
 SpreadsheetEngine::SpreadsheetEngine()
     : cellManager(nullptr),
@@ -18,42 +24,81 @@ SpreadsheetEngine::SpreadsheetEngine()
       memoryManager(nullptr),
       undoRedoStack(nullptr),
       dataValidation(nullptr),
-      formattingEngine(nullptr) {
+      formattingEngine(nullptr),
+      stopWriter(false) {
     
     // Create instances of all required components
-    cellManager = new CellManager();
-    formulaParser = new FormulaParser();
-    calculationEngine = new CalculationEngine();
-    memoryManager = new MemoryManager();
-    undoRedoStack = new UndoRedoStack();
-    dataValidation = new DataValidation();
-    formattingEngine = new FormattingEngine();
+    cellManager = std::make_unique<CellManager>();
+    formulaParser = std::make_unique<FormulaParser>();
+    calculationEngine = std::make_unique<CalculationEngine>(formulaParser.get(), cellManager.get());
+    memoryManager = std::make_unique<MemoryManager>(kMemoryPoolSize);
+    undoRedoStack = std::make_unique<UndoRedoStack>();
+    dataValidation = std::make_unique<DataValidation>();
+    formattingEngine = std::make_unique<FormattingEngine>();
+    changeFeed = std::make_unique<ChangeFeed>();
 
-    // Set up any necessary connections between components
-    calculationEngine->setFormulaParser(formulaParser);
-    calculationEngine->setCellManager(cellManager);
+    // CUSTOM validation rules are compiled by the engine's parser
+    dataValidation->setFormulaParser(formulaParser.get());
+
+    // Every value write, including recalculated results, is recorded for subscribers
+    cellManager->setChangeFeed(changeFeed.get());
+
+    // Undo/redo of plain cell edits writes the recorded value back and recalculates
+    undoRedoStack->setDeltaApplier([this](const std::string& cellReference, const std::string& value) {
+        cellManager->setCellValue(cellReference, value);
+        calculationEngine->recalculate(cellReference);
+    });
+
+    // Range edits spilled to the undo journal are rebuilt around this engine's cells
+    undoRedoStack->setActionLoader([this](const std::string& encoded) -> std::unique_ptr<Action> {
+        return RangeSnapshotAction::deserialize(encoded, rangeBlockReader(), rangeBlockWriter());
+    });
+
+    // Start the single writer once every component exists
+    writerThread = std::thread(&SpreadsheetEngine::writerLoop, this);
+}
+
+SpreadsheetEngine::~SpreadsheetEngine() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopWriter = true;
+    }
+    queueCondition.notify_one();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
 }
 
 void SpreadsheetEngine::setCellValue(const std::string& cellReference, const std::string& value) {
-    std::lock_guard<std::mutex> lock(engineMutex);
+    runWrite([this, cellReference, value]() { applyCellValue(cellReference, value); });
+}
+
+std::future<void> SpreadsheetEngine::submitCellValue(const std::string& cellReference, const std::string& value) {
+    return enqueueWrite([this, cellReference, value]() { applyCellValue(cellReference, value); });
+}
 
+void SpreadsheetEngine::applyCellValue(const std::string& cellReference, const std::string& value) {
     try {
+        // Capture the previous value for the undo log
+        std::string oldValue = cellManager->getCellValue(cellReference);
+
         // Call CellManager to set the cell value
         cellManager->setCellValue(cellReference, value);
 
         // Trigger CalculationEngine to recalculate dependent cells
         calculationEngine->recalculate(cellReference);
 
-        // Push the action to UndoRedoStack
-        undoRedoStack->pushAction(cellReference, value);
+        // Record a compact delta in the UndoRedoStack
+        undoRedoStack->pushDelta(cellReference, oldValue, value);
     } catch (const std::exception& e) {
         // Handle any exceptions (e.g., invalid cell reference)
         throw std::runtime_error("Error setting cell value: " + std::string(e.what()));
     }
 }
 
-std::string SpreadsheetEngine::getCellValue(const std::string& cellReference) {
-    std::lock_guard<std::mutex> lock(engineMutex);
+std::string SpreadsheetEngine::getCellValue(const std::string& cellReference) const {
+    // Shared lock: readers proceed in parallel and only wait for an in-flight write batch
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
 
     try {
         // Call CellManager to get the cell value
@@ -64,17 +109,275 @@ std::string SpreadsheetEngine::getCellValue(const std::string& cellReference) {
     }
 }
 
-void SpreadsheetEngine::recalculateAll() {
-    std::lock_guard<std::mutex> lock(engineMutex);
+RangeView SpreadsheetEngine::getRange(const std::string& cellRange) const {
+    CellRange range = parseCellRange(cellRange);
+
+    // The shared lock is held only while pinning, so the view sees a whole committed batch
+    RangeView view(range);
+    {
+        std::shared_lock<std::shared_mutex> lock(engineMutex);
+        cellManager->pinBlock(range, view.pinned);
+    }
+    view.cells.resize(view.pinned.size());
+    for (size_t i = 0; i < view.pinned.size(); ++i) {
+        if (view.pinned[i]) {
+            view.cells[i] = *view.pinned[i];
+        }
+    }
+    return view;
+}
+
+void SpreadsheetEngine::getRangeValues(const std::string& cellRange, std::vector<std::string>& out) const {
+    CellRange range = parseCellRange(cellRange);
+    std::vector<std::string_view> views;
+
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    cellManager->readBlock(range, views);
+
+    out.resize(views.size());
+    for (size_t i = 0; i < views.size(); ++i) {
+        out[i].assign(views[i].data(), views[i].size());
+    }
+}
+
+void SpreadsheetEngine::setRangeValues(const std::string& cellRange, const std::vector<std::string>& values) {
+    runWrite([this, &cellRange, &values]() { applyRangeValues(cellRange, values); });
+}
 
+void SpreadsheetEngine::applyRangeValues(const std::string& cellRange, const std::vector<std::string>& values) {
+    try {
+        CellRange range = parseCellRange(cellRange);
+        if (values.size() != range.cellCount()) {
+            throw std::invalid_argument("Value count does not match range size");
+        }
+
+        // Capture the previous contents as a columnar snapshot instead of one action per cell
+        RangeSnapshot::BlockReader reader = rangeBlockReader();
+        RangeSnapshot before = RangeSnapshot::capture(range, reader);
+
+        writeBlock(range, values);
+
+        undoRedoStack->pushAction(std::make_unique<RangeSnapshotAction>(std::move(before), std::move(reader), rangeBlockWriter()));
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Error setting range values: " + std::string(e.what()));
+    }
+}
+
+RangeSnapshot::BlockReader SpreadsheetEngine::rangeBlockReader() {
+    return [this](const CellRange& target, std::vector<std::string_view>& out) { cellManager->readBlock(target, out); };
+}
+
+RangeSnapshotAction::BlockWriter SpreadsheetEngine::rangeBlockWriter() {
+    return [this](const CellRange& target, const std::vector<std::string>& blockValues) { writeBlock(target, blockValues); };
+}
+
+void SpreadsheetEngine::writeBlock(const CellRange& range, const std::vector<std::string>& values) {
+    // One bulk write, then only the cells it can affect
+    cellManager->setCellBlock(range, values);
+    calculationEngine->recalculateRange(range);
+}
+
+void SpreadsheetEngine::recalculateAll() {
     // Call CalculationEngine to recalculate all cells
-    calculationEngine->recalculateAll();
+    runWrite([this]() { calculationEngine->recalculateAll(); });
+}
+
+void SpreadsheetEngine::buildDependencyGraph() {
+    runWrite([this]() { calculationEngine->buildDependencyGraph(); });
+}
+
+bool SpreadsheetEngine::undo() {
+    bool undone = false;
+    runWrite([this, &undone]() { undone = undoRedoStack->undo(); });
+    return undone;
+}
+
+bool SpreadsheetEngine::redo() {
+    bool redone = false;
+    runWrite([this, &redone]() { redone = undoRedoStack->redo(); });
+    return redone;
+}
+
+void SpreadsheetEngine::enableUndoJournal(const std::string& filePath) {
+    runWrite([this, &filePath]() { undoRedoStack->enableJournal(filePath); });
+}
+
+// State file: magic, cell count, then (reference, value) pairs as length-prefixed strings
+namespace {
+
+constexpr uint32_t kStateMagic = 0x53455331; // "SES1"
+
+void writeUint32(std::ofstream& out, uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeString(std::ofstream& out, const std::string& value) {
+    writeUint32(out, static_cast<uint32_t>(value.size()));
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+uint32_t readUint32(std::ifstream& in) {
+    uint32_t value = 0;
+    if (!in.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+        throw std::runtime_error("Engine state file is truncated");
+    }
+    return value;
+}
+
+std::string readString(std::ifstream& in) {
+    std::string value(readUint32(in), '\0');
+    if (!in.read(&value[0], static_cast<std::streamsize>(value.size()))) {
+        throw std::runtime_error("Engine state file is truncated");
+    }
+    return value;
+}
+
+} // namespace
+
+void SpreadsheetEngine::saveState(const std::string& filePath) const {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+
+    std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot open engine state file: " + filePath);
+    }
+
+    std::vector<std::string> references = cellManager->getAllCellReferences();
+    writeUint32(out, kStateMagic);
+    writeUint32(out, static_cast<uint32_t>(references.size()));
+    for (const auto& reference : references) {
+        writeString(out, reference);
+        writeString(out, cellManager->getCellValue(reference));
+    }
+    if (!out.flush()) {
+        throw std::runtime_error("Failed to write engine state file: " + filePath);
+    }
+}
+
+void SpreadsheetEngine::loadState(const std::string& filePath) {
+    // Parse the whole file first so a bad file leaves the current contents untouched
+    std::ifstream in(filePath, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open engine state file: " + filePath);
+    }
+    if (readUint32(in) != kStateMagic) {
+        throw std::runtime_error("Not an engine state file: " + filePath);
+    }
+    std::vector<std::pair<std::string, std::string>> state(readUint32(in));
+    for (auto& entry : state) {
+        entry.first = readString(in);
+        entry.second = readString(in);
+    }
+
+    runWrite([this, &state]() {
+        // Loading is not an undoable edit
+        replaceCells(state);
+        calculationEngine->buildDependencyGraph();
+        calculationEngine->recalculateAll();
+    });
+}
+
+void SpreadsheetEngine::importCells(const std::vector<std::pair<std::string, std::string>>& cells) {
+    runWrite([this, &cells]() { replaceCells(cells); });
+}
+
+void SpreadsheetEngine::replaceCells(const std::vector<std::pair<std::string, std::string>>& cells) {
+    cellManager->clear();
+    for (const auto& entry : cells) {
+        cellManager->setCellValue(entry.first, entry.second);
+    }
+    undoRedoStack->clear();
+}
+
+size_t SpreadsheetEngine::getMemoryUsage() const {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return cellManager->getMemoryUsage() + undoRedoStack->getMemoryUsage();
+}
+
+bool SpreadsheetEngine::hasNonCellState() const {
+    std::shared_lock<std::shared_mutex> lock(engineMutex);
+    return undoRedoStack->hasJournal() ||
+           changeFeed->getSubscriptionCount() > 0 || formattingEngine->getLayerCount() > 0 ||
+           dataValidation->getRuleCount() > 0;
+}
+
+size_t SpreadsheetEngine::subscribeRange(const std::string& cellRange, ChangeFeed::ChangeHandler handler) {
+    return changeFeed->subscribe(parseCellRange(cellRange), std::move(handler));
+}
+
+void SpreadsheetEngine::moveSubscription(size_t subscriptionId, const std::string& cellRange) {
+    changeFeed->updateSubscription(subscriptionId, parseCellRange(cellRange));
+}
+
+void SpreadsheetEngine::unsubscribe(size_t subscriptionId) {
+    changeFeed->unsubscribe(subscriptionId);
+}
+
+std::future<void> SpreadsheetEngine::enqueueWrite(std::function<void()> write) {
+    PendingWrite pending{std::move(write), std::promise<void>()};
+    std::future<void> result = pending.done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (stopWriter) {
+            throw std::runtime_error("SpreadsheetEngine is shutting down");
+        }
+        writeQueue.push_back(std::move(pending));
+    }
+    queueCondition.notify_one();
+    return result;
+}
+
+void SpreadsheetEngine::runWrite(std::function<void()> write) {
+    // Change handlers run on the writer thread, which would wait here on itself forever
+    if (std::this_thread::get_id() == writerThread.get_id()) {
+        throw std::logic_error("Engine writes cannot wait from a change handler; use submitCellValue");
+    }
+    // get() rethrows any exception raised while applying the write
+    enqueueWrite(std::move(write)).get();
+}
+
+void SpreadsheetEngine::writerLoop() {
+    while (true) {
+        std::deque<PendingWrite> batch;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopWriter || !writeQueue.empty(); });
+            if (writeQueue.empty()) {
+                return; // Stopping and fully drained
+            }
+            if (writeQueue.size() <= kMaxWritesPerBatch) {
+                batch.swap(writeQueue);
+            } else {
+                auto end = writeQueue.begin() + kMaxWritesPerBatch;
+                std::move(writeQueue.begin(), end, std::back_inserter(batch));
+                writeQueue.erase(writeQueue.begin(), end);
+            }
+        }
+
+        // Readers wait for at most one capped batch; the rest of the queue is taken next round
+        {
+            std::unique_lock<std::shared_mutex> lock(engineMutex);
+            for (auto& pending : batch) {
+                try {
+                    pending.apply();
+                    pending.done.set_value();
+                } catch (...) {
+                    pending.done.set_exception(std::current_exception());
+                }
+            }
+        }
+
+        // Deliver the batch's coalesced changes once the lock is released so handlers can read
+        try {
+            changeFeed->publish();
+        } catch (...) {
+            // A failing subscriber must not stop the writer thread
+        }
+    }
 }
 
 // Human tasks:
 // TODO: Implement proper error handling for invalid cell references
-// TODO: Optimize locking mechanism to reduce contention
-// TODO: Implement batch update functionality for setting multiple cell values efficiently
 // TODO: Implement caching mechanism for frequently accessed cell values
 // TODO: Add support for retrieving formatted cell values
 // TODO: Implement progress reporting for long-running recalculations
@@ -2,8 +2,18 @@
 #define SPREADSHEET_ENGINE_H
 
 #include <string>
+#include <string_view>
+#include <vector>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <thread>
+#include "ChangeFeed.h"
+#include "CellAddress.h"
 
 // Forward declarations
 class CellManager;
@@ -13,16 +23,48 @@ class MemoryManager;
 class UndoRedoStack;
 class DataValidation;
 class FormattingEngine;
+struct CellRange;
 struct FormatOptions;
 struct ValidationRule;
 
+// Read-only view of a block of cells as of one committed write batch. It pins the cells'
+// shared, immutable text rather than holding a lock, so values are views without per-cell
+// copies, later writes proceed and never show through, and views may be kept for as long
+// as needed.
+class RangeView {
+public:
+    const CellRange& getRange() const { return range; }
+    uint32_t rowCount() const { return range.rowCount(); }
+    uint32_t columnCount() const { return range.columnCount(); }
+
+    // Value at a position relative to the range's top-left corner; blank cells are empty
+    std::string_view at(uint32_t row, uint32_t column) const {
+        return cells[static_cast<size_t>(row) * range.columnCount() + column];
+    }
+
+    // Every value, row-major
+    const std::vector<std::string_view>& values() const { return cells; }
+
+private:
+    friend class SpreadsheetEngine;
+
+    explicit RangeView(const CellRange& viewRange) : range(viewRange) {}
+
+    CellRange range;
+    std::vector<std::shared_ptr<const std::string>> pinned;
+    std::vector<std::string_view> cells;
+};
+
+// Coordinates the engine components. Reads take a shared lock and run in parallel;
+// every mutation goes through a single writer thread that drains a queue and applies
+// queued writes in batches under one exclusive lock.
 class SpreadsheetEngine {
 public:
     // Constructor
     SpreadsheetEngine();
 
-    // Destructor
-    ~SpreadsheetEngine() = default;
+    // Destructor: drains pending writes and stops the writer thread
+    ~SpreadsheetEngine();
 
     // Disable copy constructor and assignment operator
     SpreadsheetEngine(const SpreadsheetEngine&) = delete;
@@ -35,6 +77,14 @@ public:
      */
     void setCellValue(const std::string& cellReference, const std::string& value);
 
+    /**
+     * @brief Queues a cell update without waiting for it to be applied
+     * @param cellReference The reference of the cell to update
+     * @param value The new value to set
+     * @return A future that becomes ready (or holds the error) once the write is applied
+     */
+    std::future<void> submitCellValue(const std::string& cellReference, const std::string& value);
+
     /**
      * @brief Retrieves the value of a cell
      * @param cellReference The reference of the cell to retrieve
@@ -42,11 +92,38 @@ public:
      */
     std::string getCellValue(const std::string& cellReference) const;
 
+    /**
+     * @brief Reads a block of cells with one lock acquisition and no per-cell copies
+     * @param cellRange The range to read, e.g. a 200x50 viewport "A1:AX200"
+     * @return A view of the values at the last committed batch; it does not block writers
+     */
+    RangeView getRange(const std::string& cellRange) const;
+
+    /**
+     * @brief Copies a block of cells into a caller-owned buffer with one lock acquisition
+     * @param cellRange The range to read
+     * @param out Receives row-major values; existing string capacity is reused
+     */
+    void getRangeValues(const std::string& cellRange, std::vector<std::string>& out) const;
+
+    /**
+     * @brief Writes a block of values (paste, fill, clear) as a single undoable operation
+     * @param cellRange The target range, e.g. "A1:C100"
+     * @param values Row-major values for every cell in the range; empty strings clear cells
+     */
+    void setRangeValues(const std::string& cellRange, const std::vector<std::string>& values);
+
     /**
      * @brief Triggers a full recalculation of the spreadsheet
      */
     void recalculateAll();
 
+    /**
+     * @brief Rebuilds the formula dependency graph from every cell, so recalculateAll evaluates
+     *        precedents first and later edits recalculate their dependents
+     */
+    void buildDependencyGraph();
+
     /**
      * @brief Undoes the last action
      * @return True if undo was successful, false otherwise
@@ -59,6 +136,64 @@ public:
      */
     bool redo();
 
+    /**
+     * @brief Spills undo and redo history beyond the in-memory limits to journal files
+     * @param filePath Path of the undo journal; redo history goes to filePath + ".redo".
+     *        Both are truncated when opened and removed on exit
+     */
+    void enableUndoJournal(const std::string& filePath);
+
+    /**
+     * @brief Writes the cell contents to a file so the engine can be dropped and restored later
+     * @param filePath Destination file; it is overwritten
+     */
+    void saveState(const std::string& filePath) const;
+
+    /**
+     * @brief Replaces the cell contents with a file written by saveState and recalculates
+     * @param filePath Source file
+     */
+    void loadState(const std::string& filePath);
+
+    /**
+     * @brief Replaces the cell contents in bulk without recalculating or recording undo
+     * @param cells (reference, value) pairs, e.g. from a workbook file; call buildDependencyGraph
+     *        and recalculateAll after
+     */
+    void importCells(const std::vector<std::pair<std::string, std::string>>& cells);
+
+    /**
+     * @brief Returns an estimate of the memory held by cells and undo history
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * @brief Tells whether the engine holds anything saveState does not write besides in-memory
+     *        undo and redo history: an undo journal, range subscriptions, formats or validation rules
+     */
+    bool hasNonCellState() const;
+
+    /**
+     * @brief Subscribes to value changes inside a range
+     * @param cellRange The watched range, e.g. "A1:Z50" or "C:C"
+     * @param handler Receives one coalesced batch per write batch, on the writer thread after
+     *        the batch is committed; it may read the engine and queue writes with
+     *        submitCellValue, but blocking writes (setCellValue, undo, ...) throw
+     *        std::logic_error there and waiting on a submitted write's future deadlocks
+     * @return A subscription ID for moveSubscription and unsubscribe
+     */
+    size_t subscribeRange(const std::string& cellRange, ChangeFeed::ChangeHandler handler);
+
+    /**
+     * @brief Moves a subscription to a new range, e.g. when a viewport scrolls
+     */
+    void moveSubscription(size_t subscriptionId, const std::string& cellRange);
+
+    /**
+     * @brief Removes a range subscription
+     */
+    void unsubscribe(size_t subscriptionId);
+
     /**
      * @brief Applies formatting to a cell or range of cells
      * @param cellRange The cell or range of cells to format
@@ -75,6 +210,11 @@ public:
     bool validateData(const std::string& cellRange, const ValidationRule& rule);
 
 private:
+    static constexpr size_t kMemoryPoolSize = 64 * 1024 * 1024;
+    // Most queued writes applied under one exclusive acquisition, so a deep queue cannot
+    // hold readers off for longer than this many writes
+    static constexpr size_t kMaxWritesPerBatch = 64;
+
     std::unique_ptr<CellManager> cellManager;
     std::unique_ptr<FormulaParser> formulaParser;
     std::unique_ptr<CalculationEngine> calculationEngine;
@@ -82,15 +222,53 @@ private:
     std::unique_ptr<UndoRedoStack> undoRedoStack;
     std::unique_ptr<DataValidation> dataValidation;
     std::unique_ptr<FormattingEngine> formattingEngine;
-    mutable std::mutex engineMutex;
+    std::unique_ptr<ChangeFeed> changeFeed;
+    mutable std::shared_mutex engineMutex;
+
+    // Single-writer queue
+    struct PendingWrite {
+        std::function<void()> apply;
+        std::promise<void> done;
+    };
+    std::deque<PendingWrite> writeQueue;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopWriter;
+    std::thread writerThread;
+
+    // Queues a mutation for the writer thread
+    std::future<void> enqueueWrite(std::function<void()> write);
+
+    // Queues a mutation and waits for it, rethrowing any error. Throws std::logic_error on
+    // the writer thread, where waiting could never finish.
+    void runWrite(std::function<void()> write);
+
+    // Writer thread body: applies queued writes in batches of at most kMaxWritesPerBatch,
+    // each under one exclusive acquisition
+    void writerLoop();
+
+    // Applies a single cell update. Caller must hold engineMutex exclusively.
+    void applyCellValue(const std::string& cellReference, const std::string& value);
+
+    // Applies a bulk range write with snapshot undo. Caller must hold engineMutex exclusively.
+    void applyRangeValues(const std::string& cellRange, const std::vector<std::string>& values);
+
+    // Replaces all cells and drops undo history. Caller must hold engineMutex exclusively.
+    void replaceCells(const std::vector<std::pair<std::string, std::string>>& cells);
+
+    // Writes a row-major block through CellManager and recalculates the block's formulas and
+    // their dependents
+    void writeBlock(const CellRange& range, const std::vector<std::string>& values);
+
+    // Block reader and block writer for range undo actions, including ones rebuilt from the
+    // undo journal
+    std::function<void(const CellRange& range, std::vector<std::string_view>& out)> rangeBlockReader();
+    std::function<void(const CellRange& range, const std::vector<std::string>& values)> rangeBlockWriter();
 };
 
 // Human tasks:
 // TODO: Implement proper error handling mechanisms for all public methods
 // TODO: Add documentation comments for all public methods and class members
-// TODO: Consider adding a method for batch operations to improve performance for multiple cell updates
-// TODO: Implement a mechanism for registering callbacks or observers for cell value changes
-// TODO: Add methods for saving and loading spreadsheet state
 // TODO: Consider implementing a thread-safe singleton pattern for global access to the SpreadsheetEngine instance
 
 #endif // SPREADSHEET_ENGINE_H
\ No newline at end of file
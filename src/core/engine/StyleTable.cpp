@@ -0,0 +1,68 @@
+#include "StyleTable.h"
+#include <functional>
+#include <stdexcept>
+#include <limits>
+
+namespace {
+
+void hashCombine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+size_t hashColor(const Color& color) {
+    return (static_cast<size_t>(color.r) << 24) | (static_cast<size_t>(color.g) << 16) |
+           (static_cast<size_t>(color.b) << 8) | static_cast<size_t>(color.a);
+}
+
+} // namespace
+
+// Constructor: style 0 is the default format
+StyleTable::StyleTable() {
+    styles.emplace_back();
+    styleIds.emplace(styles.back(), kDefaultStyleId);
+}
+
+// Intern a format, returning the ID of an existing equal format where possible
+StyleId StyleTable::intern(const CellFormat& format) {
+    std::lock_guard<std::mutex> lock(styleMutex);
+
+    auto it = styleIds.find(format);
+    if (it != styleIds.end()) {
+        return it->second;
+    }
+
+    if (styles.size() >= std::numeric_limits<StyleId>::max()) {
+        throw std::length_error("Style table is full");
+    }
+
+    StyleId id = static_cast<StyleId>(styles.size());
+    styles.push_back(format);
+    styleIds.emplace(format, id);
+    return id;
+}
+
+// Look up a format by ID
+const CellFormat& StyleTable::getStyle(StyleId id) const {
+    std::lock_guard<std::mutex> lock(styleMutex);
+    if (id >= styles.size()) {
+        throw std::out_of_range("Unknown style ID: " + std::to_string(id));
+    }
+    return styles[id];
+}
+
+size_t StyleTable::size() const {
+    std::lock_guard<std::mutex> lock(styleMutex);
+    return styles.size();
+}
+
+size_t StyleTable::FormatHash::operator()(const CellFormat& format) const {
+    size_t seed = std::hash<std::string>()(format.fontName);
+    hashCombine(seed, std::hash<double>()(format.fontSize));
+    hashCombine(seed, (format.isBold ? 1u : 0u) | (format.isItalic ? 2u : 0u) | (format.isUnderlined ? 4u : 0u));
+    hashCombine(seed, hashColor(format.textColor));
+    hashCombine(seed, hashColor(format.backgroundColor));
+    hashCombine(seed, static_cast<size_t>(format.horizontalAlignment));
+    hashCombine(seed, static_cast<size_t>(format.verticalAlignment));
+    hashCombine(seed, std::hash<std::string>()(format.numberFormat));
+    return seed;
+}
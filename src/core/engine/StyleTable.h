@@ -0,0 +1,42 @@
+#ifndef STYLE_TABLE_H
+#define STYLE_TABLE_H
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include "FormattingEngine.h"
+
+// Workbook-wide table of distinct cell formats (flyweight pattern).
+// Each distinct CellFormat is stored once and referred to by a 32-bit StyleId, so cells
+// carry only the ID, equality is an integer compare and lookup is an array index.
+// Styles are never removed, so references returned by getStyle stay valid.
+class StyleTable {
+public:
+    // Initializes the table with the default format as style 0
+    StyleTable();
+
+    StyleTable(const StyleTable&) = delete;
+    StyleTable& operator=(const StyleTable&) = delete;
+
+    // Returns the ID of an equal format, adding it to the table if it is new
+    StyleId intern(const CellFormat& format);
+
+    // Returns the format for an ID; throws std::out_of_range for unknown IDs
+    const CellFormat& getStyle(StyleId id) const;
+
+    // Returns the number of distinct styles
+    size_t size() const;
+
+private:
+    struct FormatHash {
+        size_t operator()(const CellFormat& format) const;
+    };
+
+    // deque keeps element addresses stable as styles are appended
+    std::deque<CellFormat> styles;
+    std::unordered_map<CellFormat, StyleId, FormatHash> styleIds;
+    mutable std::mutex styleMutex;
+};
+
+#endif // STYLE_TABLE_H
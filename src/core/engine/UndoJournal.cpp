@@ -0,0 +1,149 @@
+#include "UndoJournal.h"
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+void appendUint32(std::string& buffer, uint32_t value) {
+    char bytes[sizeof(uint32_t)];
+    std::memcpy(bytes, &value, sizeof(value));
+    buffer.append(bytes, sizeof(bytes));
+}
+
+void appendString(std::string& buffer, const std::string& value) {
+    appendUint32(buffer, static_cast<uint32_t>(value.size()));
+    buffer.append(value);
+}
+
+uint32_t readUint32(const std::string& buffer, size_t& pos) {
+    if (pos + sizeof(uint32_t) > buffer.size()) {
+        throw std::runtime_error("Undo journal segment is truncated");
+    }
+    uint32_t value;
+    std::memcpy(&value, buffer.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return value;
+}
+
+std::string readString(const std::string& buffer, size_t& pos) {
+    uint32_t length = readUint32(buffer, pos);
+    if (pos + length > buffer.size()) {
+        throw std::runtime_error("Undo journal segment is truncated");
+    }
+    std::string value = buffer.substr(pos, length);
+    pos += length;
+    return value;
+}
+
+} // namespace
+
+UndoJournal::UndoJournal(const std::string& filePath) {
+    undoFile.path = filePath;
+    redoFile.path = filePath + ".redo";
+    openTruncated(undoFile);
+    openTruncated(redoFile);
+}
+
+UndoJournal::~UndoJournal() {
+    for (StreamFile* stream : {&undoFile, &redoFile}) {
+        stream->file.close();
+        std::remove(stream->path.c_str());
+    }
+}
+
+// Serialize a segment and append it to the end of the stream's file
+void UndoJournal::pushSegment(Stream stream, const std::vector<std::string>& records) {
+    if (records.empty()) {
+        return;
+    }
+
+    std::string buffer;
+    for (const auto& record : records) {
+        appendString(buffer, record);
+    }
+
+    StreamFile& target = fileFor(stream);
+    target.file.seekp(static_cast<std::streamoff>(target.size));
+    target.file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    target.file.flush();
+    if (!target.file) {
+        target.file.clear();
+        throw std::runtime_error("Failed to write undo journal: " + target.path);
+    }
+
+    target.segments.push_back(SegmentIndex{target.size, buffer.size(), static_cast<uint32_t>(records.size())});
+    target.size += buffer.size();
+}
+
+// Read back the newest segment of a stream; it is always the tail of the stream's file
+std::vector<std::string> UndoJournal::popSegment(Stream stream) {
+    StreamFile& source = fileFor(stream);
+    if (source.segments.empty()) {
+        return {};
+    }
+
+    SegmentIndex segment = source.segments.back();
+    source.segments.pop_back();
+    source.size = segment.offset;
+
+    std::string buffer(segment.length, '\0');
+    source.file.seekg(static_cast<std::streamoff>(segment.offset));
+    source.file.read(&buffer[0], static_cast<std::streamsize>(segment.length));
+    if (!source.file) {
+        source.file.clear();
+        throw std::runtime_error("Failed to read undo journal: " + source.path);
+    }
+
+    std::vector<std::string> records;
+    records.reserve(segment.recordCount);
+    size_t pos = 0;
+    for (uint32_t i = 0; i < segment.recordCount; ++i) {
+        records.push_back(readString(buffer, pos));
+    }
+    return records;
+}
+
+bool UndoJournal::hasSegments(Stream stream) const {
+    return !fileFor(stream).segments.empty();
+}
+
+size_t UndoJournal::getRecordCount(Stream stream) const {
+    size_t count = 0;
+    for (const auto& segment : fileFor(stream).segments) {
+        count += segment.recordCount;
+    }
+    return count;
+}
+
+uint64_t UndoJournal::getFileSize(Stream stream) const {
+    return fileFor(stream).size;
+}
+
+void UndoJournal::clear(Stream stream) {
+    StreamFile& target = fileFor(stream);
+    target.segments.clear();
+    target.file.close();
+    openTruncated(target);
+}
+
+void UndoJournal::clearAll() {
+    clear(Stream::Undo);
+    clear(Stream::Redo);
+}
+
+UndoJournal::StreamFile& UndoJournal::fileFor(Stream stream) {
+    return stream == Stream::Undo ? undoFile : redoFile;
+}
+
+const UndoJournal::StreamFile& UndoJournal::fileFor(Stream stream) const {
+    return stream == Stream::Undo ? undoFile : redoFile;
+}
+
+void UndoJournal::openTruncated(StreamFile& stream) {
+    stream.file.open(stream.path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!stream.file) {
+        throw std::runtime_error("Unable to open undo journal: " + stream.path);
+    }
+    stream.size = 0;
+}
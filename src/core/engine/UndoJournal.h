@@ -0,0 +1,72 @@
+#ifndef UNDO_JOURNAL_H
+#define UNDO_JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+// Append-only files of history segments used to spill old undo/redo history to disk.
+// Each stream is a stack of segments kept in its own file, so popping a segment reuses the
+// file's tail and clearing a stream truncates its file: the files never hold more than the
+// segments still reachable. Only a small index of file offsets is kept in memory. Records
+// are opaque byte strings encoded by UndoRedoStack.
+class UndoJournal {
+public:
+    // Opens (and truncates) the undo stream at the given path and the redo stream beside it
+    explicit UndoJournal(const std::string& filePath);
+    ~UndoJournal();
+
+    UndoJournal(const UndoJournal&) = delete;
+    UndoJournal& operator=(const UndoJournal&) = delete;
+
+    // Identifies one of the independent segment stacks
+    enum class Stream {
+        Undo,
+        Redo
+    };
+
+    // Appends a segment of records (oldest first) to the given stream
+    void pushSegment(Stream stream, const std::vector<std::string>& records);
+
+    // Reads back and removes the most recently pushed segment of the given stream
+    std::vector<std::string> popSegment(Stream stream);
+
+    // Checks if the given stream has spilled segments
+    bool hasSegments(Stream stream) const;
+
+    // Number of records spilled to the given stream
+    size_t getRecordCount(Stream stream) const;
+
+    // Bytes the given stream occupies on disk
+    uint64_t getFileSize(Stream stream) const;
+
+    // Drops all segments of one stream and truncates its file
+    void clear(Stream stream);
+
+    // Drops all segments of both streams
+    void clearAll();
+
+private:
+    struct SegmentIndex {
+        uint64_t offset;
+        uint64_t length;
+        uint32_t recordCount;
+    };
+
+    struct StreamFile {
+        std::string path;
+        std::fstream file;
+        uint64_t size = 0;
+        std::vector<SegmentIndex> segments;
+    };
+
+    StreamFile undoFile;
+    StreamFile redoFile;
+
+    StreamFile& fileFor(Stream stream);
+    const StreamFile& fileFor(Stream stream) const;
+    static void openTruncated(StreamFile& stream);
+};
+
+#endif // UNDO_JOURNAL_H
@@ -1,85 +1,513 @@
 #include "UndoRedoStack.h"
+#include "UndoJournal.h"
 #include <stdexcept>
 #include <algorithm>
 #include <mutex>
+#include <cstring>
 
-// Constructor: Initialize the UndoRedoStack with a specified maximum stack size
-UndoRedoStack::UndoRedoStack(size_t maxSize) : maxStackSize(maxSize) {
-    // Undo and redo stacks are initialized as empty vectors by default
+namespace {
+
+// The dead head of an arena is dropped only once it is at least this large
+constexpr size_t kMinArenaCompaction = 4096;
+
+// Journal records start with a tag: a cell delta as three length-prefixed strings, or a
+// custom action as its own encoding
+constexpr char kDeltaRecord = 'D';
+constexpr char kActionRecord = 'A';
+
+void appendString(std::string& buffer, std::string_view value) {
+    uint32_t length = static_cast<uint32_t>(value.size());
+    char bytes[sizeof(length)];
+    std::memcpy(bytes, &length, sizeof(length));
+    buffer.append(bytes, sizeof(bytes));
+    buffer.append(value);
+}
+
+std::string_view readString(const std::string& buffer, size_t& pos) {
+    uint32_t length = 0;
+    if (pos + sizeof(length) > buffer.size()) {
+        throw std::runtime_error("Undo journal record is truncated");
+    }
+    std::memcpy(&length, buffer.data() + pos, sizeof(length));
+    pos += sizeof(length);
+    if (pos + length > buffer.size()) {
+        throw std::runtime_error("Undo journal record is truncated");
+    }
+    std::string_view value(buffer.data() + pos, length);
+    pos += length;
+    return value;
+}
+
+} // namespace
+
+// Constructor: Initialize the UndoRedoStack with a maximum entry count and byte budget
+UndoRedoStack::UndoRedoStack(size_t maxSize, size_t maxBytes)
+    : undoHead(0),
+      undoCount(0),
+      undoBytes(0),
+      redoBytes(0),
+      maxStackSize(std::max<size_t>(maxSize, 1)),
+      maxMemoryBytes(maxBytes),
+      spillSegmentSize(0) {
+    // The ring grows lazily up to maxStackSize slots
+}
+
+UndoRedoStack::~UndoRedoStack() = default;
+
+// Spill trimmed history to an append-only journal instead of discarding it
+void UndoRedoStack::enableJournal(const std::string& filePath, size_t segmentSize) {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    journal = std::make_unique<UndoJournal>(filePath);
+    pendingSpill.clear();
+    // A paged-in segment must fit in the ring without being trimmed again
+    spillSegmentSize = std::max<size_t>(1, std::min(segmentSize, maxStackSize));
+}
+
+// Set the callback that writes CellDelta values back to the spreadsheet
+void UndoRedoStack::setDeltaApplier(DeltaApplier applier) {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    deltaApplier = std::move(applier);
+}
+
+// Set the callback that rebuilds custom actions paged in from the journal
+void UndoRedoStack::setActionLoader(ActionLoader loader) {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    actionLoader = std::move(loader);
 }
 
 // Push a new action onto the undo stack
 void UndoRedoStack::pushAction(std::unique_ptr<Action> action) {
-    std::lock_guard<std::mutex> lock(stackMutex);
-    
-    // Clear the redo stack as a new action invalidates previous redos
-    redoStack.clear();
-    
-    // Push the new action onto the undo stack
-    undoStack.push_back(std::move(action));
-    
-    // If undo stack size exceeds maxStackSize, remove the oldest action
-    if (undoStack.size() > maxStackSize) {
-        undoStack.erase(undoStack.begin());
+    if (!action) {
+        throw std::invalid_argument("Cannot push a null action");
     }
+
+    std::lock_guard<std::mutex> lock(stackMutex);
+    Entry entry;
+    entry.action = std::move(action);
+    entry.offset = undoArena.end();
+    entry.bytes = entrySize(entry);
+    pushEntry(std::move(entry));
+}
+
+// Push a compact cell edit record onto the undo stack
+void UndoRedoStack::pushDelta(const std::string& cellReference, const std::string& oldValue, const std::string& newValue) {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    pushEntry(makeDeltaEntry(undoArena, cellReference, oldValue, newValue));
 }
 
 // Undo the most recent action
 bool UndoRedoStack::undo() {
     std::lock_guard<std::mutex> lock(stackMutex);
-    
-    if (undoStack.empty()) {
+
+    if (undoCount == 0 && !pageInUndo()) {
         return false;
     }
-    
-    // Pop the most recent action from the undo stack
-    std::unique_ptr<Action> action = std::move(undoStack.back());
-    undoStack.pop_back();
-    
-    // Execute the action's undo operation
-    action->undo();
-    
-    // Push the action onto the redo stack
-    redoStack.push_back(std::move(action));
-    
+
+    // Apply first: if it throws, the entry stays on the undo stack
+    Entry& newest = undoRing[(undoHead + undoCount - 1) % undoRing.size()];
+    applyUndo(newest);
+
+    // Move the entry onto the redo stack
+    Entry entry = transfer(newest, undoArena, redoArena);
+    popNewest();
+    redoBytes += entry.bytes;
+    redoStack.push_back(std::move(entry));
+    trimRedo();
+
     return true;
 }
 
 // Redo the most recently undone action
 bool UndoRedoStack::redo() {
     std::lock_guard<std::mutex> lock(stackMutex);
-    
-    if (redoStack.empty()) {
+
+    if (redoStack.empty() && !pageInRedo()) {
         return false;
     }
-    
-    // Pop the most recent action from the redo stack
-    std::unique_ptr<Action> action = std::move(redoStack.back());
+
+    // Apply first: if it throws, the entry stays on the redo stack
+    Entry& newest = redoStack.back();
+    applyRedo(newest);
+
+    // Move the entry back onto the undo ring without discarding the remaining redos
+    Entry entry = transfer(newest, redoArena, undoArena);
+    redoBytes -= newest.bytes;
+    redoArena.releaseBack(newest.offset);
     redoStack.pop_back();
-    
-    // Execute the action's redo operation
-    action->redo();
-    
-    // Push the action onto the undo stack
-    undoStack.push_back(std::move(action));
-    
+    if (redoStack.empty()) {
+        redoArena.clear();
+    }
+    appendUndo(std::move(entry));
+
     return true;
 }
 
 // Clear both undo and redo stacks
 void UndoRedoStack::clear() {
     std::lock_guard<std::mutex> lock(stackMutex);
-    
-    undoStack.clear();
+
+    undoRing.clear();
+    undoHead = 0;
+    undoCount = 0;
+    undoArena.clear();
+    undoBytes = 0;
+    redoStack.clear();
+    redoArena.clear();
+    redoBytes = 0;
+    pendingSpill.clear();
+    if (journal) {
+        journal->clearAll();
+    }
+}
+
+// Check if there are actions that can be undone
+bool UndoRedoStack::canUndo() const {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    return undoCount > 0 || !pendingSpill.empty() || (journal && journal->hasSegments(UndoJournal::Stream::Undo));
+}
+
+// Check if there are actions that can be redone
+bool UndoRedoStack::canRedo() const {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    return !redoStack.empty() || (journal && journal->hasSegments(UndoJournal::Stream::Redo));
+}
+
+// Return the number of entries currently in the undo history
+size_t UndoRedoStack::getUndoCount() const {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    return undoCount;
+}
+
+// Return the approximate number of bytes held by the undo and redo history
+size_t UndoRedoStack::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    return undoBytes + redoBytes;
+}
+
+// Check if history spills to a journal
+bool UndoRedoStack::hasJournal() const {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    return journal != nullptr;
+}
+
+// Return the number of undo entries spilled to the journal
+size_t UndoRedoStack::getSpilledUndoCount() const {
+    std::lock_guard<std::mutex> lock(stackMutex);
+    size_t count = pendingSpill.size();
+    if (journal) {
+        count += journal->getRecordCount(UndoJournal::Stream::Undo);
+    }
+    return count;
+}
+
+// Push a new entry; a new action invalidates previous redos. Caller must hold stackMutex.
+void UndoRedoStack::pushEntry(Entry entry) {
+    clearRedo();
+    appendUndo(std::move(entry));
+}
+
+// Append an entry whose text is already at the end of undoArena to the undo ring, evicting
+// the oldest entries to respect both limits. Caller must hold stackMutex.
+void UndoRedoStack::appendUndo(Entry entry) {
+    if (undoCount == maxStackSize) {
+        evictOldest();
+    }
+
+    if (undoCount == undoRing.size()) {
+        // Grow the ring, first rotating it so the oldest entry sits at slot 0
+        std::rotate(undoRing.begin(), undoRing.begin() + undoHead, undoRing.end());
+        undoHead = 0;
+        undoRing.resize(std::min(maxStackSize, std::max<size_t>(undoRing.size() * 2, 16)));
+    }
+
+    undoBytes += entry.bytes;
+    undoRing[(undoHead + undoCount) % undoRing.size()] = std::move(entry);
+    ++undoCount;
+
+    // Trim by the undo byte budget, always keeping the newest entry
+    while (undoBytes > maxMemoryBytes && undoCount > 1) {
+        evictOldest();
+    }
+}
+
+// Discard all redo entries, including spilled ones. Caller must hold stackMutex.
+void UndoRedoStack::clearRedo() {
     redoStack.clear();
+    redoArena.clear();
+    redoBytes = 0;
+    if (journal) {
+        journal->clear(UndoJournal::Stream::Redo);
+    }
+}
+
+// Drop the oldest undo entry in O(1), spilling it to the journal when enabled.
+// Caller must hold stackMutex.
+void UndoRedoStack::evictOldest() {
+    Entry& oldest = undoRing[undoHead];
+    undoBytes -= oldest.bytes;
+
+    if (journal) {
+        std::string record;
+        if (!encodeRecord(oldest, undoArena, record)) {
+            // An action that cannot be journaled makes anything older unreachable
+            pendingSpill.clear();
+            journal->clear(UndoJournal::Stream::Undo);
+        } else {
+            pendingSpill.push_back(std::move(record));
+            if (pendingSpill.size() >= spillSegmentSize) {
+                journal->pushSegment(UndoJournal::Stream::Undo, pendingSpill);
+                pendingSpill.clear();
+            }
+        }
+    }
+
+    undoArena.releaseFront(oldest.textEnd());
+    oldest = Entry();
+    undoHead = (undoHead + 1) % undoRing.size();
+    --undoCount;
+}
+
+// Remove the newest undo entry. Caller must hold stackMutex.
+void UndoRedoStack::popNewest() {
+    Entry& newest = undoRing[(undoHead + undoCount - 1) % undoRing.size()];
+    undoBytes -= newest.bytes;
+    undoArena.releaseBack(newest.offset);
+    newest = Entry();
+    if (--undoCount == 0) {
+        undoArena.clear();
+    }
+}
+
+// Once the redo history is over the entry limit or its byte budget, move its farthest
+// entries to the journal, or drop them without one. The nearest entry always stays.
+// Caller must hold stackMutex.
+void UndoRedoStack::trimRedo() {
+    size_t count = 0;
+    size_t remainingBytes = redoBytes;
+    while (count + 1 < redoStack.size() &&
+           (redoStack.size() - count > maxStackSize || remainingBytes > maxMemoryBytes)) {
+        remainingBytes -= redoStack[count].bytes;
+        ++count;
+    }
+    if (count == 0) {
+        return;
+    }
+    if (!journal) {
+        dropFarthestRedo(count);
+        return;
+    }
+
+    // Spill a whole segment at a time so paging back in stays cheap
+    count = std::max(count, std::min(spillSegmentSize, redoStack.size() - 1));
+    std::vector<std::string> records;
+    records.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string record;
+        if (!encodeRecord(redoStack[i], redoArena, record)) {
+            // An action that cannot be journaled is dropped along with everything farther
+            journal->clear(UndoJournal::Stream::Redo);
+            records.clear();
+        } else {
+            records.push_back(std::move(record));
+        }
+    }
+    journal->pushSegment(UndoJournal::Stream::Redo, records);
+    dropFarthestRedo(count);
+}
+
+// Remove the count farthest redo entries. Caller must hold stackMutex.
+void UndoRedoStack::dropFarthestRedo(size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        redoBytes -= redoStack[i].bytes;
+    }
+    if (count == redoStack.size()) {
+        redoStack.clear();
+        redoArena.clear();
+        return;
+    }
+    redoArena.releaseFront(redoStack[count].offset);
+    redoStack.erase(redoStack.begin(), redoStack.begin() + static_cast<std::ptrdiff_t>(count));
+}
+
+// Refill the empty undo ring with the newest spilled entries. Caller must hold stackMutex.
+bool UndoRedoStack::pageInUndo() {
+    std::vector<std::string> records;
+    if (!pendingSpill.empty()) {
+        records = std::move(pendingSpill);
+        pendingSpill.clear();
+    } else if (journal && journal->hasSegments(UndoJournal::Stream::Undo)) {
+        records = journal->popSegment(UndoJournal::Stream::Undo);
+    }
+
+    for (const auto& record : records) {
+        appendUndo(decodeRecord(record, undoArena));
+    }
+    return undoCount > 0;
+}
+
+// Refill the empty redo stack with the nearest spilled segment. Caller must hold stackMutex.
+bool UndoRedoStack::pageInRedo() {
+    if (!journal || !journal->hasSegments(UndoJournal::Stream::Redo)) {
+        return false;
+    }
+
+    for (const auto& record : journal->popSegment(UndoJournal::Stream::Redo)) {
+        Entry entry = decodeRecord(record, redoArena);
+        redoBytes += entry.bytes;
+        redoStack.push_back(std::move(entry));
+    }
+    return !redoStack.empty();
+}
+
+// Append a delta's text to the arena and return the entry pointing at it
+UndoRedoStack::Entry UndoRedoStack::makeDeltaEntry(DeltaArena& arena, std::string_view reference,
+                                                   std::string_view oldValue, std::string_view newValue) {
+    Entry entry;
+    entry.offset = arena.append(reference, oldValue, newValue);
+    entry.referenceLength = static_cast<uint32_t>(reference.size());
+    entry.oldLength = static_cast<uint32_t>(oldValue.size());
+    entry.newLength = static_cast<uint32_t>(newValue.size());
+    entry.bytes = entrySize(entry);
+    return entry;
+}
+
+// Move an entry to the end of another history, copying its delta text across. An action's
+// footprint is measured again, since applying it may have changed what it holds.
+UndoRedoStack::Entry UndoRedoStack::transfer(Entry& entry, const DeltaArena& from, DeltaArena& to) {
+    if (entry.action) {
+        Entry moved;
+        moved.action = std::move(entry.action);
+        moved.offset = to.end();
+        moved.bytes = entrySize(moved);
+        return moved;
+    }
+    CellDelta delta = toDelta(entry, from);
+    return makeDeltaEntry(to, delta.cellReference, delta.oldValue, delta.newValue);
+}
+
+CellDelta UndoRedoStack::toDelta(const Entry& entry, const DeltaArena& arena) {
+    size_t offset = entry.offset;
+    CellDelta delta;
+    delta.cellReference = std::string(arena.view(offset, entry.referenceLength));
+    offset += entry.referenceLength;
+    delta.oldValue = std::string(arena.view(offset, entry.oldLength));
+    offset += entry.oldLength;
+    delta.newValue = std::string(arena.view(offset, entry.newLength));
+    return delta;
+}
+
+// Encode an entry for the journal; returns false for an action that cannot be spilled
+bool UndoRedoStack::encodeRecord(const Entry& entry, const DeltaArena& arena, std::string& record) const {
+    if (entry.action) {
+        record.assign(1, kActionRecord);
+        return actionLoader && entry.action->serialize(record);
+    }
+    record.assign(1, kDeltaRecord);
+    size_t offset = entry.offset;
+    appendString(record, arena.view(offset, entry.referenceLength));
+    offset += entry.referenceLength;
+    appendString(record, arena.view(offset, entry.oldLength));
+    offset += entry.oldLength;
+    appendString(record, arena.view(offset, entry.newLength));
+    return true;
+}
+
+// Rebuild a journal record as an entry at the end of the arena's history
+UndoRedoStack::Entry UndoRedoStack::decodeRecord(const std::string& record, DeltaArena& arena) const {
+    if (!record.empty() && record[0] == kDeltaRecord) {
+        size_t pos = 1;
+        std::string_view reference = readString(record, pos);
+        std::string_view oldValue = readString(record, pos);
+        std::string_view newValue = readString(record, pos);
+        return makeDeltaEntry(arena, reference, oldValue, newValue);
+    }
+    if (record.empty() || record[0] != kActionRecord || !actionLoader) {
+        throw std::runtime_error("Undo journal holds an entry that cannot be restored");
+    }
+
+    Entry entry;
+    entry.action = actionLoader(record.substr(1));
+    if (!entry.action) {
+        throw std::runtime_error("Undo journal holds an entry that cannot be restored");
+    }
+    entry.offset = arena.end();
+    entry.bytes = entrySize(entry);
+    return entry;
+}
+
+// Undo an entry of the undo ring
+void UndoRedoStack::applyUndo(Entry& entry) {
+    if (entry.action) {
+        entry.action->undo();
+    } else if (deltaApplier) {
+        std::string_view reference = undoArena.view(entry.offset, entry.referenceLength);
+        std::string_view oldValue = undoArena.view(entry.offset + entry.referenceLength, entry.oldLength);
+        deltaApplier(std::string(reference), std::string(oldValue));
+    } else {
+        throw std::runtime_error("No delta applier set for cell undo");
+    }
+}
+
+// Redo an entry of the redo stack
+void UndoRedoStack::applyRedo(Entry& entry) {
+    if (entry.action) {
+        entry.action->redo();
+    } else if (deltaApplier) {
+        std::string_view reference = redoArena.view(entry.offset, entry.referenceLength);
+        std::string_view newValue =
+            redoArena.view(entry.offset + entry.referenceLength + entry.oldLength, entry.newLength);
+        deltaApplier(std::string(reference), std::string(newValue));
+    } else {
+        throw std::runtime_error("No delta applier set for cell redo");
+    }
+}
+
+// Approximate memory cost of an entry: the slot itself plus its text or action payload
+size_t UndoRedoStack::entrySize(const Entry& entry) {
+    size_t bytes = sizeof(Entry);
+    if (entry.action) {
+        bytes += entry.action->memoryFootprint();
+    } else {
+        bytes += static_cast<size_t>(entry.referenceLength) + entry.oldLength + entry.newLength;
+    }
+    return bytes;
+}
+
+size_t UndoRedoStack::DeltaArena::append(std::string_view reference, std::string_view oldValue, std::string_view newValue) {
+    size_t offset = end();
+    text.append(reference);
+    text.append(oldValue);
+    text.append(newValue);
+    return offset;
+}
+
+// Everything before offset is dead
+void UndoRedoStack::DeltaArena::releaseFront(size_t offset) {
+    size_t dead = offset - base;
+    if (dead == text.size()) {
+        text.clear();
+        base = offset;
+    } else if (dead >= kMinArenaCompaction && dead * 2 >= text.size()) {
+        text.erase(0, dead);
+        base = offset;
+    }
+}
+
+// Everything from offset on is dead
+void UndoRedoStack::DeltaArena::releaseBack(size_t offset) {
+    text.resize(offset - base);
+}
+
+void UndoRedoStack::DeltaArena::clear() {
+    text.clear();
+    base = 0;
 }
 
 // Human tasks (commented):
 // TODO: Implement a mechanism to group related actions for compound undo/redo operations
-// TODO: Add support for action compression to reduce memory usage
 // TODO: Implement error handling for failed undo operations
 // TODO: Add logging for undo operations to aid in debugging
 // TODO: Implement error handling for failed redo operations
 // TODO: Add logging for redo operations to aid in debugging
 // TODO: Implement a mechanism to notify observers when stacks are cleared
-// TODO: Add an option to selectively clear undo or redo stack
\ No newline at end of file
+// TODO: Add an option to selectively clear undo or redo stack
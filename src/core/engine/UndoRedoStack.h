@@ -4,6 +4,14 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+// Forward declarations
+class UndoJournal;
 
 // Abstract base class for actions that can be undone and redone
 class Action {
@@ -15,23 +23,61 @@ public:
 
     // Pure virtual function to redo the action
     virtual void redo() = 0;
+
+    // Approximate number of bytes held by the action, used for the history byte budget
+    virtual size_t memoryFootprint() const { return 0; }
+
+    // Appends an encoding the stack's ActionLoader can rebuild the action from, so the action
+    // can be spilled to the undo journal; returns false if it can only live in memory
+    virtual bool serialize(std::string& /*out*/) const { return false; }
 };
 
-// Manages undo and redo operations for the Excel engine
-class UndoRedoStack {
-private:
-    std::vector<std::unique_ptr<Action>> undoStack;
-    std::vector<std::unique_ptr<Action>> redoStack;
-    size_t maxStackSize;
-    mutable std::mutex stackMutex;
+// A single cell edit as passed to and from the undo journal
+struct CellDelta {
+    std::string cellReference;
+    std::string oldValue;
+    std::string newValue;
+};
 
+// Manages undo and redo operations for the Excel engine.
+// Undo history is kept in a ring buffer, so trimming the oldest entry is O(1). Undo and
+// redo are each bounded by the entry count and by their own byte budget, so a long redo
+// history never pushes out undo entries. Plain cell edits are not heap-allocated Action
+// objects: their text is packed into a byte arena per history and the entry records only
+// where. An entry is removed only after its undo or redo succeeded, so a failed apply can
+// be retried. With a journal enabled, trimmed deltas are spilled to disk and paged back in
+// when the user undoes that far; without one, the oldest undo and farthest redo entries
+// are dropped. Custom actions are spilled too when they serialize themselves and an
+// ActionLoader is set; one that cannot be spilled ends the reachable history there.
+class UndoRedoStack {
 public:
-    // Initializes the UndoRedoStack with a specified maximum stack size
-    explicit UndoRedoStack(size_t maxSize = 100) : maxStackSize(maxSize) {}
+    // Callback used to write a cell value back when a CellDelta is undone or redone
+    using DeltaApplier = std::function<void(const std::string& cellReference, const std::string& value)>;
+
+    // Rebuilds a custom action from the encoding written by Action::serialize
+    using ActionLoader = std::function<std::unique_ptr<Action>(const std::string& encoded)>;
+
+    // Initializes the UndoRedoStack with a maximum entry count and a byte budget, each
+    // applied to undo and to redo history separately
+    explicit UndoRedoStack(size_t maxSize = 100, size_t maxBytes = 64 * 1024 * 1024);
+    ~UndoRedoStack();
+
+    // Spills history beyond the in-memory limits to an append-only journal file
+    // in segments of segmentSize deltas, instead of discarding it
+    void enableJournal(const std::string& filePath, size_t segmentSize = 4096);
+
+    // Sets the callback that applies CellDelta records to the spreadsheet
+    void setDeltaApplier(DeltaApplier applier);
+
+    // Sets the callback that rebuilds spilled custom actions; without one, none are spilled
+    void setActionLoader(ActionLoader loader);
 
     // Pushes a new action onto the undo stack
     void pushAction(std::unique_ptr<Action> action);
 
+    // Pushes a compact cell edit record onto the undo stack
+    void pushDelta(const std::string& cellReference, const std::string& oldValue, const std::string& newValue);
+
     // Undoes the most recent action
     bool undo();
 
@@ -46,15 +92,96 @@ public:
 
     // Checks if there are actions that can be redone
     bool canRedo() const;
+
+    // Returns the number of entries currently in the undo history
+    size_t getUndoCount() const;
+
+    // Returns the approximate number of bytes held in memory by the undo and redo history together
+    size_t getMemoryUsage() const;
+
+    // Returns the number of undo entries spilled to the journal
+    size_t getSpilledUndoCount() const;
+
+    // Returns true once enableJournal has been called
+    bool hasJournal() const;
+
+private:
+    // Text of the cell deltas of one history, appended in entry order. Entries leave only
+    // from either end, so offsets are logical: the tail is cut back directly and the dead
+    // head is dropped once it makes up half of the buffer.
+    struct DeltaArena {
+        std::string text;
+        size_t base = 0; // Logical offset of text[0]
+
+        size_t end() const { return base + text.size(); }
+        std::string_view view(size_t offset, size_t length) const {
+            return std::string_view(text).substr(offset - base, length);
+        }
+        size_t append(std::string_view reference, std::string_view oldValue, std::string_view newValue);
+        void releaseFront(size_t offset);
+        void releaseBack(size_t offset);
+        void clear();
+    };
+
+    // A history entry is either a cell delta in the arena (action == nullptr) or a custom Action
+    struct Entry {
+        std::unique_ptr<Action> action;
+        size_t offset = 0;
+        uint32_t referenceLength = 0;
+        uint32_t oldLength = 0;
+        uint32_t newLength = 0;
+        size_t bytes = 0;
+
+        size_t textEnd() const { return offset + referenceLength + oldLength + newLength; }
+    };
+
+    // Ring buffer of undo entries; undoHead indexes the oldest entry
+    std::vector<Entry> undoRing;
+    size_t undoHead;
+    size_t undoCount;
+    DeltaArena undoArena;
+    size_t undoBytes;
+
+    // Redo entries grow and shrink at the back; the farthest are trimmed from the front
+    std::vector<Entry> redoStack;
+    DeltaArena redoArena;
+    size_t redoBytes;
+
+    size_t maxStackSize;
+    size_t maxMemoryBytes;
+    DeltaApplier deltaApplier;
+    ActionLoader actionLoader;
+    mutable std::mutex stackMutex;
+
+    // Spill state; pendingSpill holds encoded trimmed entries until a full segment can be written
+    std::unique_ptr<UndoJournal> journal;
+    std::vector<std::string> pendingSpill;
+    size_t spillSegmentSize;
+
+    void pushEntry(Entry entry);
+    void appendUndo(Entry entry);
+    void clearRedo();
+    void evictOldest();
+    void popNewest();
+    void trimRedo();
+    void dropFarthestRedo(size_t count);
+    bool pageInUndo();
+    bool pageInRedo();
+    static Entry makeDeltaEntry(DeltaArena& arena, std::string_view reference, std::string_view oldValue, std::string_view newValue);
+    static Entry transfer(Entry& entry, const DeltaArena& from, DeltaArena& to);
+    static CellDelta toDelta(const Entry& entry, const DeltaArena& arena);
+    bool encodeRecord(const Entry& entry, const DeltaArena& arena, std::string& record) const;
+    Entry decodeRecord(const std::string& record, DeltaArena& arena) const;
+    void applyUndo(Entry& entry);
+    void applyRedo(Entry& entry);
+    static size_t entrySize(const Entry& entry);
 };
 
 // Human tasks:
 // - Add comprehensive documentation for each method, including usage examples and best practices
 // - Implement a mechanism to group related actions for compound undo/redo operations
-// - Consider adding a method to get the current undo/redo stack sizes
 // - Implement a way to serialize and deserialize the undo/redo stacks for saving and loading workbook state
 // - Add support for action descriptions to provide user-friendly undo/redo menu items
 // - Consider implementing an event system to notify observers of undo/redo operations
-// - Add support for limiting the undo/redo history based on time or memory usage in addition to action count
 
-#endif // UNDO_REDO_STACK_H
\ No newline at end of file
+#endif // UNDO_REDO_STACK_H
@@ -0,0 +1,317 @@
+#include "WorkbookHost.h"
+#include "SpreadsheetEngine.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+
+WorkbookHost::WorkbookHost(Options hostOptions)
+    : options(std::move(hostOptions)), stopping(false) {
+    size_t workerCount = options.workerCount;
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&WorkbookHost::workerLoop, this);
+    }
+    reaperThread = std::thread(&WorkbookHost::reaperLoop, this);
+}
+
+WorkbookHost::WorkbookHost() : WorkbookHost(Options()) {}
+
+WorkbookHost::~WorkbookHost() {
+    {
+        std::lock_guard<std::mutex> lock(hostMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    reaperWake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    reaperThread.join();
+}
+
+void WorkbookHost::openWorkbook(const std::string& workbookId) {
+    openWorkbook(workbookId, options.defaultQuota);
+}
+
+void WorkbookHost::openWorkbook(const std::string& workbookId, const Quota& quota) {
+    // Build the engine before taking the host lock; it starts its own writer thread
+    auto workbook = std::make_shared<Workbook>();
+    workbook->id = workbookId;
+    workbook->quota = quota;
+    workbook->engine = std::make_unique<SpreadsheetEngine>();
+    workbook->windowStart = workbook->lastUsed = Clock::now();
+
+    std::lock_guard<std::mutex> lock(hostMutex);
+    if (!workbooks.emplace(workbookId, workbook).second) {
+        throw std::invalid_argument("Workbook is already open: " + workbookId);
+    }
+}
+
+void WorkbookHost::closeWorkbook(const std::string& workbookId) {
+    std::shared_ptr<Workbook> released;
+    {
+        std::lock_guard<std::mutex> lock(hostMutex);
+        auto it = workbooks.find(workbookId);
+        if (it == workbooks.end()) {
+            throw std::invalid_argument("Unknown workbook: " + workbookId);
+        }
+        it->second->closing = true;
+        if (it->second->running || !it->second->tasks.empty()) {
+            return; // Whoever holds the claim (a worker or unloadIdle) removes it on release
+        }
+        released = std::move(it->second);
+        workbooks.erase(it);
+    }
+    std::remove(spillPath(workbookId).c_str());
+}
+
+std::future<void> WorkbookHost::submit(const std::string& workbookId, Task task) {
+    PendingTask pending{std::move(task), std::promise<void>()};
+    std::future<void> result = pending.done.get_future();
+    {
+        std::lock_guard<std::mutex> lock(hostMutex);
+        if (stopping) {
+            throw std::runtime_error("WorkbookHost is shutting down");
+        }
+        auto it = workbooks.find(workbookId);
+        if (it == workbooks.end() || it->second->closing) {
+            throw std::invalid_argument("Unknown workbook: " + workbookId);
+        }
+        Workbook& workbook = *it->second;
+        if (workbook.overMemory && workbook.engine && !workbook.running) {
+            // Measure again: writes the last task queued on the engine may have freed memory since
+            workbook.memoryBytes = workbook.engine->getMemoryUsage();
+            workbook.overMemory = workbook.memoryBytes > workbook.quota.maxMemoryBytes;
+        }
+        if (workbook.overMemory) {
+            throw std::runtime_error("Workbook is over its memory quota: " + workbookId);
+        }
+
+        // A workbook sits in the ready queue while it has tasks and is not running
+        bool wasIdle = workbook.tasks.empty() && !workbook.running;
+        workbook.tasks.push_back(std::move(pending));
+        if (wasIdle) {
+            readyQueue.push_back(it->second);
+        }
+    }
+    workAvailable.notify_one();
+    return result;
+}
+
+size_t WorkbookHost::unloadIdle() {
+    const Clock::time_point now = Clock::now();
+
+    // Claim idle workbooks by marking them running so no worker touches them meanwhile
+    std::vector<std::shared_ptr<Workbook>> candidates;
+    {
+        std::lock_guard<std::mutex> lock(hostMutex);
+        for (auto& entry : workbooks) {
+            Workbook& workbook = *entry.second;
+            if (workbook.engine && !workbook.running && !workbook.closing && workbook.tasks.empty() &&
+                now - workbook.lastUsed > options.idleTimeout) {
+                workbook.running = true;
+                candidates.push_back(entry.second);
+            }
+        }
+    }
+
+    size_t unloaded = 0;
+    for (auto& workbook : candidates) {
+        bool saved = false;
+        try {
+            // saveState keeps only cell values, so anything more than those and undo history
+            // stays in memory; undo history is dropped with the engine
+            if (!workbook->engine->hasNonCellState()) {
+                workbook->engine->saveState(spillPath(workbook->id));
+                saved = true;
+                ++unloaded;
+            }
+        } catch (const std::exception&) {
+            // Keep it in memory; the next pass retries
+        }
+
+        std::unique_ptr<SpreadsheetEngine> released;
+        bool ready = false;
+        bool closed = false;
+        {
+            std::lock_guard<std::mutex> lock(hostMutex);
+            if (saved) {
+                released = std::move(workbook->engine);
+                workbook->spilled = true;
+                workbook->memoryBytes = 0;
+                workbook->overMemory = false;
+            }
+            workbook->running = false;
+            if (!workbook->tasks.empty()) {
+                readyQueue.push_back(workbook);
+                ready = true;
+            } else if (workbook->closing) {
+                // closeWorkbook ran while this pass held the claim and left the removal to us
+                workbooks.erase(workbook->id);
+                closed = true;
+            }
+        }
+        if (ready) {
+            workAvailable.notify_one();
+        }
+        if (closed) {
+            std::remove(spillPath(workbook->id).c_str());
+        }
+    }
+    return unloaded;
+}
+
+WorkbookHost::Usage WorkbookHost::getUsage(const std::string& workbookId) const {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    auto it = workbooks.find(workbookId);
+    if (it == workbooks.end()) {
+        throw std::invalid_argument("Unknown workbook: " + workbookId);
+    }
+
+    const Workbook& workbook = *it->second;
+    Usage usage;
+    usage.loaded = workbook.engine != nullptr;
+    usage.queuedTasks = workbook.tasks.size();
+    usage.memoryBytes = workbook.memoryBytes;
+    usage.runTimeInWindow = std::chrono::duration_cast<std::chrono::microseconds>(workbook.runTimeInWindow);
+    usage.totalRunTime = std::chrono::duration_cast<std::chrono::microseconds>(workbook.totalRunTime);
+    return usage;
+}
+
+size_t WorkbookHost::getLoadedCount() const {
+    std::lock_guard<std::mutex> lock(hostMutex);
+    return static_cast<size_t>(std::count_if(workbooks.begin(), workbooks.end(),
+        [](const auto& entry) { return entry.second->engine != nullptr; }));
+}
+
+void WorkbookHost::workerLoop() {
+    while (true) {
+        std::shared_ptr<Workbook> workbook;
+        PendingTask pending;
+        {
+            std::unique_lock<std::mutex> lock(hostMutex);
+            while (true) {
+                Clock::time_point wakeAt = Clock::time_point::max();
+                workbook = takeNextRunnable(Clock::now(), wakeAt);
+                if (workbook) {
+                    break;
+                }
+                if (stopping && readyQueue.empty()) {
+                    return;
+                }
+                if (wakeAt == Clock::time_point::max()) {
+                    workAvailable.wait(lock);
+                } else {
+                    workAvailable.wait_until(lock, wakeAt);
+                }
+            }
+            workbook->running = true;
+            pending = std::move(workbook->tasks.front());
+            workbook->tasks.pop_front();
+        }
+
+        // Run outside the host lock; the running flag gives this worker the engine
+        Clock::time_point started = Clock::now();
+        size_t memoryBytes = workbook->memoryBytes;
+        try {
+            ensureLoaded(*workbook);
+            pending.run(*workbook->engine);
+            pending.done.set_value();
+        } catch (...) {
+            pending.done.set_exception(std::current_exception());
+        }
+        Clock::time_point finished = Clock::now();
+        if (workbook->engine) {
+            memoryBytes = workbook->engine->getMemoryUsage();
+        }
+
+        std::shared_ptr<Workbook> released;
+        {
+            std::lock_guard<std::mutex> lock(hostMutex);
+            rollWindow(*workbook, started);
+            workbook->runTimeInWindow += finished - started;
+            workbook->totalRunTime += finished - started;
+            workbook->lastUsed = finished;
+            workbook->memoryBytes = memoryBytes;
+            workbook->overMemory = memoryBytes > workbook->quota.maxMemoryBytes;
+            workbook->running = false;
+
+            if (!workbook->tasks.empty()) {
+                // Back of the line: other workbooks get their turn first
+                readyQueue.push_back(workbook);
+            } else if (workbook->closing) {
+                workbooks.erase(workbook->id);
+                released = workbook;
+            }
+        }
+        workAvailable.notify_one();
+
+        if (released) {
+            std::remove(spillPath(released->id).c_str());
+        }
+    }
+}
+
+void WorkbookHost::reaperLoop() {
+    const auto interval = std::max<std::chrono::milliseconds>(options.idleTimeout / 4, std::chrono::milliseconds(100));
+    std::unique_lock<std::mutex> lock(hostMutex);
+    while (!stopping) {
+        reaperWake.wait_for(lock, interval, [this]() { return stopping; });
+        if (stopping) {
+            return;
+        }
+        lock.unlock();
+        unloadIdle();
+        lock.lock();
+    }
+}
+
+std::shared_ptr<WorkbookHost::Workbook> WorkbookHost::takeNextRunnable(Clock::time_point now, Clock::time_point& wakeAt) {
+    for (auto it = readyQueue.begin(); it != readyQueue.end(); ++it) {
+        Workbook& workbook = **it;
+        rollWindow(workbook, now);
+
+        // Quotas are not enforced while draining for shutdown
+        if (stopping || workbook.runTimeInWindow < workbook.quota.runTimePerWindow) {
+            std::shared_ptr<Workbook> next = std::move(*it);
+            readyQueue.erase(it);
+            return next;
+        }
+        wakeAt = std::min(wakeAt, workbook.windowStart + workbook.quota.window);
+    }
+    return nullptr;
+}
+
+void WorkbookHost::rollWindow(Workbook& workbook, Clock::time_point now) {
+    if (now - workbook.windowStart >= workbook.quota.window) {
+        workbook.windowStart = now;
+        workbook.runTimeInWindow = Clock::duration::zero();
+    }
+}
+
+void WorkbookHost::ensureLoaded(Workbook& workbook) {
+    if (workbook.engine) {
+        return;
+    }
+    auto engine = std::make_unique<SpreadsheetEngine>();
+    if (workbook.spilled) {
+        engine->loadState(spillPath(workbook.id));
+    }
+
+    std::lock_guard<std::mutex> lock(hostMutex);
+    workbook.engine = std::move(engine);
+}
+
+std::string WorkbookHost::spillPath(const std::string& workbookId) const {
+    // Keep file names safe while staying unique per ID
+    std::ostringstream name;
+    for (char c : workbookId.substr(0, 64)) {
+        name << (std::isalnum(static_cast<unsigned char>(c)) ? c : '_');
+    }
+    name << '-' << std::hex << std::hash<std::string>()(workbookId) << ".wbstate";
+    return options.spillDirectory + "/" + name.str();
+}
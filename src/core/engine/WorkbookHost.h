@@ -0,0 +1,140 @@
+#ifndef WORKBOOK_HOST_H
+#define WORKBOOK_HOST_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+class SpreadsheetEngine;
+
+// Hosts many open workbooks in one server process. Recalcs, imports and analyses for every
+// workbook run on one shared worker pool: workbooks with queued work take turns round-robin,
+// each runs at most one task at a time, and a workbook that used up its run-time quota for
+// the current window waits until the window rolls over. Workbooks left idle whose only state
+// is cell values and undo history are written to the spill directory and their engines
+// released; the next task reloads the cell values transparently, and undo history is lost.
+// Workbooks with an undo journal, subscriptions, formats or validation rules stay in memory,
+// since the spill file would lose them.
+class WorkbookHost {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void(SpreadsheetEngine& engine)>;
+
+    // Per-workbook limits
+    struct Quota {
+        // Task run time a workbook may consume within each window
+        std::chrono::milliseconds runTimePerWindow{250};
+        std::chrono::milliseconds window{1000};
+        // Measured after every task and again when a task is submitted to a workbook over it;
+        // submissions are rejected while the workbook stays over it. Unloading clears it.
+        size_t maxMemoryBytes = 256 * 1024 * 1024;
+    };
+
+    struct Options {
+        size_t workerCount = 0; // 0 uses the hardware concurrency
+        std::string spillDirectory = ".";
+        std::chrono::milliseconds idleTimeout{std::chrono::minutes(10)};
+        Quota defaultQuota;
+    };
+
+    // Point-in-time accounting for one workbook
+    struct Usage {
+        bool loaded = false;
+        size_t queuedTasks = 0;
+        size_t memoryBytes = 0;
+        std::chrono::microseconds runTimeInWindow{0};
+        std::chrono::microseconds totalRunTime{0};
+    };
+
+    explicit WorkbookHost(Options options);
+    WorkbookHost();
+
+    // Drains queued tasks and stops the workers
+    ~WorkbookHost();
+
+    WorkbookHost(const WorkbookHost&) = delete;
+    WorkbookHost& operator=(const WorkbookHost&) = delete;
+
+    // Creates an empty workbook with the default quota; throws if the ID is taken
+    void openWorkbook(const std::string& workbookId);
+
+    // Creates an empty workbook with its own quota
+    void openWorkbook(const std::string& workbookId, const Quota& quota);
+
+    // Drops a workbook once its queued tasks have finished; its spill file is removed
+    void closeWorkbook(const std::string& workbookId);
+
+    // Queues a task for a workbook; the future holds the task's error, if any
+    std::future<void> submit(const std::string& workbookId, Task task);
+
+    // Unloads every workbook idle for longer than the idle timeout that holds nothing but cell
+    // values and undo history, dropping the history; returns the number unloaded.
+    // Called periodically by the host, and available for memory-pressure handling.
+    size_t unloadIdle();
+
+    // Returns the accounting for one workbook
+    Usage getUsage(const std::string& workbookId) const;
+
+    // Returns the number of workbooks whose engines are in memory
+    size_t getLoadedCount() const;
+
+private:
+    struct PendingTask {
+        Task run;
+        std::promise<void> done;
+    };
+
+    struct Workbook {
+        std::string id;
+        Quota quota;
+        std::unique_ptr<SpreadsheetEngine> engine; // null while unloaded
+        bool spilled = false;
+        std::deque<PendingTask> tasks;
+        bool running = false;
+        bool closing = false;
+        bool overMemory = false;
+        size_t memoryBytes = 0;
+        Clock::time_point windowStart;
+        Clock::duration runTimeInWindow{0};
+        Clock::duration totalRunTime{0};
+        Clock::time_point lastUsed;
+    };
+
+    Options options;
+    std::unordered_map<std::string, std::shared_ptr<Workbook>> workbooks;
+    // Workbooks with queued tasks that are not running, in turn order
+    std::deque<std::shared_ptr<Workbook>> readyQueue;
+    mutable std::mutex hostMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable reaperWake;
+    bool stopping;
+    std::vector<std::thread> workers;
+    std::thread reaperThread;
+
+    void workerLoop();
+    void reaperLoop();
+
+    // Picks the next workbook allowed to run, or null; sets wakeAt to the earliest time a
+    // throttled workbook becomes eligible. Caller must hold hostMutex.
+    std::shared_ptr<Workbook> takeNextRunnable(Clock::time_point now, Clock::time_point& wakeAt);
+
+    // Rolls the quota window forward if it has elapsed. Caller must hold hostMutex.
+    static void rollWindow(Workbook& workbook, Clock::time_point now);
+
+    // Loads an unloaded workbook from its spill file or creates an empty engine. The engine
+    // pointer only changes under hostMutex, and only by whoever has claimed the workbook
+    // through its running flag, so the claimant may use it without the lock.
+    void ensureLoaded(Workbook& workbook);
+
+    std::string spillPath(const std::string& workbookId) const;
+};
+
+#endif // WORKBOOK_HOST_H
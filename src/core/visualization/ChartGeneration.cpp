@@ -82,25 +82,8 @@ bool ChartGeneration::deleteChart(const std::string& chartId) {
 
 // Retrieve data from the specified Excel range
 std::vector<std::vector<double>> ChartGeneration::getDataFromRange(const std::string& range) {
-    // Parse the range string to determine sheet and cell references
-    // This is a simplified implementation and may need to be expanded
-    auto cellRange = dataStore->getCellRange(range);
-
-    std::vector<std::vector<double>> numericData;
-    for (const auto& row : cellRange) {
-        std::vector<double> numericRow;
-        for (const auto& cell : row) {
-            try {
-                numericRow.push_back(std::stod(cell));
-            } catch (const std::invalid_argument&) {
-                // Handle non-numeric data
-                numericRow.push_back(0.0);
-            }
-        }
-        numericData.push_back(numericRow);
-    }
-
-    return numericData;
+    // Scan the number lanes of one pinned version; non-numeric cells plot as 0
+    return dataStore->createSnapshot().getNumericRange(range, 0.0);
 }
 
 // Generate a chart object based on the provided data and chart type
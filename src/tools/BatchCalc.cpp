@@ -0,0 +1,285 @@
+// Headless batch recalculation runner for build farms and end-to-end performance runs.
+//
+// Usage:
+//   batchcalc <workbook> [--sheet NAME] [--patch FILE] [--dirty]
+//             [--output RANGE[,RANGE...]] [--save PATH]
+//
+// Loads the workbook, applies an optional patch file of "A1=value" lines, recalculates
+// (fully, or with --dirty only the patched cells' dependents), prints the requested output
+// ranges as "reference<TAB>value" lines and optionally writes the workbook back, native
+// workbooks in the native format. Load, import, dependency-graph build, calc and save times
+// go to stderr so stdout stays machine-readable.
+
+#include "src/core/engine/SpreadsheetEngine.h"
+#include "src/core/engine/CellAddress.h"
+#include "src/core/data/DataStore.h"
+#include "src/core/data/FileIO.h"
+#include "src/core/data/NativeWorkbook.h"
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string workbookPath;
+    std::string sheetName;
+    std::string patchPath;
+    bool dirtyOnly = false;
+    std::vector<std::string> outputRanges;
+    std::string savePath;
+};
+
+// Prints one phase timing line: "<phase> <milliseconds> ms"
+class PhaseTimer {
+public:
+    explicit PhaseTimer(const char* phaseName) : name(phaseName), start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::fprintf(stderr, "%-8s %10.2f ms\n", name, elapsed.count());
+    }
+
+private:
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+};
+
+void printUsage() {
+    std::cerr << "usage: batchcalc <workbook> [--sheet NAME] [--patch FILE] [--dirty]\n"
+                 "                 [--output RANGE[,RANGE...]] [--save PATH]\n";
+}
+
+Options parseArguments(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--sheet") {
+            options.sheetName = next();
+        } else if (arg == "--patch") {
+            options.patchPath = next();
+        } else if (arg == "--dirty") {
+            options.dirtyOnly = true;
+        } else if (arg == "--output") {
+            std::stringstream ranges(next());
+            std::string range;
+            while (std::getline(ranges, range, ',')) {
+                if (!range.empty()) {
+                    options.outputRanges.push_back(range);
+                }
+            }
+        } else if (arg == "--save") {
+            options.savePath = next();
+        } else if (!arg.empty() && arg[0] == '-') {
+            throw std::invalid_argument("Unknown option " + arg);
+        } else if (options.workbookPath.empty()) {
+            options.workbookPath = arg;
+        } else {
+            throw std::invalid_argument("Unexpected argument " + arg);
+        }
+    }
+    if (options.workbookPath.empty()) {
+        throw std::invalid_argument("No workbook given");
+    }
+    return options;
+}
+
+// Formulas are handed to the engine as written; plain values as their display text
+std::string toEngineValue(const DataSnapshot& snapshot, const CellData& data) {
+    if (data.getFormulaId() != kNoFormula) {
+        return snapshot.getFormula(data.getFormulaId());
+    }
+    return snapshot.getDisplayText(data);
+}
+
+// Calculated text goes back as a number when it parses as one, so the file keeps its types;
+// the cell's formula and style are left as they were
+void fromEngineValue(DataStore& dataStore, const std::string& value, CellData& data) {
+    CellData result;
+    double number = 0.0;
+    auto parsed = std::from_chars(value.data(), value.data() + value.size(), number);
+    if (!value.empty() && parsed.ec == std::errc() && parsed.ptr == value.data() + value.size()) {
+        result = CellData::fromNumber(number, data.getStyleId());
+    } else if (value == "TRUE" || value == "FALSE") {
+        result = CellData::fromBoolean(value == "TRUE", data.getStyleId());
+    } else {
+        result = CellData::fromText(dataStore.internText(value), data.getStyleId());
+    }
+    result.formula = data.formula;
+    data = result;
+}
+
+// Patch file: one "A1=value" per line; blank lines and lines starting with '#' are skipped
+std::vector<std::pair<std::string, std::string>> readPatch(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open patch file: " + path);
+    }
+
+    std::vector<std::pair<std::string, std::string>> patch;
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t separator = line.find('=');
+        if (separator == std::string::npos || separator == 0) {
+            throw std::runtime_error("Malformed patch line " + std::to_string(lineNumber) + ": " + line);
+        }
+        std::string reference = line.substr(0, separator);
+        parseCellAddress(reference); // Validate before anything is applied
+        patch.emplace_back(reference, line.substr(separator + 1));
+    }
+    return patch;
+}
+
+int run(const Options& options) {
+    DataStore dataStore;
+    FileIO fileIO(&dataStore);
+    SpreadsheetEngine engine;
+
+    {
+        PhaseTimer timer("load");
+        if (!fileIO.loadWorkbook(options.workbookPath)) {
+            throw std::runtime_error("Failed to load workbook: " + options.workbookPath);
+        }
+    }
+
+    DataSnapshot snapshot = dataStore.createSnapshot();
+    std::string sheetName = options.sheetName;
+    if (sheetName.empty()) {
+        std::vector<std::string> sheets = snapshot.getSheetNames();
+        if (sheets.empty()) {
+            throw std::runtime_error("Workbook has no sheets");
+        }
+        sheetName = sheets.front();
+    }
+
+    std::vector<std::pair<std::string, std::string>> patch;
+    if (!options.patchPath.empty()) {
+        patch = readPatch(options.patchPath);
+    }
+
+    {
+        // Hand every cell to the engine in one bulk import; without --dirty the patch is
+        // folded in here and picked up by the full recalculation
+        PhaseTimer timer("import");
+        std::vector<std::pair<std::string, std::string>> cells;
+        snapshot.forEachCell(sheetName, [&cells, &snapshot](const CellAddress& cell, const CellData& data) {
+            cells.emplace_back(formatCellAddress(cell), toEngineValue(snapshot, data));
+        });
+        if (!options.dirtyOnly) {
+            cells.insert(cells.end(), patch.begin(), patch.end());
+        }
+        engine.importCells(cells);
+    }
+
+    {
+        PhaseTimer timer("graph");
+        engine.buildDependencyGraph();
+    }
+
+    {
+        PhaseTimer timer("calc");
+        if (options.dirtyOnly) {
+            // Each patched cell recalculates only its dependents
+            for (const auto& entry : patch) {
+                engine.setCellValue(entry.first, entry.second);
+            }
+        } else {
+            engine.recalculateAll();
+        }
+    }
+
+    for (const auto& range : options.outputRanges) {
+        RangeView view = engine.getRange(range);
+        for (uint32_t row = 0; row < view.rowCount(); ++row) {
+            for (uint32_t col = 0; col < view.columnCount(); ++col) {
+                CellAddress cell{view.getRange().first.row + row, view.getRange().first.column + col};
+                std::cout << formatCellAddress(cell) << '\t' << view.at(row, col) << '\n';
+            }
+        }
+    }
+
+    if (!options.savePath.empty()) {
+        PhaseTimer timer("save");
+
+        // Patched cells take the patch's formula, or none for a plain value; the last line for
+        // a cell wins, as it did in the engine
+        std::unordered_map<std::string, uint32_t> patchedFormulas;
+        for (const auto& entry : patch) {
+            const std::string& value = entry.second;
+            patchedFormulas[formatCellAddress(parseCellAddress(entry.first))] =
+                !value.empty() && value[0] == '=' ? dataStore.internFormula(value) : kNoFormula;
+        }
+
+        // Write calculated values back over the loaded cells, keeping their formats, then add
+        // the patched cells the workbook did not have; every cell is written once
+        std::vector<std::pair<std::string, CellData>> updates;
+        snapshot.forEachCell(sheetName, [&updates, &patchedFormulas](const CellAddress& cell, const CellData& data) {
+            std::string reference = formatCellAddress(cell);
+            auto patched = patchedFormulas.find(reference);
+            updates.emplace_back(std::move(reference), data);
+            if (patched != patchedFormulas.end()) {
+                updates.back().second.formula = patched->second;
+                patchedFormulas.erase(patched);
+            }
+        });
+        for (const auto& entry : patchedFormulas) {
+            CellData data;
+            data.formula = entry.second;
+            updates.emplace_back(entry.first, data);
+        }
+        for (auto& update : updates) {
+            fromEngineValue(dataStore, engine.getCellValue(update.first), update.second);
+        }
+        dataStore.setCellValues(sheetName, updates);
+
+        // Only the native format stores formulas and formats, so a native workbook stays native
+        bool saved = NativeWorkbook::isNativeFile(options.workbookPath) ? fileIO.saveNativeWorkbook(options.savePath)
+                                                                        : fileIO.saveWorkbook(options.savePath);
+        if (!saved) {
+            throw std::runtime_error("Failed to save workbook: " + options.savePath);
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parseArguments(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "batchcalc: " << e.what() << '\n';
+        printUsage();
+        return 2;
+    }
+
+    try {
+        PhaseTimer timer("total");
+        return run(options);
+    } catch (const std::exception& e) {
+        std::cerr << "batchcalc: " << e.what() << '\n';
+        return 1;
+    }
+}
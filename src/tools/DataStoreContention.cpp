@@ -0,0 +1,125 @@
+// Contention benchmark for DataStore with mixed readers and writers.
+//
+// Usage:
+//   datastore_contention [--readers N] [--writers N] [--sheets N] [--seconds S]
+//
+// Writers are spread round-robin across the sheets and each owns its own columns; readers
+// pin snapshots and scan a 1000x10 block of the first sheet. After --seconds the run
+// prints throughput per role, so sharding can be compared by varying --sheets (1 puts
+// all writers on one sheet, separated only by column stripes).
+
+#include "src/core/data/DataStore.h"
+#include "src/core/engine/CellAddress.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    size_t readers = 4;
+    size_t writers = 4;
+    size_t sheets = 4;
+    double seconds = 3.0;
+};
+
+Options parseArguments(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        double value = std::atof(argv[i + 1]);
+        if (arg == "--readers") {
+            options.readers = static_cast<size_t>(value);
+        } else if (arg == "--writers") {
+            options.writers = static_cast<size_t>(value);
+        } else if (arg == "--sheets") {
+            options.sheets = std::max<size_t>(1, static_cast<size_t>(value));
+        } else if (arg == "--seconds") {
+            options.seconds = value;
+        } else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+    return options;
+}
+
+std::string sheetName(size_t index) {
+    return "Sheet" + std::to_string(index + 1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parseArguments(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "datastore_contention: " << e.what() << '\n';
+        return 2;
+    }
+
+    DataStore dataStore;
+    for (size_t sheet = 0; sheet < options.sheets; ++sheet) {
+        std::vector<std::pair<std::string, CellData>> cells;
+        for (uint32_t row = 0; row < 1000; ++row) {
+            for (uint32_t col = 0; col < 10; ++col) {
+                cells.emplace_back(formatCellAddress(CellAddress{row, col}), CellData::fromNumber(row + col));
+            }
+        }
+        dataStore.setCellValues(sheetName(sheet), cells);
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint64_t> writes(0);
+    std::vector<std::thread> threads;
+
+    for (size_t r = 0; r < options.readers; ++r) {
+        threads.emplace_back([&]() {
+            uint64_t local = 0;
+            volatile double sink = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                DataSnapshot snapshot = dataStore.createSnapshot();
+                std::vector<std::vector<double>> block = snapshot.getNumericRange(sheetName(0) + "!A1:J1000", 0.0);
+                sink = sink + block[local % block.size()][0];
+                ++local;
+            }
+            reads += local;
+        });
+    }
+
+    for (size_t w = 0; w < options.writers; ++w) {
+        threads.emplace_back([&, w]() {
+            const std::string sheet = sheetName(w % options.sheets);
+            const uint32_t column = static_cast<uint32_t>(10 + w);
+            uint64_t local = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                CellAddress cell{static_cast<uint32_t>(local % 1000), column};
+                dataStore.setCellValue(sheet, formatCellAddress(cell), CellData::fromNumber(static_cast<double>(local)));
+                ++local;
+            }
+            writes += local;
+        });
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::printf("readers %zu  writers %zu  sheets %zu  hardware threads %u\n",
+                options.readers, options.writers, options.sheets, std::thread::hardware_concurrency());
+    std::printf("reads   %12.0f scans/s\n", reads.load() / elapsed);
+    std::printf("writes  %12.0f cells/s\n", writes.load() / elapsed);
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Read-scaling benchmark for SpreadsheetEngine's shared reads and single-writer queue.
+//
+// Usage:
+//   engine_read_scaling [--max-readers N] [--writers N] [--seconds S]
+//
+// Runs one round per reader count 1, 2, 4, ... up to --max-readers. In each round readers
+// fetch a 100x10 viewport with getRange while writers queue cell updates outside it with
+// submitCellValue. Every round prints read throughput, the slowest single read (which is
+// bounded by how long one write batch holds the exclusive lock) and the write throughput,
+// so scaling is visible as reads/s growing with the reader count.
+
+#include "src/core/engine/SpreadsheetEngine.h"
+#include "src/core/engine/CellAddress.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    size_t maxReaders = 8;
+    size_t writers = 2;
+    double seconds = 2.0;
+};
+
+struct RoundResult {
+    double readsPerSecond = 0.0;
+    double slowestReadMicros = 0.0;
+    double writesPerSecond = 0.0;
+};
+
+Options parseArguments(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        double value = std::atof(argv[i + 1]);
+        if (arg == "--max-readers") {
+            options.maxReaders = std::max<size_t>(1, static_cast<size_t>(value));
+        } else if (arg == "--writers") {
+            options.writers = static_cast<size_t>(value);
+        } else if (arg == "--seconds") {
+            options.seconds = value;
+        } else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+    return options;
+}
+
+RoundResult runRound(SpreadsheetEngine& engine, size_t readers, const Options& options) {
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint64_t> writes(0);
+    std::atomic<int64_t> slowestRead(0);
+    std::vector<std::thread> threads;
+
+    for (size_t r = 0; r < readers; ++r) {
+        threads.emplace_back([&]() {
+            uint64_t local = 0;
+            int64_t slowest = 0;
+            volatile size_t sink = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto started = std::chrono::steady_clock::now();
+                RangeView view = engine.getRange("A1:J100");
+                sink = sink + view.at(static_cast<uint32_t>(local % 100), 0).size();
+                auto took = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+                slowest = std::max<int64_t>(slowest, took.count());
+                ++local;
+            }
+            reads += local;
+            int64_t previous = slowestRead.load();
+            while (previous < slowest && !slowestRead.compare_exchange_weak(previous, slowest)) {
+            }
+        });
+    }
+
+    for (size_t w = 0; w < options.writers; ++w) {
+        threads.emplace_back([&, w]() {
+            const uint32_t column = static_cast<uint32_t>(10 + w);
+            uint64_t local = 0;
+            std::vector<std::future<void>> pending;
+            while (!stop.load(std::memory_order_relaxed)) {
+                CellAddress cell{static_cast<uint32_t>(local % 1000), column};
+                pending.push_back(engine.submitCellValue(formatCellAddress(cell), std::to_string(local)));
+                ++local;
+                // Keep a bounded backlog so the queue reflects a busy editor, not a flood
+                if (pending.size() == 256) {
+                    for (auto& write : pending) {
+                        write.get();
+                    }
+                    pending.clear();
+                }
+            }
+            for (auto& write : pending) {
+                write.get();
+            }
+            writes += local;
+        });
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    RoundResult result;
+    result.readsPerSecond = reads.load() / elapsed;
+    result.slowestReadMicros = static_cast<double>(slowestRead.load());
+    result.writesPerSecond = writes.load() / elapsed;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parseArguments(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "engine_read_scaling: " << e.what() << '\n';
+        return 2;
+    }
+
+    SpreadsheetEngine engine;
+    std::vector<std::string> values;
+    values.reserve(100 * 10);
+    for (uint32_t row = 0; row < 100; ++row) {
+        for (uint32_t col = 0; col < 10; ++col) {
+            values.push_back(std::to_string(row + col));
+        }
+    }
+    engine.setRangeValues("A1:J100", values);
+
+    std::printf("writers %zu  hardware threads %u\n", options.writers, std::thread::hardware_concurrency());
+    std::printf("%8s %14s %16s %14s\n", "readers", "reads/s", "slowest read us", "writes/s");
+    for (size_t readers = 1; readers <= options.maxReaders; readers *= 2) {
+        RoundResult result = runRound(engine, readers, options);
+        std::printf("%8zu %14.0f %16.0f %14.0f\n", readers, result.readsPerSecond, result.slowestReadMicros,
+                    result.writesPerSecond);
+    }
+    return 0;
+}